@@ -0,0 +1,169 @@
+#ifndef MAIN_CPP_ACTIVITYCULLING_H
+#define MAIN_CPP_ACTIVITYCULLING_H
+
+#include <cmath>
+#include <vector>
+#include <unordered_map>
+#include "box2d.h"
+#include "Actor.h"
+#include "Rigidbody.h"
+#include "Renderer.h"
+
+// Decides whether an actor's OnUpdate / OnLateUpdate run this frame, from its update policy
+// ("update_policy" / "update_interval" in .scene and .template files, or actor:SetUpdatePolicy in Lua).
+//
+// Awake and visible are both answered by the actor's Rigidbody: a sleeping body is idle, and the body
+// position against the camera view tells whether it is on screen. Actors without a body always update.
+// OnStart, Ready and OnDestroy are never culled.
+//
+// Scripts draw from OnUpdate / OnLateUpdate (Image.DrawEx in SpriteRenderer.lua, say), so a culled actor would
+// vanish, or flicker with an update_interval. Instead the Image / Text / Pixel draws an actor with a policy made
+// the last frame it updated are submitted again while it is culled: a sleeping sprite keeps its last pose.
+class ActivityCulling
+{
+public:
+    static constexpr float VIEW_MARGIN = 1.0f; // meters around the screen that still count as visible
+
+    static inline int updatedActors = 0; // last frame
+    static inline int skippedActors = 0; // last frame
+
+    // Call once per frame, before the update loops, with the current camera
+    static void BeginFrame(float camX, float camY, float zoom, int windowWidth, int windowHeight)
+    {
+        // world units are 100 pixels, scaled by the zoom factor
+        float pixelsPerMeter = 100.0f * zoom;
+        viewMinX = camX - windowWidth * 0.5f / pixelsPerMeter - VIEW_MARGIN;
+        viewMaxX = camX + windowWidth * 0.5f / pixelsPerMeter + VIEW_MARGIN;
+        viewMinY = camY - windowHeight * 0.5f / pixelsPerMeter - VIEW_MARGIN;
+        viewMaxY = camY + windowHeight * 0.5f / pixelsPerMeter + VIEW_MARGIN;
+
+        updatedActors = 0;
+        skippedActors = 0;
+    }
+
+    static bool ShouldUpdate(const Actor *actor, int frame)
+    {
+        bool update = IsDue(actor, frame) && IsActive(actor);
+        if (update)
+            updatedActors++;
+        else
+            skippedActors++;
+        return update;
+    }
+
+    // Where the draw requests stand before an actor's OnUpdate / OnLateUpdate
+    struct DrawMark
+    {
+        size_t images, ui, text, pixels;
+    };
+
+    static bool KeepsDraws(const Actor *actor)
+    {
+        return actor->updatePolicy != Actor::UPDATE_ALWAYS || actor->updateInterval > 1;
+    }
+
+    static DrawMark MarkDraws()
+    {
+        return {Renderer::imageRenderRequests.size(), Renderer::uiRenderRequests.size(),
+                Renderer::textRenderRequests.size(), Renderer::pixelRenderRequests.size()};
+    }
+
+    // Keeps the requests made since mark as the actor's draws; first replaces, or adds for OnLateUpdate's
+    static void KeepDraws(const Actor *actor, const DrawMark &mark, bool first)
+    {
+        Draws &draws = lastDraws[actor->actor_id];
+        if (first)
+            draws = Draws();
+        Append(draws.images, Renderer::imageRenderRequests, mark.images);
+        Append(draws.ui, Renderer::uiRenderRequests, mark.ui);
+        Append(draws.text, Renderer::textRenderRequests, mark.text);
+        Append(draws.pixels, Renderer::pixelRenderRequests, mark.pixels);
+    }
+
+    // For a culled actor, in place of its OnUpdate
+    static void RepeatDraws(const Actor *actor)
+    {
+        auto it = lastDraws.find(actor->actor_id);
+        if (it == lastDraws.end())
+            return;
+        const Draws &draws = it->second;
+        Renderer::imageRenderRequests.insert(Renderer::imageRenderRequests.end(), draws.images.begin(),
+                                             draws.images.end());
+        Renderer::uiRenderRequests.insert(Renderer::uiRenderRequests.end(), draws.ui.begin(), draws.ui.end());
+        Renderer::textRenderRequests.insert(Renderer::textRenderRequests.end(), draws.text.begin(), draws.text.end());
+        Renderer::pixelRenderRequests.insert(Renderer::pixelRenderRequests.end(), draws.pixels.begin(),
+                                             draws.pixels.end());
+    }
+
+    static void Forget(const Actor *actor)
+    {
+        lastDraws.erase(actor->actor_id);
+    }
+
+private:
+    struct Draws
+    {
+        std::vector<Renderer::ImageRenderRequest> images;
+        std::vector<Renderer::UIRenderRequest> ui;
+        std::vector<Renderer::TextRenderRequest> text;
+        std::vector<Renderer::PixelRenderRequest> pixels;
+    };
+
+    static inline std::unordered_map<int, Draws> lastDraws; // by actor id, for actors that KeepsDraws
+
+    template<typename Request>
+    static void Append(std::vector<Request> &to, const std::vector<Request> &from, size_t mark)
+    {
+        to.insert(to.end(), from.begin() + static_cast<std::ptrdiff_t>(mark), from.end());
+    }
+
+    static inline float viewMinX = 0.0f;
+    static inline float viewMaxX = 0.0f;
+    static inline float viewMinY = 0.0f;
+    static inline float viewMaxY = 0.0f;
+
+    // update_interval N: every N-th frame, staggered by actor id so they do not all land on the same frame
+    static bool IsDue(const Actor *actor, int frame)
+    {
+        if (actor->updateInterval <= 1)
+            return true;
+        return (frame + actor->actor_id) % actor->updateInterval == 0;
+    }
+
+    static bool IsActive(const Actor *actor)
+    {
+        if (actor->updatePolicy == Actor::UPDATE_ALWAYS)
+            return true;
+
+        const b2Body *body = actor->rigidbody ? actor->rigidbody->body : nullptr;
+        if (body == nullptr)
+            return true;
+
+        switch (actor->updatePolicy)
+        {
+            case Actor::UPDATE_WHEN_AWAKE:
+                return IsAwake(body);
+            case Actor::UPDATE_WHEN_VISIBLE:
+                return IsVisible(body);
+            case Actor::UPDATE_WHEN_ACTIVE:
+                return IsAwake(body) || IsVisible(body);
+            default:
+                return true;
+        }
+    }
+
+    // static bodies never sleep in Box2D's sense, but they never move either
+    static bool IsAwake(const b2Body *body)
+    {
+        return body->GetType() != b2_staticBody && body->IsAwake();
+    }
+
+    static bool IsVisible(const b2Body *body)
+    {
+        const b2Vec2 &position = body->GetPosition();
+        return position.x >= viewMinX && position.x <= viewMaxX && position.y >= viewMinY && position.y <= viewMaxY;
+    }
+};
+
+
+#endif //MAIN_CPP_ACTIVITYCULLING_H
@@ -89,6 +89,40 @@ void CollisionDetector::EndContact(b2Contact *contact)
 
 }
 
+//    Collect then Alter: Mark Removal -> Actual Removal
+//    self.actor:RemoveComponent(component_ref) Remove component from actor.
+//    Immediately set the component’s enabled variable to false.
+//    The removed component should not execute any more lifecycle functions after this call.
+void Actor::RemoveComponent(const luabridge::LuaRef &component_ref)
+{
+    std::string key = component_ref["key"].tostring();
+    component_ref["enabled"] = false; // Immediately set the component’s enabled variable to false
+    component_ref["removed"] = true; // Immediately set the component’s enabled variable to false
+    componentsToRemove.push_back(key);
+
+    // When a Rigidbody is removed, its Box2D body will be unregistered
+    // with the physics world and stop simulating immediately
+    if (component_ref["type"].tostring() == "Rigidbody")
+    {
+        component_ref.cast<Rigidbody *>()->Release();
+    }
+}
+
+void Actor::OnDestroy()
+{
+    // the b2Bodys go back to the world (or the body pool) before the actor pointer in their fixtures dangles
+    for (auto &component: components)
+    {
+        if ((*component.second)["type"].tostring() == "Rigidbody")
+        {
+            component.second->cast<Rigidbody *>()->Release();
+        }
+        LuaStats::Forget(component.second);
+    }
+
+    components.clear();
+}
+
 //    self.actor:AddComponent(type_name) : Add component to actor and return reference to it.
 //    The new component should begin executing lifecycle functions on the next frame.
 //    The component’s “key” (which remember, determines execution order) has a formula–
@@ -104,7 +138,7 @@ luabridge::LuaRef *Actor::AddComponent(const std::string &type)
 
     if (type != "Rigidbody")
     {
-        if (luaL_dofile(LuaManager::lua_state, path.c_str()) != LUA_OK)
+        if (LuaManager::DoFile(path) != LUA_OK)
         {
             std::cout << "problem with lua file " << type;
             exit(0);
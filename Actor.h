@@ -6,31 +6,52 @@
 #include <map>
 #include <vector>
 #include <utility>
+#include <algorithm>
+#include <iostream>
 #include "glm/glm.hpp"
 #include "rapidjson/document.h"
 #include "Lua/lua.hpp"
 #include "LuaBridge/LuaBridge.h"
 #include "LuaMananger.h"
+#include "LuaStats.h"
 #include "box2d.h"
 
 static int next_actor_id = 1; // Global counter to ensure unique actor IDs
 
 static int component_id = 0; // Global counter to record the number of times AddComponent()
 
-static inline bool world_initialized = false;
-static inline b2World *world = nullptr;
+// inline, not static: Actor.cpp releases bodies into the same world that main.cpp's Rigidbodies create
+inline bool world_initialized = false;
+inline b2World *world = nullptr;
 
 static inline std::vector<luabridge::LuaRef *> componentsAwaitingOnStart; // Global vector to store components awaiting OnStart()
 
+class Rigidbody; // forward declaration
+
 class Actor
 {
 public:
     luabridge::LuaRef *AddComponent(const std::string &type);
 
+    // When OnUpdate / OnLateUpdate run for this actor (see ActivityCulling.h)
+    enum UpdatePolicy
+    {
+        UPDATE_ALWAYS, // every frame (default)
+        UPDATE_WHEN_AWAKE, // only while its b2Body is awake
+        UPDATE_WHEN_VISIBLE, // only while its b2Body is inside the camera view
+        UPDATE_WHEN_ACTIVE // while awake or visible
+    };
+
     int actor_id;
     std::string name;
     bool fromAnotherScene; // flag to determine whether this actor come from another scene
     bool dontDestroyOnLoad; // flag to determine whether this actor should be destroyed when scene changes
+
+    UpdatePolicy updatePolicy = UPDATE_ALWAYS;
+    int updateInterval = 1; // additionally only update every N frames
+    Rigidbody *rigidbody = nullptr; // set once a Rigidbody component has its body
+    bool updateCulled = false; // OnUpdate / OnLateUpdate skipped this frame
+    bool pendingInstantiation = false; // queued by Actor.InstantiateDeferred, no components yet
     // Components should be processed in the alphabetical order of their key
     static inline std::map<std::string, luabridge::LuaRef *> componentsAdded; // just_added_components
 
@@ -68,6 +89,33 @@ public:
     void updateFromJson(const rapidjson::Value &actorValue)
     {
         if (actorValue.HasMember("name")) name = actorValue["name"].GetString();
+        updatePolicyFromJson(actorValue);
+    }
+
+    // "update_policy": "always" | "when_awake" | "when_visible" | "when_active", "update_interval": N
+    void updatePolicyFromJson(const rapidjson::Value &actorValue)
+    {
+        if (actorValue.HasMember("update_policy") && actorValue["update_policy"].IsString())
+            updatePolicy = ParseUpdatePolicy(actorValue["update_policy"].GetString());
+        if (actorValue.HasMember("update_interval") && actorValue["update_interval"].IsInt())
+            updateInterval = std::max(1, actorValue["update_interval"].GetInt());
+    }
+
+    // self.actor:SetUpdatePolicy(policy, interval)
+    void SetUpdatePolicy(const std::string &policy, int interval)
+    {
+        updatePolicy = ParseUpdatePolicy(policy);
+        updateInterval = std::max(1, interval);
+    }
+
+    static UpdatePolicy ParseUpdatePolicy(const std::string &policy)
+    {
+        if (policy == "when_awake") return UPDATE_WHEN_AWAKE;
+        if (policy == "when_visible") return UPDATE_WHEN_VISIBLE;
+        if (policy == "when_active") return UPDATE_WHEN_ACTIVE;
+        if (policy != "always")
+            std::cout << "error: unknown update policy " << policy << std::endl;
+        return UPDATE_ALWAYS;
     }
 
     std::string GetName() const
@@ -80,6 +128,12 @@ public:
         return actor_id;
     }
 
+    // self.actor:IsInstantiated() is false while Actor.InstantiateDeferred still has the actor queued
+    bool IsInstantiated() const
+    {
+        return !pendingInstantiation;
+    }
+
     // self.actor:GetComponentByKey(key) obtains reference to a component via key
     luabridge::LuaRef GetComponentByKey(const std::string &key)
     {
@@ -147,34 +201,13 @@ public:
 //    The removed component should not execute any more lifecycle functions after this call.
 //    Warning : Be careful not to alter a container (remove from map / set) while iterating over it.
 //    Consider using the Collect-Then-Alter pattern.
-    void RemoveComponent(const luabridge::LuaRef &component_ref)
-    {
-        std::string key = component_ref["key"].tostring();
-        component_ref["enabled"] = false; // Immediately set the component’s enabled variable to false
-        component_ref["removed"] = true; // Immediately set the component’s enabled variable to false
-        componentsToRemove.push_back(key);
-
-        // When a Rigidbody is removed, its Box2D body will be unregistered
-        // with the physics world and stop simulating immediately
-        // FIXME: the way to get body from component_ref["body"] may be wrong
-        if (component_ref["type"].tostring() == "Rigidbody")
-        {
-            b2Body *body = component_ref["body"].cast<b2Body *>();
-            if (body)
-            {
-                world->DestroyBody(body);
-            }
-        }
-    }
+    void RemoveComponent(const luabridge::LuaRef &component_ref);
 
 //    Destroy an actor, removing it and all of its components from the scene.
 //    No lifecycle functions on the actor’s components should run after this function call.
 //    The actual destruction of the actor should occur at the end of the current frame
 //    (after all OnLateUpdates would have been called).
-    void OnDestroy()
-    {
-        components.clear();
-    }
+    void OnDestroy();
 
 
     void OnTriggerEnter(const Collision &collision)
@@ -186,6 +219,7 @@ public:
                 if ((*component.second)["OnTriggerEnter"].isFunction())
                 {
                     componentsOnTriggerEnter.insert({component.first, component.second});
+                    LuaStats::Scope scope(component.second, LuaStats::ON_TRIGGER_ENTER);
                     (*component.second)["OnTriggerEnter"](*component.second, collision);
                 }
             }
@@ -196,6 +230,7 @@ public:
             {
                 if ((*component.second)["OnTriggerEnter"].isFunction())
                 {
+                    LuaStats::Scope scope(component.second, LuaStats::ON_TRIGGER_ENTER);
                     (*component.second)["OnTriggerEnter"](*component.second, collision);
                 }
             }
@@ -211,6 +246,7 @@ public:
                 if ((*component.second)["OnTriggerExit"].isFunction())
                 {
                     componentsOnTriggerExit.insert({component.first, component.second});
+                    LuaStats::Scope scope(component.second, LuaStats::ON_TRIGGER_EXIT);
                     (*component.second)["OnTriggerExit"](*component.second, collision);
                 }
             }
@@ -221,6 +257,7 @@ public:
             {
                 if ((*component.second)["OnTriggerExit"].isFunction())
                 {
+                    LuaStats::Scope scope(component.second, LuaStats::ON_TRIGGER_EXIT);
                     (*component.second)["OnTriggerExit"](*component.second, collision);
                 }
             }
@@ -237,6 +274,7 @@ public:
                 if (((*component.second)["OnCollisionEnter"]).isFunction())
                 {
                     componentsOnCollisionEnter.insert({component.first, component.second});
+                    LuaStats::Scope scope(component.second, LuaStats::ON_COLLISION_ENTER);
                     (*component.second)["OnCollisionEnter"](*component.second, collision);
                 }
             }
@@ -247,6 +285,7 @@ public:
             {
                 if ((*component.second)["OnCollisionEnter"].isFunction())
                 {
+                    LuaStats::Scope scope(component.second, LuaStats::ON_COLLISION_ENTER);
                     (*component.second)["OnCollisionEnter"](*component.second, collision);
                 }
             }
@@ -264,6 +303,7 @@ public:
                 if ((*component.second)["OnCollisionExit"].isFunction())
                 {
                     componentsOnCollisionExit.insert({component.first, component.second});
+                    LuaStats::Scope scope(component.second, LuaStats::ON_COLLISION_EXIT);
                     (*component.second)["OnCollisionExit"](*component.second, collision);
                 }
             }
@@ -274,6 +314,7 @@ public:
             {
                 if ((*component.second)["OnCollisionExit"].isFunction())
                 {
+                    LuaStats::Scope scope(component.second, LuaStats::ON_COLLISION_EXIT);
                     (*component.second)["OnCollisionExit"](*component.second, collision);
                 }
             }
@@ -289,6 +330,7 @@ public:
             luabridge::LuaRef onStart = (*component.second)["OnStart"];
             if (onStart.isFunction() && (*component.second)["enabled"] && !(*component.second)["removed"])
             {
+                LuaStats::Scope scope(component.second, LuaStats::ON_START);
                 try
                 {
                     onStart(*component.second);
@@ -312,6 +354,7 @@ public:
             luabridge::LuaRef onUpdate = (*component.second)["OnUpdate"];
             if (onUpdate.isFunction() && (*component.second)["enabled"] && !(*component.second)["removed"])
             {
+                LuaStats::Scope scope(component.second, LuaStats::ON_UPDATE);
                 try
                 {
                     onUpdate(*component.second);
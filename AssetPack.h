@@ -0,0 +1,245 @@
+#ifndef MAIN_CPP_ASSETPACK_H
+#define MAIN_CPP_ASSETPACK_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <filesystem>
+#include "SDL2/SDL_rwops.h"
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define ASSET_PACK_MMAP
+#endif
+
+// resources.pak: every file under resources/ in one archive, written by tools/asset_pack.
+//
+//   header        AssetPackHeader
+//   entries       AssetPackEntry × entryCount
+//   names         the paths ("resources/images/box.png"), not terminated
+//   data          each file at a 16-byte aligned offset
+//
+// The engine opens it once at startup and maps it. A lookup is a hash table probe rather than a stat() and
+// an open(), and the loaders read straight from the mapping through SDL_RWops. Files that are not in the
+// pack are still read from disk, so a pack can be used next to loose files during development.
+struct AssetPackHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t namesBytes;
+};
+
+struct AssetPackEntry
+{
+    uint64_t offset;
+    uint64_t size;
+    uint32_t nameOffset;
+    uint32_t nameLength;
+};
+static_assert(sizeof(AssetPackEntry) == 24, "asset pack entries are fixed size");
+
+class AssetPack
+{
+public:
+    static constexpr char MAGIC[4] = {'A', 'P', 'A', 'K'};
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint64_t ALIGNMENT = 16;
+
+    struct Asset
+    {
+        const char *data;
+        size_t size;
+    };
+
+    // false if there is no pack, or it is not a valid one
+    static bool Open(const std::string &path)
+    {
+        if (!Map(path))
+            return false;
+
+        const auto *header = reinterpret_cast<const AssetPackHeader *>(data);
+        uint64_t indexBytes = sizeof(AssetPackHeader);
+        if (size >= indexBytes)
+            indexBytes += uint64_t(header->entryCount) * sizeof(AssetPackEntry) + header->namesBytes;
+        if (size < sizeof(AssetPackHeader) || std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 ||
+            header->version != VERSION || indexBytes > size)
+        {
+            Close();
+            return false;
+        }
+
+        const auto *entries = reinterpret_cast<const AssetPackEntry *>(data + sizeof(AssetPackHeader));
+        const char *names = reinterpret_cast<const char *>(entries + header->entryCount);
+        assets.reserve(header->entryCount);
+        for (uint32_t i = 0; i < header->entryCount; i++)
+        {
+            const AssetPackEntry &entry = entries[i];
+            if (uint64_t(entry.nameOffset) + entry.nameLength > header->namesBytes || entry.offset > size ||
+                entry.size > size - entry.offset)
+            {
+                Close();
+                return false;
+            }
+            assets.emplace(std::string_view(names + entry.nameOffset, entry.nameLength),
+                           Asset{reinterpret_cast<const char *>(data + entry.offset), static_cast<size_t>(entry.size)});
+        }
+        return true;
+    }
+
+    static bool IsOpen()
+    {
+        return data != nullptr;
+    }
+
+    // Only what is in the pack
+    static bool Find(const std::string &path, Asset &asset)
+    {
+        auto it = assets.find(path);
+        if (it == assets.end())
+            return false;
+        asset = it->second;
+        return true;
+    }
+
+    static bool Contains(const std::string &path)
+    {
+        return assets.count(path) > 0;
+    }
+
+    // In the pack or on disk
+    static bool Exists(const std::string &path)
+    {
+        return Contains(path) || std::filesystem::exists(path);
+    }
+
+    // SDL_RWops over the packed file, or over the file on disk; nullptr if neither exists. The IMG, TTF and
+    // Mix *_RW loaders take it with freesrc = 1.
+    static SDL_RWops *OpenRW(const std::string &path)
+    {
+        Asset asset{};
+        if (Find(path, asset))
+            return SDL_RWFromConstMem(asset.data, static_cast<int>(asset.size));
+        return SDL_RWFromFile(path.c_str(), "rb");
+    }
+
+    // Packs files (paths as the engine opens them, contents read from diskPaths); false if the pack can't be
+    // written
+    static bool Write(const std::string &packPath, const std::vector<std::string> &paths,
+                      const std::vector<std::string> &diskPaths)
+    {
+        std::vector<AssetPackEntry> entries(paths.size());
+        std::string names;
+        for (size_t i = 0; i < paths.size(); i++)
+        {
+            entries[i].nameOffset = static_cast<uint32_t>(names.size());
+            entries[i].nameLength = static_cast<uint32_t>(paths[i].size());
+            names += paths[i];
+        }
+
+        uint64_t offset = sizeof(AssetPackHeader) + entries.size() * sizeof(AssetPackEntry) + names.size();
+        for (size_t i = 0; i < paths.size(); i++)
+        {
+            std::error_code error;
+            offset = (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+            entries[i].offset = offset;
+            entries[i].size = std::filesystem::file_size(diskPaths[i], error);
+            if (error)
+                return false;
+            offset += entries[i].size;
+        }
+
+        AssetPackHeader header{};
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.entryCount = static_cast<uint32_t>(entries.size());
+        header.namesBytes = static_cast<uint32_t>(names.size());
+
+        FILE *file = std::fopen(packPath.c_str(), "wb");
+        if (file == nullptr)
+            return false;
+        std::fwrite(&header, sizeof(header), 1, file);
+        std::fwrite(entries.data(), sizeof(AssetPackEntry), entries.size(), file);
+        std::fwrite(names.data(), 1, names.size(), file);
+
+        bool ok = true;
+        std::vector<char> contents;
+        for (size_t i = 0; i < paths.size() && ok; i++)
+        {
+            static const char zeros[ALIGNMENT] = {};
+            std::fwrite(zeros, 1, entries[i].offset - static_cast<uint64_t>(std::ftell(file)), file);
+
+            FILE *input = std::fopen(diskPaths[i].c_str(), "rb");
+            contents.resize(entries[i].size);
+            ok = input != nullptr && std::fread(contents.data(), 1, contents.size(), input) == contents.size();
+            if (input != nullptr)
+                std::fclose(input);
+            std::fwrite(contents.data(), 1, contents.size(), file);
+        }
+        return std::fclose(file) == 0 && ok;
+    }
+
+    static void Close()
+    {
+        assets.clear();
+#ifdef ASSET_PACK_MMAP
+        if (data != nullptr)
+            munmap(const_cast<uint8_t *>(data), size);
+#endif
+        buffer.clear();
+        buffer.shrink_to_fit();
+        data = nullptr;
+        size = 0;
+    }
+
+private:
+    static inline const uint8_t *data = nullptr;
+    static inline size_t size = 0;
+    static inline std::vector<uint8_t> buffer; // without mmap
+    static inline std::unordered_map<std::string_view, Asset> assets; // keys point into the mapping
+
+    static bool Map(const std::string &path)
+    {
+        Close();
+#ifdef ASSET_PACK_MMAP
+        int descriptor = open(path.c_str(), O_RDONLY);
+        if (descriptor < 0)
+            return false;
+        struct stat status{};
+        if (fstat(descriptor, &status) != 0 || status.st_size == 0)
+        {
+            close(descriptor);
+            return false;
+        }
+        void *mapping = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+        close(descriptor);
+        if (mapping == MAP_FAILED)
+            return false;
+        data = static_cast<const uint8_t *>(mapping);
+        size = static_cast<size_t>(status.st_size);
+#else
+        FILE *file = std::fopen(path.c_str(), "rb");
+        if (file == nullptr)
+            return false;
+        std::fseek(file, 0, SEEK_END);
+        buffer.resize(static_cast<size_t>(std::ftell(file)));
+        std::fseek(file, 0, SEEK_SET);
+        size_t read = std::fread(buffer.data(), 1, buffer.size(), file);
+        std::fclose(file);
+        if (read != buffer.size() || buffer.empty())
+            return false;
+        data = buffer.data();
+        size = buffer.size();
+#endif
+        return true;
+    }
+};
+
+
+#endif //MAIN_CPP_ASSETPACK_H
@@ -27,6 +27,78 @@ public:
         }
     }
 
+    /* Mix_LoadWAV498 for clips read through SDL_RWops (resources.pak); takes ownership of src. */
+    static inline Mix_Chunk* Mix_LoadWAV_RW498(SDL_RWops* src)
+    {
+        if (!IsAutograderMode())
+            return Mix_LoadWAV_RW(src, 1);
+        else
+        {
+            if (src == nullptr)
+                return nullptr;
+            SDL_RWclose(src);
+            return &autograder_dummy_sound;
+        }
+    }
+
+    /* Frees a clip from Mix_LoadWAV498 / Mix_LoadWAV_RW498 (the autograder's dummy is never freed). */
+    static inline void Mix_FreeChunk498(Mix_Chunk* chunk)
+    {
+        if (!IsAutograderMode() && chunk != nullptr)
+            Mix_FreeChunk(chunk);
+    }
+
+    /* Streamed playback (AudioStream.h): a chunk over memory that stays owned by the caller, and an effect that
+       writes the channel's samples. Both fail in autograder mode, where clips are then loaded whole. */
+    static inline Mix_Chunk* Mix_QuickLoad_RAW498(Uint8* memory, Uint32 length)
+    {
+        if (!IsAutograderMode())
+            return Mix_QuickLoad_RAW(memory, length);
+        else
+            return nullptr;
+    }
+
+    static inline int Mix_RegisterEffect498(int channel, Mix_EffectFunc_t effect, Mix_EffectDone_t done, void* arg)
+    {
+        if (!IsAutograderMode())
+            return Mix_RegisterEffect(channel, effect, done, arg);
+        else
+            return 0;
+    }
+
+    static inline int Mix_ExpireChannel498(int channel, int ticks)
+    {
+        if (!IsAutograderMode())
+            return Mix_ExpireChannel(channel, ticks);
+        else
+            return 0;
+    }
+
+    /* Nothing plays in autograder mode. */
+    static inline int Mix_Playing498(int channel)
+    {
+        if (!IsAutograderMode())
+            return Mix_Playing(channel);
+        else
+            return 0;
+    }
+
+    /* Left and right volume of a channel, 255 each is unpanned. */
+    static inline int Mix_SetPanning498(int channel, Uint8 left, Uint8 right)
+    {
+        if (!IsAutograderMode())
+            return Mix_SetPanning(channel, left, right);
+        else
+            return 1;
+    }
+
+    /* The engine's own mixing after SDL_mixer's (SoftwareMixer.h); no device in autograder mode. */
+    static inline void Mix_SetPostMix498(void (*mix_func)(void* udata, Uint8* stream, int len), void* arg)
+    {
+        if (!IsAutograderMode())
+            Mix_SetPostMix(mix_func, arg);
+    }
+
     static inline int Mix_PlayChannel498(int channel, Mix_Chunk *chunk, int loops)
     {
         std::cout << "(Mix_PlayChannel498(" << channel << ",?," << loops << ") called on frame " << Helper::GetFrameNumber() << ")" << std::endl;
@@ -3,37 +3,149 @@
 
 // This is the class to manage audio loading / playback
 #include "AudioHelper.h"
+#include "AudioStream.h"
+#include "AssetPack.h"
+#include "rapidjson/document.h"
 #include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <filesystem>
 #include <unordered_map>
 
+// Clips are loaded once and kept while something holds a reference: the channel that last played the clip,
+// and Audio.Preload(name) until Audio.Unload(name). Short clips are decoded whole when loaded. A .wav over
+// "audio_stream_threshold_kb" (game.config, default 1024) streams from its file instead (AudioStream.h),
+// through a ring buffer of about a second. .ogg clips are always decoded whole: SDL_mixer only streams them
+// as Mix_Music, which AudioHelper rules out.
 class AudioManager {
 public:
     AudioManager();
     ~AudioManager();
 
-    static inline std::unordered_map<std::string, Mix_Chunk*> musicTracks; // loaded_audio
+    struct Clip {
+        Mix_Chunk* chunk;
+        int references;
+    };
+
+    static inline std::unordered_map<std::string, Clip> clips; // loaded_audio
+    static inline std::unordered_map<int, std::string> channelClips; // the clip each channel last played
+    static inline std::vector<std::unique_ptr<AudioStream>> streams;
+    static inline size_t streamThresholdBytes = 1024 * 1024;
+
+    static void LoadFromConfig(const rapidjson::Document& gameConfig) {
+        if (gameConfig.HasMember("audio_stream_threshold_kb") && gameConfig["audio_stream_threshold_kb"].IsNumber())
+            streamThresholdBytes = static_cast<size_t>(gameConfig["audio_stream_threshold_kb"].GetDouble() * 1024);
+    }
 
     static void PlayMusic(int channel, const std::string& clip_name, bool does_loop) {
         // path could be .wav or .ogg
         int loops = does_loop ? -1 : 0;
+        std::string path = FindClip(clip_name);
+
+        if (ShouldStream(path)) {
+            std::unique_ptr<AudioStream> stream(AudioStream::Open(path, does_loop));
+            if (stream != nullptr && AudioStream::Carrier() != nullptr) {
+                // the carrier loops until the stream has played out, see Update
+                int played = AudioHelper::Mix_PlayChannel498(channel, AudioStream::Carrier(), -1);
+                if (played < 0)
+                    return;
+                SetChannelClip(played, "");
+                if (stream->Attach(played))
+                    streams.push_back(std::move(stream));
+                else
+                    AudioHelper::Mix_ExpireChannel498(played, 1); // don't leave the silence looping
+                return;
+            }
+        }
+
+        Mix_Chunk* chunk = AcquireClip(clip_name, path);
+        int played = AudioHelper::Mix_PlayChannel498(channel, chunk, loops);
+        if (chunk == nullptr)
+            return;
+        if (played >= 0)
+            SetChannelClip(played, clip_name); // takes over the reference
+        else
+            ReleaseClip(clip_name);
+    }
+
+    // Audio.Preload(name): decodes the clip now rather than on its first Play. Streamed clips are left alone.
+    static void Preload(const std::string& clip_name) {
+        std::string path = FindClip(clip_name);
+        if (!path.empty() && !ShouldStream(path))
+            AcquireClip(clip_name, path);
+    }
+
+    // Audio.Unload(name): drops Preload's reference
+    static void Unload(const std::string& clip_name) {
+        std::string path = FindClip(clip_name);
+        if (!path.empty() && !ShouldStream(path))
+            ReleaseClip(clip_name);
+    }
+
+    // Once per frame: keeps the streams' buffers full and lets them go once their channel has moved on
+    static void Update() {
+        for (auto& stream: streams) {
+            if (stream->Detached())
+                continue;
+            stream->Fill();
+            if (stream->Finished())
+                AudioHelper::Mix_ExpireChannel498(stream->GetChannel(), 1);
+        }
+        streams.erase(std::remove_if(streams.begin(), streams.end(), [](const std::unique_ptr<AudioStream>& stream) {
+            return stream->Detached();
+        }), streams.end());
+    }
 
-        std::string path;
+    // resources/audio/<name>.wav or .ogg; empty if neither exists
+    static std::string FindClip(const std::string& clip_name) {
         std::string WavPath = "resources/audio/" + clip_name + ".wav";
         std::string OggPath = "resources/audio/" + clip_name + ".ogg";
-        if (std::filesystem::exists(WavPath)) {
-            path = WavPath;
-        } else if (std::filesystem::exists(OggPath)) {
-            path = OggPath;
-        } else {
-            std::cout << "Audio file not found: " << clip_name << std::endl;
-        }
+        if (AssetPack::Exists(WavPath))
+            return WavPath;
+        if (AssetPack::Exists(OggPath))
+            return OggPath;
+        std::cout << "Audio file not found: " << clip_name << std::endl;
+        return "";
+    }
 
-        // load music
-        musicTracks[clip_name] = AudioHelper::Mix_LoadWAV498(path.c_str());
+    static bool ShouldStream(const std::string& path) {
+        if (path.size() < 4 || path.compare(path.size() - 4, 4, ".wav") != 0)
+            return false;
+        AssetPack::Asset asset{};
+        if (AssetPack::Find(path, asset))
+            return asset.size > streamThresholdBytes;
+        std::error_code error;
+        uintmax_t size = std::filesystem::file_size(path, error);
+        return !error && size > streamThresholdBytes;
+    }
 
-        if (musicTracks.find(clip_name) != musicTracks.end()) {
-            AudioHelper::Mix_PlayChannel498(channel, musicTracks[clip_name], loops);
+    // The cached clip with one more reference, loaded if needed; nullptr (and no reference) if it can't be read
+    static Mix_Chunk* AcquireClip(const std::string& clip_name, const std::string& path) {
+        auto it = clips.find(clip_name);
+        if (it == clips.end()) {
+            Mix_Chunk* chunk = LoadClip(path);
+            if (chunk == nullptr)
+                return nullptr;
+            it = clips.emplace(clip_name, Clip{chunk, 0}).first;
         }
+        it->second.references++;
+        return it->second.chunk;
+    }
+
+    static void ReleaseClip(const std::string& clip_name) {
+        auto it = clips.find(clip_name);
+        if (it == clips.end() || --it->second.references > 0)
+            return;
+        AudioHelper::Mix_FreeChunk498(it->second.chunk);
+        clips.erase(it);
+    }
+
+    // Clips in resources.pak decode from the mapped file
+    static Mix_Chunk* LoadClip(const std::string& path) {
+        if (!AssetPack::Contains(path))
+            return AudioHelper::Mix_LoadWAV498(path.c_str());
+        return AudioHelper::Mix_LoadWAV_RW498(AssetPack::OpenRW(path));
     }
 
     static void StopMusic() {
@@ -44,10 +156,23 @@ public:
         AudioHelper::Mix_Volume498(channel, volume);
     }
 
+private:
+    // The channel's previous clip can go once nothing else uses it; its chunk is no longer playing there
+    static void SetChannelClip(int channel, const std::string& clip_name) {
+        auto it = channelClips.find(channel);
+        if (it != channelClips.end()) {
+            std::string previous = std::move(it->second);
+            channelClips.erase(it);
+            ReleaseClip(previous);
+        }
+        if (!clip_name.empty())
+            channelClips[channel] = clip_name;
+    }
 };
 
 AudioManager::AudioManager() {
-    // Initialize audio system
+    // Initialize audio system. The one instance is made by initialize(), after headless mode has picked
+    // the dummy driver; a global's would open the sound device before main() runs.
     AudioHelper::Mix_OpenAudio498(44100, MIX_DEFAULT_FORMAT, 2, 2048);
     // channels 0-49 must be available via Mix_allocateChannels()
     AudioHelper::Mix_AllocateChannels498(50);
@@ -0,0 +1,172 @@
+#ifndef MAIN_CPP_AUDIOMIX_H
+#define MAIN_CPP_AUDIOMIX_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define AUDIO_MIX_AVX2
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define AUDIO_MIX_SSE2
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#define AUDIO_MIX_WASM
+#endif
+
+// The inner loops of SoftwareMixer, on interleaved stereo: voices of 16-bit samples are summed into a float
+// buffer with a gain per side, and the sum is added to the device's 16-bit stream with saturation.
+// Native builds use SSE2, or AVX2 with -mavx2 (cmake -DENGINE_AVX2=ON); the web build uses wasm SIMD with
+// -msimd128 (make SIMD=1). Each has the scalar version as reference, which gives the same results.
+// No SDL here, so bench/micro/audio_mix.cpp builds without it.
+class AudioMix
+{
+public:
+    static const char *GetPath()
+    {
+#if defined(AUDIO_MIX_AVX2)
+        return "avx2";
+#elif defined(AUDIO_MIX_SSE2)
+        return "sse2";
+#elif defined(AUDIO_MIX_WASM)
+        return "wasm simd";
+#else
+        return "scalar";
+#endif
+    }
+
+    // mix[2i] += samples[2i] * left, mix[2i + 1] += samples[2i + 1] * right, for frames i
+    static void AddVoice(float *mix, const int16_t *samples, size_t frames, float left, float right)
+    {
+        size_t i = 0; // samples, two per frame
+        size_t count = frames * 2;
+#if defined(AUDIO_MIX_AVX2)
+        const __m256 gains = _mm256_setr_ps(left, right, left, right, left, right, left, right);
+        for (; i + 16 <= count; i += 16)
+        {
+            __m128i packed0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + i));
+            __m128i packed1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + i + 8));
+            __m256 in0 = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(packed0));
+            __m256 in1 = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(packed1));
+            _mm256_storeu_ps(mix + i, _mm256_add_ps(_mm256_loadu_ps(mix + i), _mm256_mul_ps(in0, gains)));
+            _mm256_storeu_ps(mix + i + 8, _mm256_add_ps(_mm256_loadu_ps(mix + i + 8), _mm256_mul_ps(in1, gains)));
+        }
+#elif defined(AUDIO_MIX_SSE2)
+        const __m128 gains = _mm_setr_ps(left, right, left, right);
+        for (; i + 8 <= count; i += 8)
+        {
+            __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + i));
+            // sign-extend by unpacking each sample into the high half and shifting it back down
+            __m128 in0 = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(packed, packed), 16));
+            __m128 in1 = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(packed, packed), 16));
+            _mm_storeu_ps(mix + i, _mm_add_ps(_mm_loadu_ps(mix + i), _mm_mul_ps(in0, gains)));
+            _mm_storeu_ps(mix + i + 4, _mm_add_ps(_mm_loadu_ps(mix + i + 4), _mm_mul_ps(in1, gains)));
+        }
+#elif defined(AUDIO_MIX_WASM)
+        const v128_t gains = wasm_f32x4_make(left, right, left, right);
+        for (; i + 8 <= count; i += 8)
+        {
+            v128_t packed = wasm_v128_load(samples + i);
+            v128_t in0 = wasm_f32x4_convert_i32x4(wasm_i32x4_extend_low_i16x8(packed));
+            v128_t in1 = wasm_f32x4_convert_i32x4(wasm_i32x4_extend_high_i16x8(packed));
+            wasm_v128_store(mix + i, wasm_f32x4_add(wasm_v128_load(mix + i), wasm_f32x4_mul(in0, gains)));
+            wasm_v128_store(mix + i + 4, wasm_f32x4_add(wasm_v128_load(mix + i + 4), wasm_f32x4_mul(in1, gains)));
+        }
+#endif
+        AddVoiceScalar(mix + i, samples + i, (count - i) / 2, left, right);
+    }
+
+    static void AddVoiceScalar(float *mix, const int16_t *samples, size_t frames, float left, float right)
+    {
+        for (size_t i = 0; i < frames * 2; i += 2)
+        {
+            mix[i] += static_cast<float>(samples[i]) * left;
+            mix[i + 1] += static_cast<float>(samples[i + 1]) * right;
+        }
+    }
+
+    // stream[i] += mix[i] * gain for count samples, rounded to nearest and saturated to 16 bits twice: the
+    // sum of the voices, then the sum with what SDL_mixer's channels left in the stream
+    static void AddToStream(int16_t *stream, const float *mix, size_t count, float gain)
+    {
+        size_t i = 0;
+#if defined(AUDIO_MIX_AVX2)
+        const __m256 gains = _mm256_set1_ps(gain);
+        const __m256 low = _mm256_set1_ps(-32768.0f), high = _mm256_set1_ps(32767.0f);
+        for (; i + 16 <= count; i += 16)
+        {
+            // clamped first: out of range conversions give INT_MIN, which would saturate the wrong way
+            __m256 scaled0 = _mm256_min_ps(high, _mm256_max_ps(low, _mm256_mul_ps(_mm256_loadu_ps(mix + i), gains)));
+            __m256 scaled1 = _mm256_min_ps(high, _mm256_max_ps(low, _mm256_mul_ps(_mm256_loadu_ps(mix + i + 8), gains)));
+            __m256i sum0 = _mm256_cvtps_epi32(scaled0);
+            __m256i sum1 = _mm256_cvtps_epi32(scaled1);
+            // packs works per 128-bit lane; the permute puts the four quarters back in order
+            __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(sum0, sum1), 0xD8);
+            __m256i out = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(stream + i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(stream + i), _mm256_adds_epi16(out, packed));
+        }
+#elif defined(AUDIO_MIX_SSE2)
+        const __m128 gains = _mm_set1_ps(gain);
+        const __m128 low = _mm_set1_ps(-32768.0f), high = _mm_set1_ps(32767.0f);
+        for (; i + 8 <= count; i += 8)
+        {
+            // clamped first: out of range conversions give INT_MIN, which would saturate the wrong way
+            __m128 scaled0 = _mm_min_ps(high, _mm_max_ps(low, _mm_mul_ps(_mm_loadu_ps(mix + i), gains)));
+            __m128 scaled1 = _mm_min_ps(high, _mm_max_ps(low, _mm_mul_ps(_mm_loadu_ps(mix + i + 4), gains)));
+            __m128i sum0 = _mm_cvtps_epi32(scaled0);
+            __m128i sum1 = _mm_cvtps_epi32(scaled1);
+            __m128i out = _mm_loadu_si128(reinterpret_cast<const __m128i *>(stream + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(stream + i), _mm_adds_epi16(out, _mm_packs_epi32(sum0, sum1)));
+        }
+#elif defined(AUDIO_MIX_WASM)
+        const v128_t gains = wasm_f32x4_splat(gain);
+        for (; i + 8 <= count; i += 8)
+        {
+            v128_t sum0 = wasm_i32x4_trunc_sat_f32x4(wasm_f32x4_nearest(wasm_f32x4_mul(wasm_v128_load(mix + i), gains)));
+            v128_t sum1 = wasm_i32x4_trunc_sat_f32x4(wasm_f32x4_nearest(wasm_f32x4_mul(wasm_v128_load(mix + i + 4), gains)));
+            v128_t out = wasm_v128_load(stream + i);
+            wasm_v128_store(stream + i, wasm_i16x8_add_sat(out, wasm_i16x8_narrow_i32x4(sum0, sum1)));
+        }
+#endif
+        AddToStreamScalar(stream + i, mix + i, count - i, gain);
+    }
+
+    static void AddToStreamScalar(int16_t *stream, const float *mix, size_t count, float gain)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            float sum = std::nearbyint(std::min(32767.0f, std::max(-32768.0f, mix[i] * gain)));
+            int out = stream[i] + static_cast<int>(sum);
+            stream[i] = static_cast<int16_t>(std::min(32767, std::max(-32768, out)));
+        }
+    }
+
+    // One-pole low-pass on interleaved stereo, coefficient in (0, 1] (1 passes everything); state carries
+    // the last output of each side to the next call
+    static void LowPass(float *mix, size_t frames, float coefficient, float state[2])
+    {
+        float left = state[0], right = state[1];
+        for (size_t i = 0; i < frames * 2; i += 2)
+        {
+            left += coefficient * (mix[i] - left);
+            right += coefficient * (mix[i + 1] - right);
+            mix[i] = left;
+            mix[i + 1] = right;
+        }
+        state[0] = left;
+        state[1] = right;
+    }
+
+    // LowPass's coefficient for a cutoff frequency
+    static float LowPassCoefficient(float cutoffHz, int sampleRate)
+    {
+        if (cutoffHz <= 0.0f || sampleRate <= 0)
+            return 1.0f;
+        return 1.0f - std::exp(-2.0f * 3.14159265f * cutoffHz / static_cast<float>(sampleRate));
+    }
+};
+
+
+#endif //MAIN_CPP_AUDIOMIX_H
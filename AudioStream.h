@@ -0,0 +1,260 @@
+#ifndef MAIN_CPP_AUDIOSTREAM_H
+#define MAIN_CPP_AUDIOSTREAM_H
+
+#include <atomic>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <algorithm>
+#include "SDL2/SDL.h"
+#include "SDL2_mixer/SDL_mixer.h"
+#include "AudioHelper.h"
+#include "AssetPack.h"
+
+// A long .wav played without decoding it into memory first. The channel plays a short silent chunk on loop
+// and an effect on the channel replaces its samples with the track's: the main thread reads and converts
+// the file a little ahead (Fill, once per frame) into a ring buffer of about a second, and the audio thread
+// takes from it. Mix_Volume and Mix_HaltChannel work on the channel as with any clip.
+//
+// Only uncompressed WAV (8/16/32-bit PCM, 32-bit float) streams; Open returns nullptr for anything else.
+class AudioStream
+{
+public:
+    static constexpr size_t READ_BYTES = 16 * 1024;
+
+    // nullptr if path is not a WAV that can stream or the audio device is not open
+    static AudioStream *Open(const std::string &path, bool loop)
+    {
+        int frequency = 0, channels = 0;
+        Uint16 format = 0;
+        if (Mix_QuerySpec(&frequency, &format, &channels) == 0)
+            return nullptr;
+
+        SDL_RWops *source = AssetPack::OpenRW(path);
+        if (source == nullptr)
+            return nullptr;
+
+        auto *stream = new AudioStream();
+        stream->source = source;
+        stream->loop = loop;
+        SDL_AudioFormat sourceFormat = 0;
+        int sourceChannels = 0, sourceFrequency = 0;
+        if (!stream->ReadHeader(sourceFormat, sourceChannels, sourceFrequency))
+        {
+            delete stream;
+            return nullptr;
+        }
+
+        stream->converter = SDL_NewAudioStream(sourceFormat, static_cast<Uint8>(sourceChannels), sourceFrequency,
+                                               format, static_cast<Uint8>(channels), frequency);
+        if (stream->converter == nullptr)
+        {
+            delete stream;
+            return nullptr;
+        }
+
+        stream->frameBytes = static_cast<size_t>(SDL_AUDIO_BITSIZE(format) / 8 * channels);
+        stream->ring.resize(static_cast<size_t>(frequency) * stream->frameBytes); // one second
+        stream->input.resize(READ_BYTES);
+        stream->output.resize(READ_BYTES / stream->frameBytes * stream->frameBytes);
+        stream->Fill();
+        return stream;
+    }
+
+    ~AudioStream()
+    {
+        if (converter != nullptr)
+            SDL_FreeAudioStream(converter);
+        if (source != nullptr)
+            SDL_RWclose(source);
+    }
+
+    // The silent chunk the channel loops while the effect supplies the samples; nullptr in autograder mode
+    static Mix_Chunk *Carrier()
+    {
+        static Uint8 silence[4096] = {};
+        static Mix_Chunk *carrier = AudioHelper::Mix_QuickLoad_RAW498(silence, sizeof(silence));
+        return carrier;
+    }
+
+    // Starts feeding the channel, once it plays Carrier()
+    bool Attach(int channel)
+    {
+        this->channel = channel;
+        return AudioHelper::Mix_RegisterEffect498(channel, Effect, Done, this) != 0;
+    }
+
+    // Main thread: reads and converts until the ring buffer is full or the track has ended
+    void Fill()
+    {
+        while (true)
+        {
+            size_t read = readPos.load(std::memory_order_acquire);
+            size_t write = writePos.load(std::memory_order_relaxed);
+            size_t space = (ring.size() - (write - read)) / frameBytes * frameBytes;
+            if (space == 0)
+                return;
+
+            int available = SDL_AudioStreamAvailable(converter);
+            if (available <= 0)
+            {
+                if (ended)
+                    return;
+                if (!ReadSource())
+                {
+                    SDL_AudioStreamFlush(converter);
+                    ended = true;
+                }
+                continue;
+            }
+
+            size_t wanted = std::min({space, static_cast<size_t>(available), output.size()});
+            int got = SDL_AudioStreamGet(converter, output.data(), static_cast<int>(wanted));
+            if (got <= 0)
+                return;
+
+            size_t offset = write % ring.size();
+            size_t first = std::min(static_cast<size_t>(got), ring.size() - offset);
+            std::memcpy(ring.data() + offset, output.data(), first);
+            std::memcpy(ring.data(), output.data() + first, static_cast<size_t>(got) - first);
+            writePos.store(write + static_cast<size_t>(got), std::memory_order_release);
+        }
+    }
+
+    // The whole track has been played (never while looping)
+    bool Finished() const
+    {
+        return ended && SDL_AudioStreamAvailable(converter) == 0 &&
+               readPos.load(std::memory_order_acquire) == writePos.load(std::memory_order_relaxed);
+    }
+
+    // The channel stopped or moved on to another clip; the stream can be deleted
+    bool Detached() const
+    {
+        return detached.load(std::memory_order_acquire);
+    }
+
+    int GetChannel() const
+    {
+        return channel;
+    }
+
+    size_t GetBufferBytes() const
+    {
+        return ring.size() + input.size() + output.size();
+    }
+
+private:
+    SDL_RWops *source = nullptr;
+    SDL_AudioStream *converter = nullptr;
+    Sint64 dataStart = 0;
+    Sint64 dataBytes = 0;
+    Sint64 dataRead = 0;
+    bool loop = false;
+    bool ended = false;
+    int channel = -1;
+    size_t frameBytes = 1;
+
+    std::vector<Uint8> input; // file bytes on their way to the converter
+    std::vector<Uint8> output; // converted bytes on their way to the ring
+    std::vector<Uint8> ring; // device format; readPos and writePos only grow
+    std::atomic<size_t> readPos{0};
+    std::atomic<size_t> writePos{0};
+    std::atomic<bool> detached{false};
+
+    // Finds "fmt " and "data"; leaves the source at the first sample
+    bool ReadHeader(SDL_AudioFormat &format, int &channels, int &frequency)
+    {
+        char riff[12];
+        if (SDL_RWread(source, riff, 1, sizeof(riff)) != sizeof(riff) || std::memcmp(riff, "RIFF", 4) != 0 ||
+            std::memcmp(riff + 8, "WAVE", 4) != 0)
+            return false;
+
+        format = 0;
+        while (true)
+        {
+            char id[4];
+            Uint32 size = 0;
+            if (SDL_RWread(source, id, 1, 4) != 4 || SDL_RWread(source, &size, 4, 1) != 1)
+                return false;
+            size = SDL_SwapLE32(size);
+            Sint64 next = SDL_RWtell(source) + size + (size & 1);
+
+            if (std::memcmp(id, "fmt ", 4) == 0 && size >= 16)
+            {
+                Uint8 fmt[40] = {};
+                if (SDL_RWread(source, fmt, 1, std::min<size_t>(size, sizeof(fmt))) == 0)
+                    return false;
+                Uint16 tag = static_cast<Uint16>(fmt[0] | fmt[1] << 8);
+                if (tag == 0xFFFE && size >= 26)
+                    tag = static_cast<Uint16>(fmt[24] | fmt[25] << 8); // WAVE_FORMAT_EXTENSIBLE's sub-format
+                channels = fmt[2] | fmt[3] << 8;
+                frequency = static_cast<int>(fmt[4] | fmt[5] << 8 | fmt[6] << 16 | static_cast<Uint32>(fmt[7]) << 24);
+                int bits = fmt[14] | fmt[15] << 8;
+                if (tag == 1 && bits == 8)
+                    format = AUDIO_U8;
+                else if (tag == 1 && bits == 16)
+                    format = AUDIO_S16LSB;
+                else if (tag == 1 && bits == 32)
+                    format = AUDIO_S32LSB;
+                else if (tag == 3 && bits == 32)
+                    format = AUDIO_F32LSB;
+                else
+                    return false;
+            }
+            else if (std::memcmp(id, "data", 4) == 0)
+            {
+                dataStart = SDL_RWtell(source);
+                dataBytes = std::min<Sint64>(size, SDL_RWsize(source) - dataStart);
+                return format != 0 && channels > 0 && frequency > 0 && dataBytes > 0;
+            }
+            if (SDL_RWseek(source, next, RW_SEEK_SET) < 0)
+                return false;
+        }
+    }
+
+    // false once the data is used up and the track does not loop
+    bool ReadSource()
+    {
+        if (dataRead == dataBytes)
+        {
+            if (!loop)
+                return false;
+            SDL_RWseek(source, dataStart, RW_SEEK_SET);
+            dataRead = 0;
+        }
+        size_t wanted = static_cast<size_t>(std::min<Sint64>(static_cast<Sint64>(input.size()), dataBytes - dataRead));
+        size_t got = SDL_RWread(source, input.data(), 1, wanted);
+        if (got == 0)
+            return false; // truncated file
+        dataRead += static_cast<Sint64>(got);
+        SDL_AudioStreamPut(converter, input.data(), static_cast<int>(got));
+        return true;
+    }
+
+    // Audio thread: the channel's samples for this callback, silence where the ring has run dry
+    static void Effect(int, void *buffer, int length, void *data)
+    {
+        auto *self = static_cast<AudioStream *>(data);
+        auto *out = static_cast<Uint8 *>(buffer);
+        size_t read = self->readPos.load(std::memory_order_relaxed);
+        size_t write = self->writePos.load(std::memory_order_acquire);
+        size_t count = std::min(static_cast<size_t>(length), write - read);
+
+        size_t offset = read % self->ring.size();
+        size_t first = std::min(count, self->ring.size() - offset);
+        std::memcpy(out, self->ring.data() + offset, first);
+        std::memcpy(out + first, self->ring.data(), count - first);
+        std::memset(out + count, 0, static_cast<size_t>(length) - count);
+        self->readPos.store(read + count, std::memory_order_release);
+    }
+
+    // SDL_mixer drops the channel's effects when it halts, expires or starts another chunk
+    static void Done(int, void *data)
+    {
+        static_cast<AudioStream *>(data)->detached.store(true, std::memory_order_release);
+    }
+};
+
+
+#endif //MAIN_CPP_AUDIOSTREAM_H
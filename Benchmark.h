@@ -0,0 +1,175 @@
+#ifndef MAIN_CPP_BENCHMARK_H
+#define MAIN_CPP_BENCHMARK_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <numeric>
+#include <atomic>
+#if !defined(_WIN32)
+#include <sys/resource.h>
+#endif
+#include "LuaStats.h"
+
+// Frame time, allocation and memory report for the bench/ suite.
+//
+// Build with -DENGINE_BENCHMARK (cmake -DENGINE_BENCHMARK=ON) to enable it. Without it the BENCHMARK_*
+// macros expand to nothing and operator new is not replaced. Only main.cpp may include this header.
+//
+// When the engine exits, the report is written as JSON to ENGINE_BENCHMARK_REPORT
+// (default "benchmark_report.json"). The first ENGINE_BENCHMARK_WARMUP frames (default 10) are not counted.
+class Benchmark
+{
+public:
+    static inline std::vector<float> frameTimesMs;
+    // operator new calls; atomic since the frame capture writer allocates on its own thread
+    static inline std::atomic<uint64_t> allocations{0};
+    static inline std::atomic<uint64_t> allocatedBytes{0};
+
+    static void BeginFrame()
+    {
+        frameStart = std::chrono::steady_clock::now();
+        if (frameCount++ == GetWarmupFrames())
+        {
+            // steady state starts here
+            allocations = 0;
+            allocatedBytes = 0;
+            luaAllocationsAtStart = LuaStats::allocations;
+        }
+    }
+
+    static void EndFrame()
+    {
+        if (frameCount <= GetWarmupFrames())
+            return;
+
+        frameTimesMs.push_back(std::chrono::duration<float, std::milli>(
+                std::chrono::steady_clock::now() - frameStart).count());
+    }
+
+    // Registered with atexit, so Application.Quit() (which calls exit) is covered too
+    static void WriteReport()
+    {
+        const char *env = std::getenv("ENGINE_BENCHMARK_REPORT");
+        std::string path = env ? env : "benchmark_report.json";
+
+        std::ofstream file(path, std::ios::out | std::ios::trunc);
+        if (!file.is_open())
+        {
+            std::cout << "error: failed to open " << path << " for writing" << std::endl;
+            return;
+        }
+
+        std::vector<float> sorted = frameTimesMs;
+        std::sort(sorted.begin(), sorted.end());
+        size_t frames = sorted.size();
+        double mean = frames ? std::accumulate(sorted.begin(), sorted.end(), 0.0) / frames : 0.0;
+        uint64_t luaAllocations = LuaStats::allocations - luaAllocationsAtStart;
+
+        file << std::fixed << std::setprecision(4);
+        file << "{\n"
+             << "  \"frames\": " << frames << ",\n"
+             << "  \"warmup_frames\": " << GetWarmupFrames() << ",\n"
+             << "  \"frame_ms\": {\"mean\": " << mean << ", \"p50\": " << Percentile(sorted, 0.50)
+             << ", \"p99\": " << Percentile(sorted, 0.99) << ", \"max\": " << (frames ? sorted.back() : 0.0f)
+             << "},\n"
+             << "  \"allocations\": {\"count\": " << allocations << ", \"bytes\": " << allocatedBytes
+             << ", \"per_frame\": " << (frames ? static_cast<double>(allocations.load()) / frames : 0.0)
+             << ", \"lua_count\": " << luaAllocations
+             << ", \"lua_per_frame\": " << (frames ? static_cast<double>(luaAllocations) / frames : 0.0) << "},\n"
+             << "  \"peak_rss_kb\": " << GetPeakRssKb() << ",\n"
+             << "  \"lua_peak_kb\": " << LuaStats::peakBytes / 1024 << "\n"
+             << "}\n";
+    }
+
+private:
+    static inline std::chrono::steady_clock::time_point frameStart;
+    static inline int frameCount = 0;
+    static inline uint64_t luaAllocationsAtStart = 0;
+
+    static int GetWarmupFrames()
+    {
+        static const int warmup = std::getenv("ENGINE_BENCHMARK_WARMUP") ?
+                                  std::atoi(std::getenv("ENGINE_BENCHMARK_WARMUP")) : 10;
+        return warmup;
+    }
+
+    // nearest rank
+    static float Percentile(const std::vector<float> &sorted, double p)
+    {
+        if (sorted.empty())
+            return 0.0f;
+        size_t rank = static_cast<size_t>(p * sorted.size() + 0.5);
+        return sorted[std::min(sorted.size() - 1, rank > 0 ? rank - 1 : 0)];
+    }
+
+    static long GetPeakRssKb()
+    {
+#if !defined(_WIN32)
+        rusage usage{};
+        if (getrusage(RUSAGE_SELF, &usage) == 0)
+#if defined(__APPLE__)
+            return usage.ru_maxrss / 1024; // bytes on macOS
+#else
+            return usage.ru_maxrss;
+#endif
+#endif
+        return 0;
+    }
+};
+
+#ifdef ENGINE_BENCHMARK
+
+// Counting replacements of the global allocation functions (the nothrow forms forward here)
+void *operator new(std::size_t size)
+{
+    Benchmark::allocations.fetch_add(1, std::memory_order_relaxed);
+    Benchmark::allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void *block = std::malloc(size ? size : 1))
+        return block;
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *block) noexcept
+{
+    std::free(block);
+}
+
+void operator delete[](void *block) noexcept
+{
+    std::free(block);
+}
+
+void operator delete(void *block, std::size_t) noexcept
+{
+    std::free(block);
+}
+
+void operator delete[](void *block, std::size_t) noexcept
+{
+    std::free(block);
+}
+
+#define BENCHMARK_BEGIN_FRAME() Benchmark::BeginFrame()
+#define BENCHMARK_END_FRAME() Benchmark::EndFrame()
+#define BENCHMARK_REGISTER_REPORT() std::atexit(Benchmark::WriteReport)
+#else
+#define BENCHMARK_BEGIN_FRAME()
+#define BENCHMARK_END_FRAME()
+#define BENCHMARK_REGISTER_REPORT()
+#endif
+
+
+#endif //MAIN_CPP_BENCHMARK_H
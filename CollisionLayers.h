@@ -0,0 +1,166 @@
+#ifndef MAIN_CPP_COLLISIONLAYERS_H
+#define MAIN_CPP_COLLISIONLAYERS_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sstream>
+#include "rapidjson/document.h"
+#include "box2d.h"
+
+// Named collision layers, loaded from the "collision_layers" object in game.config:
+//
+//   "collision_layers": {
+//       "default": ["default", "player", "enemy"],
+//       "player": ["enemy_bullet"],
+//       "bullet": ["enemy"]
+//   }
+//
+// Every layer owns one bit of b2Filter::categoryBits, so at most 16 layers exist.
+// Pairs are symmetric: listing "enemy" under "bullet" is enough for both to collide.
+// Without a "collision_layers" entry there is only "default", which collides with everything.
+class CollisionLayers
+{
+public:
+    static constexpr int MAX_LAYERS = 16;
+    static constexpr uint16 ALL_LAYERS = 0xFFFF;
+
+    static inline std::vector<std::string> layerNames = {"default"};
+    static inline std::vector<uint16> layerMasks = {ALL_LAYERS}; // layerMasks[i] = layers that layer i collides with
+
+    static void LoadFromConfig(const rapidjson::Document &gameConfig)
+    {
+        if (!gameConfig.HasMember("collision_layers") || !gameConfig["collision_layers"].IsObject())
+            return;
+
+        const auto &matrix = gameConfig["collision_layers"];
+
+        // First pass: register every layer name, whether it appears as a key or inside a list
+        layerNames = {"default"};
+        for (const auto &row: matrix.GetObject())
+        {
+            RegisterLayer(row.name.GetString());
+            if (row.value.IsArray())
+            {
+                for (const auto &other: row.value.GetArray())
+                {
+                    if (other.IsString())
+                        RegisterLayer(other.GetString());
+                }
+            }
+        }
+
+        // Second pass: build the (symmetric) layer matrix. Layers past MAX_LAYERS were reported and are skipped.
+        layerMasks.assign(layerNames.size(), 0);
+        for (const auto &row: matrix.GetObject())
+        {
+            int layer = GetLayerIndex(row.name.GetString());
+            if (layer == -1 || !row.value.IsArray())
+                continue;
+
+            for (const auto &other: row.value.GetArray())
+            {
+                if (!other.IsString())
+                    continue;
+
+                int otherLayer = GetLayerIndex(other.GetString());
+                if (otherLayer == -1)
+                    continue;
+                layerMasks[layer] |= static_cast<uint16>(1u << otherLayer);
+                layerMasks[otherLayer] |= static_cast<uint16>(1u << layer);
+            }
+        }
+
+        // an undeclared "default" layer keeps the old behaviour of colliding with everything
+        if (!matrix.HasMember("default"))
+        {
+            layerMasks[0] = ALL_LAYERS;
+            for (auto &mask: layerMasks)
+                mask |= 0x0001;
+        }
+    }
+
+    // Returns -1 if the layer has not been declared
+    static int GetLayerIndex(const std::string &name)
+    {
+        for (size_t i = 0; i < layerNames.size(); i++)
+        {
+            if (layerNames[i] == name)
+                return static_cast<int>(i);
+        }
+        return -1;
+    }
+
+    static uint16 GetCategoryBits(const std::string &layer)
+    {
+        return static_cast<uint16>(1u << ResolveLayer(layer));
+    }
+
+    // Layers this layer collides with according to the game.config matrix
+    static uint16 GetMaskBits(const std::string &layer)
+    {
+        return layerMasks[ResolveLayer(layer)];
+    }
+
+    // Parse a comma separated list of layer names ("player,enemy") into a bit mask.
+    // "*" selects every layer. An empty string selects none.
+    static uint16 ParseMask(const std::string &layers)
+    {
+        if (layers == "*")
+            return ALL_LAYERS;
+
+        uint16 mask = 0;
+        std::stringstream stream(layers);
+        std::string name;
+        while (std::getline(stream, name, ','))
+        {
+            name.erase(0, name.find_first_not_of(' '));
+            name.erase(name.find_last_not_of(' ') + 1);
+            if (!name.empty())
+                mask |= static_cast<uint16>(1u << ResolveLayer(name));
+        }
+        return mask;
+    }
+
+private:
+    static void RegisterLayer(const std::string &name)
+    {
+        if (GetLayerIndex(name) != -1)
+            return;
+
+        if (static_cast<int>(layerNames.size()) >= MAX_LAYERS)
+        {
+            std::cout << "error: too many collision layers, " << name << " ignored" << std::endl;
+            return;
+        }
+        layerNames.push_back(name);
+    }
+
+    static int ResolveLayer(const std::string &name)
+    {
+        int index = GetLayerIndex(name);
+        if (index == -1)
+        {
+            std::cout << "error: unknown collision layer " << name << std::endl;
+            return 0; // fall back to "default"
+        }
+        return index;
+    }
+};
+
+// Colliders only ever touch colliders and triggers only ever touch triggers.
+// Everything else is decided by the layer bits, so uninteresting pairs never leave the broad phase.
+class LayerContactFilter : public b2ContactFilter
+{
+public:
+    bool ShouldCollide(b2Fixture *fixtureA, b2Fixture *fixtureB) override
+    {
+        if (fixtureA->IsSensor() != fixtureB->IsSensor())
+            return false;
+
+        return b2ContactFilter::ShouldCollide(fixtureA, fixtureB);
+    }
+};
+
+
+#endif //MAIN_CPP_COLLISIONLAYERS_H
@@ -0,0 +1,471 @@
+#ifndef MAIN_CPP_COMPILEDSCENE_H
+#define MAIN_CPP_COMPILEDSCENE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <filesystem>
+#include "rapidjson/document.h"
+#include "AssetPack.h"
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define COMPILED_SCENE_MMAP
+#endif
+
+// Binary form of a .scene file together with every template it uses, written by tools/scene_compile
+// (resources/scenes/<name>.scenec next to <name>.scene). Loading one walks fixed-size records instead of
+// parsing text, and the rapidjson values it builds point into the mapped file rather than copying strings.
+//
+//   header                CompiledSceneHeader
+//   string offsets        uint32 × (stringCount + 1), into the string data
+//   string data           NUL-terminated
+//   nodes                 CompiledSceneNode × nodeCount; children of a node are contiguous
+//   templates             (name string, root node) uint32 pairs × templateCount
+//
+// All little-endian. The engine only uses a .scenec that is at least as new as its .scene and every template
+// baked into it, and has this VERSION; otherwise it parses the JSON.
+struct CompiledSceneHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t stringCount;
+    uint32_t stringBytes;
+    uint32_t nodeCount;
+    uint32_t templateCount;
+    uint32_t sceneRoot;
+    uint32_t reserved;
+};
+
+struct CompiledSceneNode
+{
+    enum Type : uint8_t
+    {
+        NODE_NULL,
+        NODE_FALSE,
+        NODE_TRUE,
+        NODE_INT,
+        NODE_DOUBLE,
+        NODE_STRING,
+        NODE_ARRAY,
+        NODE_OBJECT
+    };
+
+    uint8_t type;
+    uint8_t padding[3];
+    uint32_t name; // member name in the parent object, NO_NAME in arrays
+    union
+    {
+        int64_t integer;
+        double number;
+        uint32_t string;
+        struct
+        {
+            uint32_t first;
+            uint32_t count;
+        } children;
+    };
+};
+static_assert(sizeof(CompiledSceneNode) == 16, "compiled scene nodes are fixed size");
+
+class CompiledScene
+{
+public:
+    static constexpr char MAGIC[4] = {'S', 'C', 'N', 'B'};
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint32_t NO_NAME = 0xFFFFFFFF;
+
+    using Templates = std::unordered_map<std::string, rapidjson::Document>;
+
+    CompiledScene() = default;
+    CompiledScene(const CompiledScene &) = delete;
+    CompiledScene &operator=(const CompiledScene &) = delete;
+
+    ~CompiledScene()
+    {
+        Close();
+    }
+
+    static std::string PathFor(const std::string &scenePath)
+    {
+        return scenePath + "c";
+    }
+
+    // A compiled file that is at least as new as the JSON one; tools/asset_pack only packs those.
+    // Its templates are only known once it is read, so Load checks those.
+    static bool IsUpToDate(const std::string &scenePath)
+    {
+        if (AssetPack::Contains(PathFor(scenePath)))
+            return true;
+
+        std::error_code error;
+        auto compiledTime = std::filesystem::last_write_time(PathFor(scenePath), error);
+        if (error)
+            return false;
+        auto sceneTime = std::filesystem::last_write_time(scenePath, error);
+        return error || compiledTime >= sceneTime;
+    }
+
+    // Builds the scene and template documents. Their strings point into the file, which stays mapped until
+    // this object is destroyed, so the documents must not outlive it.
+    bool Load(const std::string &path, rapidjson::Document &scene, Templates &templates)
+    {
+        Close();
+        AssetPack::Asset asset{};
+        bool packed = AssetPack::Find(path, asset);
+        if (packed)
+        {
+            data = reinterpret_cast<const uint8_t *>(asset.data); // 16-byte aligned in the pack
+            size = asset.size;
+            mapped = false;
+        }
+        else if (!Map(path))
+        {
+            return false;
+        }
+        if (!Validate() || (!packed && !TemplatesUpToDate(path)))
+            return false;
+
+        BuildDocument(header->sceneRoot, scene);
+        for (uint32_t i = 0; i < header->templateCount; i++)
+        {
+            const uint32_t *entry = templateTable + i * 2;
+            BuildDocument(entry[1], templates[GetString(entry[0])]);
+        }
+        return true;
+    }
+
+    // Compiles a scene and its templates; false if the file can't be written
+    static bool Write(const std::string &path, const rapidjson::Value &scene, const Templates &templates)
+    {
+        Writer writer;
+        uint32_t sceneRoot = writer.AddRoot(scene);
+        std::vector<uint32_t> templateTable;
+        for (const auto &entry: templates)
+        {
+            templateTable.push_back(writer.Intern(entry.first));
+            templateTable.push_back(writer.AddRoot(entry.second));
+        }
+
+        CompiledSceneHeader fileHeader{};
+        std::memcpy(fileHeader.magic, MAGIC, sizeof(MAGIC));
+        fileHeader.version = VERSION;
+        fileHeader.stringCount = static_cast<uint32_t>(writer.stringOffsets.size());
+        fileHeader.stringBytes = static_cast<uint32_t>(writer.stringData.size());
+        fileHeader.nodeCount = static_cast<uint32_t>(writer.nodes.size());
+        fileHeader.templateCount = static_cast<uint32_t>(templates.size());
+        fileHeader.sceneRoot = sceneRoot;
+
+        writer.stringOffsets.push_back(fileHeader.stringBytes);
+        while (writer.stringData.size() % 8 != 0)
+            writer.stringData.push_back('\0'); // keeps the nodes aligned
+
+        FILE *file = std::fopen(path.c_str(), "wb");
+        if (file == nullptr)
+            return false;
+        std::fwrite(&fileHeader, sizeof(fileHeader), 1, file);
+        std::fwrite(writer.stringOffsets.data(), sizeof(uint32_t), writer.stringOffsets.size(), file);
+        if (writer.stringOffsets.size() % 2 != 0)
+        {
+            uint32_t pad = 0;
+            std::fwrite(&pad, sizeof(pad), 1, file);
+        }
+        std::fwrite(writer.stringData.data(), 1, writer.stringData.size(), file);
+        std::fwrite(writer.nodes.data(), sizeof(CompiledSceneNode), writer.nodes.size(), file);
+        std::fwrite(templateTable.data(), sizeof(uint32_t), templateTable.size(), file);
+        return std::fclose(file) == 0;
+    }
+
+private:
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+    std::vector<uint8_t> buffer; // without mmap
+    bool mapped = false; // false when the data lives in resources.pak
+    const CompiledSceneHeader *header = nullptr;
+    const uint32_t *stringOffsets = nullptr;
+    const char *strings = nullptr;
+    const CompiledSceneNode *nodes = nullptr;
+    const uint32_t *templateTable = nullptr;
+
+    // Flattens documents into nodes, breadth first so that the children of every node are contiguous
+    struct Writer
+    {
+        std::vector<CompiledSceneNode> nodes;
+        std::vector<uint32_t> stringOffsets;
+        std::string stringData;
+        std::unordered_map<std::string, uint32_t> stringIds;
+
+        uint32_t Intern(const std::string &string)
+        {
+            auto it = stringIds.find(string);
+            if (it != stringIds.end())
+                return it->second;
+
+            uint32_t id = static_cast<uint32_t>(stringOffsets.size());
+            stringOffsets.push_back(static_cast<uint32_t>(stringData.size()));
+            stringData.append(string);
+            stringData.push_back('\0');
+            stringIds.emplace(string, id);
+            return id;
+        }
+
+        uint32_t AddRoot(const rapidjson::Value &value)
+        {
+            uint32_t root = static_cast<uint32_t>(nodes.size());
+            nodes.push_back(MakeNode(value, NO_NAME));
+            std::vector<std::pair<uint32_t, const rapidjson::Value *>> pending = {{root, &value}};
+            for (size_t i = 0; i < pending.size(); i++)
+            {
+                uint32_t index = pending[i].first;
+                const rapidjson::Value &parent = *pending[i].second;
+                if (parent.IsObject())
+                {
+                    nodes[index].children.first = static_cast<uint32_t>(nodes.size());
+                    for (const auto &member: parent.GetObject())
+                    {
+                        pending.emplace_back(static_cast<uint32_t>(nodes.size()), &member.value);
+                        nodes.push_back(MakeNode(member.value, Intern(member.name.GetString())));
+                    }
+                }
+                else if (parent.IsArray())
+                {
+                    nodes[index].children.first = static_cast<uint32_t>(nodes.size());
+                    for (const auto &element: parent.GetArray())
+                    {
+                        pending.emplace_back(static_cast<uint32_t>(nodes.size()), &element);
+                        nodes.push_back(MakeNode(element, NO_NAME));
+                    }
+                }
+            }
+            return root;
+        }
+
+        CompiledSceneNode MakeNode(const rapidjson::Value &value, uint32_t name)
+        {
+            CompiledSceneNode node{};
+            node.name = name;
+            if (value.IsObject() || value.IsArray())
+            {
+                node.type = value.IsObject() ? CompiledSceneNode::NODE_OBJECT : CompiledSceneNode::NODE_ARRAY;
+                node.children.count = value.IsObject() ? value.MemberCount() : value.Size();
+            }
+            else if (value.IsString())
+            {
+                node.type = CompiledSceneNode::NODE_STRING;
+                node.string = Intern(std::string(value.GetString(), value.GetStringLength()));
+            }
+            else if (value.IsInt64())
+            {
+                node.type = CompiledSceneNode::NODE_INT;
+                node.integer = value.GetInt64();
+            }
+            else if (value.IsNumber())
+            {
+                node.type = CompiledSceneNode::NODE_DOUBLE;
+                node.number = value.GetDouble();
+            }
+            else if (value.IsBool())
+            {
+                node.type = value.GetBool() ? CompiledSceneNode::NODE_TRUE : CompiledSceneNode::NODE_FALSE;
+            }
+            else
+            {
+                node.type = CompiledSceneNode::NODE_NULL;
+            }
+            return node;
+        }
+    };
+
+    bool Map(const std::string &path)
+    {
+#ifdef COMPILED_SCENE_MMAP
+        int descriptor = open(path.c_str(), O_RDONLY);
+        if (descriptor < 0)
+            return false;
+        struct stat status{};
+        if (fstat(descriptor, &status) != 0 || status.st_size == 0)
+        {
+            close(descriptor);
+            return false;
+        }
+        void *mapping = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+        close(descriptor);
+        if (mapping == MAP_FAILED)
+            return false;
+        data = static_cast<const uint8_t *>(mapping);
+        size = static_cast<size_t>(status.st_size);
+        mapped = true;
+#else
+        FILE *file = std::fopen(path.c_str(), "rb");
+        if (file == nullptr)
+            return false;
+        std::fseek(file, 0, SEEK_END);
+        buffer.resize(static_cast<size_t>(std::ftell(file)));
+        std::fseek(file, 0, SEEK_SET);
+        size_t read = std::fread(buffer.data(), 1, buffer.size(), file);
+        std::fclose(file);
+        if (read != buffer.size() || buffer.empty())
+            return false;
+        data = buffer.data();
+        size = buffer.size();
+#endif
+        return true;
+    }
+
+    void Close()
+    {
+#ifdef COMPILED_SCENE_MMAP
+        if (data != nullptr && mapped)
+            munmap(const_cast<uint8_t *>(data), size);
+#endif
+        buffer.clear();
+        data = nullptr;
+        size = 0;
+    }
+
+    // Checks every offset once, so building the documents needs no bounds checks
+    bool Validate()
+    {
+        if (size < sizeof(CompiledSceneHeader))
+            return false;
+        header = reinterpret_cast<const CompiledSceneHeader *>(data);
+        if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->version != VERSION)
+            return false;
+
+        uint64_t offsetWords = uint64_t(header->stringCount) + 1 + (uint64_t(header->stringCount) + 1) % 2;
+        uint64_t stringBytes = (uint64_t(header->stringBytes) + 7) / 8 * 8;
+        uint64_t expected = sizeof(CompiledSceneHeader) + offsetWords * 4 + stringBytes +
+                            uint64_t(header->nodeCount) * sizeof(CompiledSceneNode) + uint64_t(header->templateCount) * 8;
+        if (expected != size || header->sceneRoot >= header->nodeCount)
+            return false;
+
+        stringOffsets = reinterpret_cast<const uint32_t *>(data + sizeof(CompiledSceneHeader));
+        strings = reinterpret_cast<const char *>(stringOffsets + offsetWords);
+        nodes = reinterpret_cast<const CompiledSceneNode *>(strings + stringBytes);
+        templateTable = reinterpret_cast<const uint32_t *>(nodes + header->nodeCount);
+
+        for (uint32_t i = 0; i < header->stringCount; i++)
+        {
+            if (stringOffsets[i] >= stringOffsets[i + 1] || stringOffsets[i + 1] > header->stringBytes ||
+                strings[stringOffsets[i + 1] - 1] != '\0')
+                return false;
+        }
+        for (uint32_t i = 0; i < header->nodeCount; i++)
+        {
+            const CompiledSceneNode &node = nodes[i];
+            if (node.name != NO_NAME && node.name >= header->stringCount)
+                return false;
+            if (node.type == CompiledSceneNode::NODE_STRING && node.string >= header->stringCount)
+                return false;
+            // children always come after their parent, so the documents can't nest forever
+            if ((node.type == CompiledSceneNode::NODE_ARRAY || node.type == CompiledSceneNode::NODE_OBJECT) &&
+                (node.children.first <= i ||
+                 uint64_t(node.children.first) + node.children.count > header->nodeCount))
+                return false;
+            // object members are looked up by name when the documents are built
+            for (uint32_t j = 0; node.type == CompiledSceneNode::NODE_OBJECT && j < node.children.count; j++)
+            {
+                if (nodes[node.children.first + j].name == NO_NAME)
+                    return false;
+            }
+            if (node.type > CompiledSceneNode::NODE_OBJECT)
+                return false;
+        }
+        for (uint32_t i = 0; i < header->templateCount; i++)
+        {
+            if (templateTable[i * 2] >= header->stringCount || templateTable[i * 2 + 1] >= header->nodeCount)
+                return false;
+        }
+        return true;
+    }
+
+    // No template file was written after the compiled one; a missing template file counts as unchanged
+    bool TemplatesUpToDate(const std::string &path) const
+    {
+        std::error_code error;
+        auto compiledTime = std::filesystem::last_write_time(path, error);
+        if (error)
+            return true;
+        // resources/scenes/<name>.scenec -> resources/actor_templates
+        std::filesystem::path templates = std::filesystem::path(path).parent_path().parent_path() / "actor_templates";
+        for (uint32_t i = 0; i < header->templateCount; i++)
+        {
+            auto templatePath = templates / (std::string(GetString(templateTable[i * 2])) + ".template");
+            auto templateTime = std::filesystem::last_write_time(templatePath, error);
+            if (!error && templateTime > compiledTime)
+                return false;
+        }
+        return true;
+    }
+
+    // Replays a node tree as SAX events into a document (Document::Populate), the way parsing builds one:
+    // every object and array is allocated once at its final size, and strings are not copied
+    struct Generator
+    {
+        const CompiledScene &scene;
+        uint32_t root;
+
+        bool operator()(rapidjson::Document &document) const
+        {
+            return Emit(root, document);
+        }
+
+        bool Emit(uint32_t index, rapidjson::Document &document) const
+        {
+            const CompiledSceneNode &node = scene.nodes[index];
+            switch (node.type)
+            {
+                case CompiledSceneNode::NODE_FALSE:
+                    return document.Bool(false);
+                case CompiledSceneNode::NODE_TRUE:
+                    return document.Bool(true);
+                case CompiledSceneNode::NODE_INT:
+                    return document.Int64(node.integer);
+                case CompiledSceneNode::NODE_DOUBLE:
+                    return document.Double(node.number);
+                case CompiledSceneNode::NODE_STRING:
+                    return document.String(scene.GetString(node.string), scene.GetLength(node.string), false);
+                case CompiledSceneNode::NODE_ARRAY:
+                    document.StartArray();
+                    for (uint32_t i = 0; i < node.children.count; i++)
+                        Emit(node.children.first + i, document);
+                    return document.EndArray(node.children.count);
+                case CompiledSceneNode::NODE_OBJECT:
+                    document.StartObject();
+                    for (uint32_t i = 0; i < node.children.count; i++)
+                    {
+                        uint32_t name = scene.nodes[node.children.first + i].name;
+                        document.Key(scene.GetString(name), scene.GetLength(name), false);
+                        Emit(node.children.first + i, document);
+                    }
+                    return document.EndObject(node.children.count);
+                default:
+                    return document.Null();
+            }
+        }
+    };
+
+    void BuildDocument(uint32_t root, rapidjson::Document &document) const
+    {
+        Generator generator{*this, root};
+        document.Populate(generator);
+    }
+
+    const char *GetString(uint32_t id) const
+    {
+        return strings + stringOffsets[id];
+    }
+
+    rapidjson::SizeType GetLength(uint32_t id) const
+    {
+        return stringOffsets[id + 1] - stringOffsets[id] - 1;
+    }
+};
+
+
+#endif //MAIN_CPP_COMPILEDSCENE_H
@@ -16,6 +16,8 @@
 #include "Input.h"
 #include "Renderer.h"
 #include "AudioManager.h"
+#include "VoiceManager.h"
+#include "SpatialAudio.h"
 #include "glm/glm.hpp"
 #include "LuaMananger.h"
 #include "Lua/lua.hpp"
@@ -23,7 +25,10 @@
 #include "box2d.h"
 #include "Rigidbody.h"
 #include "Raycast.h"
+#include "PhysicsSnapshot.h"
+#include "Determinism.h"
 #include "EventBus.h"
+#include "InstantiationQueue.h"
 
 
 class ComponentManager
@@ -38,6 +43,8 @@ public:
     static inline std::vector<Actor *> actors_to_remove;
     static inline std::vector<Actor *> actors_not_to_destroy;
 
+    static inline std::unordered_map<std::string, rapidjson::Document> actorTemplates; // by template name
+
     ComponentManager()
     {
         Initialize(); // Ensure Lua state is initialized upon construction
@@ -60,6 +67,15 @@ public:
         std::cerr << message << std::endl;
     }
 
+    // lua_newstate installs no panic handler (luaL_newstate would), so report unprotected errors ourselves
+    static int Panic(lua_State *L)
+    {
+        const char *message = lua_tostring(L, -1);
+        std::cout << "error: unprotected error in Lua: " << (message ? message : "(error object is not a string)")
+                  << std::endl;
+        return 0; // Lua aborts after this
+    }
+
     static void
     ApplyTemplateComponentOverrides(lua_State *L, const std::string &componentName,
                                     const rapidjson::Value &componentValue)
@@ -196,18 +212,55 @@ public:
             std::cout << actor_template_name << std::endl;
         }
         
-        std::string path = "resources/actor_templates/" + actor_template_name + ".template";
-        // std::cout << "path: " << path << std::endl;
         auto *actor = new Actor(actor_template_name);
+        const rapidjson::Document &doc = GetActorTemplate(actor_template_name);
+        if (doc.HasMember("name") && doc["name"].IsString())
+        {
+            actor->name = doc["name"].GetString();
+        }
 
-        rapidjson::Document doc;
-        EngineUtils::ReadJsonFile(path, doc);
+        InstantiateFromTemplate(actor, doc, nullptr);
+        return actor;
+    }
 
+    // Actor.InstantiateDeferred(template, props): the actor now, its components from the InstantiationQueue
+    static Actor *InstantiateActorDeferred(const std::string &templateName, luabridge::LuaRef props)
+    {
+        auto *actor = new Actor(templateName);
+        const rapidjson::Document &doc = GetActorTemplate(templateName);
         if (doc.HasMember("name") && doc["name"].IsString())
         {
             actor->name = doc["name"].GetString();
         }
 
+        InstantiationQueue::Enqueue(actor, doc, props);
+        return actor;
+    }
+
+    // Called by InstantiationQueue::Update
+    static void FinishDeferredInstantiation(InstantiationQueue::Entry &entry)
+    {
+        InstantiateFromTemplate(entry.actor, *entry.actorTemplate, &entry.props);
+    }
+
+    // Each template is read once; the documents live as long as the engine
+    static const rapidjson::Document &GetActorTemplate(const std::string &templateName)
+    {
+        auto it = actorTemplates.find(templateName);
+        if (it != actorTemplates.end())
+            return it->second;
+
+        rapidjson::Document &doc = actorTemplates[templateName];
+        EngineUtils::ReadJsonFile("resources/actor_templates/" + templateName + ".template", doc);
+        return doc;
+    }
+
+    // Gives the actor the template's components, with props ({ [component key] = { property = value } })
+    // applied over the template's values, and queues it to join the scene
+    static void InstantiateFromTemplate(Actor *actor, const rapidjson::Document &doc, const luabridge::LuaRef *props)
+    {
+        actor->updatePolicyFromJson(doc);
+
         std::map<std::string, luabridge::LuaRef *> components;
 
         if (doc.HasMember("components") && doc["components"].IsObject())
@@ -223,7 +276,7 @@ public:
                 if (componentType != "Rigidbody")
                 {
                     // Check if the component Lua file exists
-                    if (!std::filesystem::exists(componentPath))
+                    if (!AssetPack::Exists(componentPath))
                     {
                         std::cout << "error: failed to locate component " << componentType;
                         exit(0);
@@ -231,7 +284,7 @@ public:
 
                     const std::string path = "resources/component_types/" + componentType + ".lua";
 
-                    if (luaL_dofile(LuaManager::lua_state, path.c_str()) != LUA_OK)
+                    if (LuaManager::DoFile(path) != LUA_OK)
                     {
                         std::cout << "problem with lua file " << componentType;
                         exit(0);
@@ -302,6 +355,8 @@ public:
             }
 
             actor->components = std::move(components);
+            if (props != nullptr)
+                ApplyInstantiationProps(actor, *props);
 
             // Add the newly created component to the actor's component list for componentsOnStart and componentsOnUpdate
             for (const auto &component: actor->components)
@@ -321,12 +376,27 @@ public:
             actorTable.push_back(actor);
             actors_to_add.push_back(actor);
         }
+    }
 
-        return actor;
-    };
+    static void ApplyInstantiationProps(Actor *actor, const luabridge::LuaRef &props)
+    {
+        if (!props.isTable())
+            return;
+
+        for (luabridge::Iterator entry(props); !entry.isNil(); ++entry)
+        {
+            auto component = actor->components.find(entry.key().tostring());
+            if (component == actor->components.end() || !entry.value().isTable())
+                continue;
+            for (luabridge::Iterator property(entry.value()); !property.isNil(); ++property)
+                (*component->second)[property.key()] = property.value();
+        }
+    }
 
     static void DestroyActor(Actor *actor)
     {
+        InstantiationQueue::Cancel(actor); // deleted with the others at the end of the frame
+        SpatialAudio::DetachActor(actor);
         actors_to_remove.push_back(actor);
 
         // remove it from the actors_to_add - for the case that the actor is added and removed in the same frame
@@ -387,7 +457,8 @@ public:
 
 void ComponentManager::Initialize()
 {
-    LuaManager::lua_state = luaL_newstate(); // create a Lua state
+    LuaManager::lua_state = lua_newstate(LuaStats::Allocate, nullptr); // create a Lua state, counting its memory
+    lua_atpanic(LuaManager::lua_state, ComponentManager::Panic);
     luaL_openlibs(LuaManager::lua_state); // load libs
 
     // Registering Debug namespace
@@ -396,6 +467,10 @@ void ComponentManager::Initialize()
             .beginNamespace("Debug")
             .addFunction("Log", ComponentManager::Print)
             .addFunction("LogError", ComponentManager::PrintError)
+            .addFunction("GetStats", LuaStats::GetStats)
+            .addFunction("DumpStats", LuaStats::DumpStats)
+            .addFunction("ResetStats", LuaStats::ResetStats)
+            .addFunction("GetInstantiationStats", InstantiationQueue::GetStats)
             .endNamespace();
 
     // glm::vec2 instances
@@ -416,6 +491,8 @@ void ComponentManager::Initialize()
             .addFunction("GetComponents", &Actor::GetComponents)
             .addFunction("AddComponent", &Actor::AddComponent)
             .addFunction("RemoveComponent", &Actor::RemoveComponent)
+            .addFunction("SetUpdatePolicy", &Actor::SetUpdatePolicy)
+            .addFunction("IsInstantiated", &Actor::IsInstantiated)
             .endClass();
 
     // Registering Application class
@@ -433,6 +510,7 @@ void ComponentManager::Initialize()
             .addFunction("Find", ComponentManager::FindActorByName)
             .addFunction("FindAll", ComponentManager::FindAllActorsByName)
             .addFunction("Instantiate", ComponentManager::InstantiateActor)
+            .addFunction("InstantiateDeferred", ComponentManager::InstantiateActorDeferred)
             .addFunction("Destroy", ComponentManager::DestroyActor)
             .endNamespace();
 
@@ -462,6 +540,8 @@ void ComponentManager::Initialize()
             .addFunction("Draw", &Renderer::ReadImageRenderRequest)
             .addFunction("DrawEx", &Renderer::ReadImageRenderRequestEx)
             .addFunction("DrawPixel", &Renderer::ReadPixelRenderRequest)
+            .addFunction("Preload", &TextureLoader::Preload)
+            .addFunction("GetPendingLoads", &TextureLoader::GetPendingLoads)
             .endNamespace();
 
     // Registering Camera namespace
@@ -480,12 +560,28 @@ void ComponentManager::Initialize()
             .addFunction("Play", &AudioManager::PlayMusic)
             .addFunction("Halt", &AudioManager::StopMusic)
             .addFunction("SetVolume", &AudioManager::SetVolume)
+            .addFunction("Preload", &AudioManager::Preload)
+            .addFunction("Unload", &AudioManager::Unload)
+            .addFunction("PlaySfx", &VoiceManager::PlaySfx)
+            .addFunction("SetClipLimit", &VoiceManager::SetClipLimit)
+            .addFunction("GetVoiceStats", &VoiceManager::GetStats)
+            .addFunction("PlayAt", &SpatialAudio::PlayAt)
+            .addFunction("AttachEmitter", &SpatialAudio::AttachEmitter)
+            .addFunction("SetEmitterPosition", &SpatialAudio::SetEmitterPosition)
+            .addFunction("DetachEmitter", &SpatialAudio::DetachEmitter)
+            .addFunction("GetSpatialStats", &SpatialAudio::GetStats)
+            .addFunction("SetBusVolume", &SoftwareMixer::SetBusVolume)
+            .addFunction("SetBusLowPass", &SoftwareMixer::SetBusLowPass)
+            .addFunction("GetMixerStats", &SoftwareMixer::GetStats)
             .endNamespace();
 
     // Registering Scene namespace
     luabridge::getGlobalNamespace(LuaManager::lua_state)
             .beginNamespace("Scene")
             .addFunction("Load", &LuaManager::LoadScene)
+            .addFunction("LoadAsync", &LuaManager::LoadSceneAsync)
+            .addFunction("GetLoadProgress", &LuaManager::GetSceneLoadProgress)
+            .addFunction("IsLoading", &LuaManager::IsSceneLoading)
             .addFunction("GetCurrent", &LuaManager::GetCurrentSceneName)
             .addFunction("DontDestroy", &ComponentManager::DontDestroyActor)
             .endNamespace();
@@ -537,6 +633,9 @@ void ComponentManager::Initialize()
             .addData("trigger_width", &Rigidbody::trigger_width)
             .addData("trigger_height", &Rigidbody::trigger_height)
             .addData("trigger_radius", &Rigidbody::trigger_radius)
+            .addData("layer", &Rigidbody::layer)
+            .addData("collides_with", &Rigidbody::collides_with)
+            .addData("pooled", &Rigidbody::pooled)
             .addData("actor", &Rigidbody::actor)
             .addFunction("GetPosition", &Rigidbody::GetBodyPosition)
             .addFunction("GetRotation", &Rigidbody::GetBodyRotation)
@@ -547,6 +646,7 @@ void ComponentManager::Initialize()
             .addFunction("SetRotation", &Rigidbody::SetRotation)
             .addFunction("SetAngularVelocity", &Rigidbody::SetAngularVelocity)
             .addFunction("SetGravityScale", &Rigidbody::SetGravityScale)
+            .addFunction("SetLayer", &Rigidbody::SetLayer)
             .addFunction("SetUpDirection", &Rigidbody::SetUpDirection)
             .addFunction("SetRightDirection", &Rigidbody::SetRightDirection)
             .addFunction("GetVelocity", &Rigidbody::GetVelocity)
@@ -582,13 +682,28 @@ void ComponentManager::Initialize()
             .beginNamespace("Physics")
             .addFunction("Raycast", &Physics::Raycast)
             .addFunction("RaycastAll", &Physics::RaycastAll)
+            .addFunction("OverlapCircle", &Physics::OverlapCircle)
+            .addFunction("OverlapBox", &Physics::OverlapBox)
+            .addFunction("SaveState", &PhysicsSnapshot::SaveState)
+            .addFunction("RestoreState", &PhysicsSnapshot::RestoreState)
+            .addFunction("SaveStateToFile", &PhysicsSnapshot::SaveStateToFile)
+            .addFunction("RestoreStateFromFile", &PhysicsSnapshot::RestoreStateFromFile)
+            .endNamespace();
+
+    luabridge::getGlobalNamespace(LuaManager::lua_state)
+            .beginNamespace("Random")
+            .addFunction("Seed", &Determinism::Seed)
+            .addFunction("Value", &Determinism::Value)
+            .addFunction("Range", &Determinism::Range)
+            .addFunction("Int", &Determinism::Int)
             .endNamespace();
 
     luabridge::getGlobalNamespace(LuaManager::lua_state)
             .beginNamespace("Event")
             .addFunction("Subscribe", &EventBus::Subscribe)
             .addFunction("Unsubscribe", &EventBus::UnSubscribe)
-            .addFunction("Publish", &EventBus::Publish)
+            .addFunction("Publish", static_cast<int (*)(lua_State *)>(&EventBus::Publish))
+            .addFunction("GetId", &EventBus::GetIdFromLua)
             .endNamespace();
 
 }
@@ -612,7 +727,7 @@ void ComponentManager::InstantiateComponent(const std::string &name, const std::
 {
     const std::string path = "resources/component_types/" + type + ".lua";
 
-    if (luaL_dofile(LuaManager::lua_state, path.c_str()) != LUA_OK)
+    if (LuaManager::DoFile(path) != LUA_OK)
     {
         std::cout << "problem with lua file " << type;
         exit(0);
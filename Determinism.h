@@ -0,0 +1,236 @@
+#ifndef MAIN_CPP_DETERMINISM_H
+#define MAIN_CPP_DETERMINISM_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include "rapidjson/document.h"
+#include "Lua/lua.hpp"
+#include "LuaBridge/LuaBridge.h"
+#include "LuaMananger.h"
+#include "Actor.h"
+#include "Rigidbody.h"
+
+// Deterministic simulation mode, enabled from game.config:
+//
+//   "deterministic": true,
+//   "random_seed": 1234,
+//   "state_hash_log": "state_hash.log"
+//
+// Physics always advances by FIXED_TIME_STEP per frame, Lua's math.random and the engine's Random
+// namespace are seeded from random_seed, and a hash of the simulation state is logged every frame.
+// Replaying the same sdl_user_input.txt twice must produce identical logs; diff them to find the
+// first frame where two builds disagree.
+//
+// Lua's string hashes are salted per process. For pairs() order over string keys to be reproducible too,
+// build Lua with a fixed seed (make -C Lua DETERMINISTIC=1).
+class Determinism
+{
+public:
+    static constexpr float FIXED_TIME_STEP = 1.0f / 60.0f;
+
+    static inline bool enabled = false;
+    static inline uint64_t seed = 0x5EED;
+    static inline std::string hashLogPath = "state_hash.log";
+    static inline std::ofstream hashLog;
+
+    static void LoadFromConfig(const rapidjson::Document &gameConfig)
+    {
+        if (gameConfig.HasMember("deterministic") && gameConfig["deterministic"].IsBool())
+            enabled = gameConfig["deterministic"].GetBool();
+
+        if (!enabled)
+            return;
+
+        if (gameConfig.HasMember("random_seed") && gameConfig["random_seed"].IsUint64())
+            seed = gameConfig["random_seed"].GetUint64();
+        if (gameConfig.HasMember("state_hash_log") && gameConfig["state_hash_log"].IsString())
+            hashLogPath = gameConfig["state_hash_log"].GetString();
+
+        Seed(static_cast<double>(seed));
+
+        // Lua's own generator is seeded from the clock by luaL_openlibs
+        luabridge::LuaRef randomSeed = luabridge::getGlobal(LuaManager::lua_state, "math")["randomseed"];
+        randomSeed(static_cast<lua_Integer>(seed));
+
+        hashLog.open(hashLogPath, std::ios::out | std::ios::trunc);
+        if (!hashLog.is_open())
+            std::cout << "error: failed to open " << hashLogPath << " for writing" << std::endl;
+    }
+
+    /// Seeded random numbers (Lua: Random.Seed / Random.Value / Random.Range / Random.Int)
+    // splitmix64: tiny, portable and identical on every platform, unlike std:: distributions
+
+    static void Seed(double newSeed)
+    {
+        rngState = static_cast<uint64_t>(newSeed);
+    }
+
+    // uniform in [0, 1)
+    static double Value()
+    {
+        return static_cast<double>(Next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    // uniform in [min, max)
+    static double Range(double min, double max)
+    {
+        return min + (max - min) * Value();
+    }
+
+    // uniform in [min, max], both inclusive
+    static int Int(int min, int max)
+    {
+        if (max <= min)
+            return min;
+        uint64_t span = static_cast<uint64_t>(static_cast<int64_t>(max) - min) + 1;
+        return static_cast<int>(min + static_cast<int64_t>(Next() % span));
+    }
+
+    /// Per-frame state hash
+
+    // Hashes actors (id, name), rigidbodies (transform and velocities, bit exact) and every scalar field
+    // (number, boolean, string) stored on the Lua component instances, in a platform independent order.
+    static uint64_t HashState(const std::vector<Actor *> &actors)
+    {
+        uint64_t hash = FNV_OFFSET;
+        for (const Actor *actor: actors)
+        {
+            HashValue(hash, actor->actor_id);
+            HashString(hash, actor->name);
+
+            for (const auto &[key, component]: actor->components)
+            {
+                HashString(hash, key);
+                if ((*component)["type"].tostring() == "Rigidbody")
+                    HashRigidbody(hash, *component->cast<Rigidbody *>());
+                else
+                    HashComponentScalars(hash, *component);
+            }
+        }
+        return hash;
+    }
+
+    static void RecordFrame(const std::vector<Actor *> &actors, int frame)
+    {
+        if (!enabled || !hashLog.is_open())
+            return;
+
+        hashLog << "frame:" << std::setw(5) << std::setfill('0') << frame << " actors:" << actors.size()
+                << " bodies:" << (world ? world->GetBodyCount() : 0) << " hash:" << std::hex << std::setw(16)
+                << HashState(actors) << std::dec << "\n";
+    }
+
+private:
+    static constexpr uint64_t FNV_OFFSET = 0xcbf29ce484222325ull;
+    static constexpr uint64_t FNV_PRIME = 0x100000001b3ull;
+
+    static inline uint64_t rngState = 0x5EED;
+
+    static uint64_t Next()
+    {
+        uint64_t z = (rngState += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    static void HashBytes(uint64_t &hash, const void *data, size_t size)
+    {
+        const auto *bytes = static_cast<const unsigned char *>(data);
+        for (size_t i = 0; i < size; i++)
+        {
+            hash ^= bytes[i];
+            hash *= FNV_PRIME;
+        }
+    }
+
+    template<typename T>
+    static void HashValue(uint64_t &hash, T value)
+    {
+        HashBytes(hash, &value, sizeof(T));
+    }
+
+    static void HashString(uint64_t &hash, const std::string &value)
+    {
+        HashBytes(hash, value.data(), value.size());
+        HashValue<char>(hash, 0);
+    }
+
+    static void HashRigidbody(uint64_t &hash, const Rigidbody &rigidbody)
+    {
+        if (rigidbody.body == nullptr)
+        {
+            HashValue(hash, rigidbody.x);
+            HashValue(hash, rigidbody.y);
+            HashValue(hash, rigidbody.rotation);
+            return;
+        }
+
+        const b2Body *body = rigidbody.body;
+        HashValue(hash, body->GetPosition().x);
+        HashValue(hash, body->GetPosition().y);
+        HashValue(hash, body->GetAngle());
+        HashValue(hash, body->GetLinearVelocity().x);
+        HashValue(hash, body->GetLinearVelocity().y);
+        HashValue(hash, body->GetAngularVelocity());
+        HashValue(hash, body->IsAwake());
+    }
+
+    // lua_next visits keys in hash order, so the fields are sorted by name before hashing
+    static void HashComponentScalars(uint64_t &hash, const luabridge::LuaRef &component)
+    {
+        lua_State *L = LuaManager::lua_state;
+        std::vector<std::pair<std::string, std::string>> fields;
+
+        component.push(L);
+        lua_pushnil(L);
+        while (lua_next(L, -2) != 0)
+        {
+            if (lua_type(L, -2) == LUA_TSTRING)
+            {
+                // type tag + payload, so "1", 1 and true never hash the same
+                std::string value;
+                switch (lua_type(L, -1))
+                {
+                    case LUA_TNUMBER:
+                    {
+                        lua_Number number = lua_tonumber(L, -1);
+                        value = "n";
+                        value.append(reinterpret_cast<const char *>(&number), sizeof(number));
+                        break;
+                    }
+                    case LUA_TBOOLEAN:
+                        value = lua_toboolean(L, -1) ? "b1" : "b0";
+                        break;
+                    case LUA_TSTRING:
+                        value = "s";
+                        value += lua_tostring(L, -1);
+                        break;
+                    default:
+                        break; // tables, functions and userdata are not scalars
+                }
+
+                if (!value.empty())
+                    fields.emplace_back(lua_tostring(L, -2), std::move(value));
+            }
+            lua_pop(L, 1); // keep the key for the next lua_next
+        }
+        lua_pop(L, 1); // the component table
+
+        std::sort(fields.begin(), fields.end());
+        for (const auto &[name, value]: fields)
+        {
+            HashString(hash, name);
+            HashString(hash, value);
+        }
+    }
+};
+
+
+#endif //MAIN_CPP_DETERMINISM_H
@@ -11,31 +11,69 @@
 #include <string>
 #include <fstream>
 #include <sstream>
+#include <iostream>
+#include <cstdio>
+#include <cstring>
 #include <string>
 
-#include "rapidjson/filereadstream.h"
 #include "rapidjson/document.h"
+#include "AssetPack.h"
 
 class EngineUtils {
 public:
     static void ReadJsonFile(const std::string& path, rapidjson::Document & out_document)
     {
+        if (!ParseJsonFile(path, out_document)) {
+            std::cout << "error parsing json at [" << path << "]" << std::endl;
+            exit(0);
+        }
+    }
+
+    // Parses the whole file in situ: the strings point into a copy of the file kept in the document's own
+    // allocator rather than being copied one by one. false if the file can't be read or parsed.
+    static bool ParseJsonFile(const std::string& path, rapidjson::Document& out_document)
+    {
+        rapidjson::Document::AllocatorType& allocator = out_document.GetAllocator();
+        char* buffer = ReadWholeFile(path, [&allocator](size_t bytes) {
+            return static_cast<char*>(allocator.Malloc(bytes));
+        });
+        if (buffer == nullptr)
+            return false;
+
+        out_document.ParseInsitu(buffer);
+        return !out_document.HasParseError();
+    }
+
+    // The whole file (or its resources.pak entry), NUL-terminated in memory from allocate(bytes) so that it
+    // can be parsed in situ; nullptr if it can't be read
+    template<typename Allocate>
+    static char* ReadWholeFile(const std::string& path, Allocate&& allocate)
+    {
+        AssetPack::Asset asset;
+        if (AssetPack::Find(path, asset)) {
+            char* buffer = allocate(asset.size + 1);
+            std::memcpy(buffer, asset.data, asset.size);
+            buffer[asset.size] = '\0';
+            return buffer;
+        }
+
         FILE* file_pointer = nullptr;
     #ifdef _WIN32
         fopen_s(&file_pointer, path.c_str(), "rb");
     #else
         file_pointer = fopen(path.c_str(), "rb");
     #endif
-        char buffer[65536];
-        rapidjson::FileReadStream stream(file_pointer, buffer, sizeof(buffer));
-        out_document.ParseStream(stream);
-        std::fclose(file_pointer);
+        if (file_pointer == nullptr)
+            return nullptr;
 
-        if (out_document.HasParseError()) {
-            rapidjson::ParseErrorCode errorCode = out_document.GetParseError();
-            std::cout << "error parsing json at [" << path << "]" << std::endl;
-            exit(0);
-        }
+        std::fseek(file_pointer, 0, SEEK_END);
+        long length = std::ftell(file_pointer);
+        std::fseek(file_pointer, 0, SEEK_SET);
+        char* buffer = length < 0 ? nullptr : allocate(static_cast<size_t>(length) + 1);
+        if (buffer != nullptr)
+            buffer[std::fread(buffer, 1, static_cast<size_t>(length), file_pointer)] = '\0';
+        std::fclose(file_pointer);
+        return buffer;
     }
 };
 
@@ -1,60 +1,213 @@
+#ifndef MAIN_CPP_EVENTBUS_H
+#define MAIN_CPP_EVENTBUS_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "Lua/lua.hpp"
+#include "LuaBridge/LuaBridge.h"
+
+// Event types are interned to integer ids, and each id indexes a flat vector of subscriptions held as
+// registry references. Publish is a plain lua_CFunction: the payload stays on the Lua stack and goes to
+// every handler as it is, a table or any other value, without a LuaRef per call.
+//
+// Names or ids work wherever a type is taken. A name is looked up in a Lua table of name -> id, so a
+// publish by name costs one table lookup on the interned Lua string. Scripts that publish often can cache
+// the id: local HIT = Event.GetId("hit").
+//
+// Subscribe and Unsubscribe take effect at ProcessDeferredActions, once per frame, in the order they were
+// called. Unsubscribe swaps the last subscription into the removed one's place, so handlers of a type are
+// called in subscription order only until one of them unsubscribes.
+//
+// Lua: Event.GetId(name) -> id, Event.Subscribe(type, component, function),
+//      Event.Unsubscribe(type, component, function), Event.Publish(type [, payload])
 class EventBus
 {
 public:
-    using LuaRef = luabridge::LuaRef;
-    using Subscription = std::pair<LuaRef, LuaRef>; // Component, Function (used to track lua functions and their tables)
+    struct Subscription
+    {
+        int component; // registry references
+        int function;
+    };
+
     using SubscriberList = std::vector<Subscription>;
-    using DeferredAction = std::function<void()>;
 
-    static inline std::map<std::string, SubscriberList> subscribers;
-    static inline std::vector<DeferredAction> deferredActions;
+    static inline std::vector<SubscriberList> subscribers; // by event type id
 
     EventBus() = default;
 
-    static void Publish(const std::string &event_type, LuaRef event_object)
+    // The id of an event type, interned on first use
+    static int GetId(const std::string &event_type)
+    {
+        auto it = ids.find(event_type);
+        if (it != ids.end())
+            return it->second;
+        int id = static_cast<int>(subscribers.size());
+        ids.emplace(event_type, id);
+        subscribers.emplace_back();
+        return id;
+    }
+
+    // Lua: Event.GetId(name)
+    static int GetIdFromLua(lua_State *L)
+    {
+        lua_pushinteger(L, GetTypeArgument(L, 1));
+        return 1;
+    }
+
+    // Lua: Event.Publish(type, payload); handler errors go to the publisher's caller like its own
+    static int Publish(lua_State *L)
+    {
+        int id = GetTypeArgument(L, 1);
+        lua_settop(L, 2); // a missing payload is nil
+        Dispatch(L, id, 2);
+        return 0;
+    }
+
+    // Lua: Event.Subscribe(type, component, function)
+    static void Subscribe(luabridge::LuaRef event_type, luabridge::LuaRef component, luabridge::LuaRef function)
+    {
+        Defer(true, event_type, component, function);
+    }
+
+    // Lua: Event.Unsubscribe(type, component, function)
+    static void UnSubscribe(luabridge::LuaRef event_type, luabridge::LuaRef component, luabridge::LuaRef function)
+    {
+        Defer(false, event_type, component, function);
+    }
+
+    static void ProcessDeferredActions()
     {
-        if (subscribers.find(event_type) != subscribers.end())
+        for (const Pending &pending: deferred)
         {
-            for (auto &[component, function]: subscribers[event_type])
+            if (pending.subscribe)
+            {
+                subscribers[pending.id].push_back(pending.subscription);
+                continue;
+            }
+
+            SubscriberList &list = subscribers[pending.id];
+            for (size_t i = 0; i < list.size(); i++)
             {
-                // Important: Ensure 'self' is correctly passed to Lua functions
-                if (function.isFunction())
+                if (Equals(pending.state, list[i].component, pending.subscription.component) &&
+                    Equals(pending.state, list[i].function, pending.subscription.function))
                 {
-                    // Call the Lua function with 'component' as 'self' and any additional parameters
-                    function(component, event_object);
+                    Release(pending.state, list[i]);
+                    list[i] = list.back();
+                    list.pop_back();
+                    i--; // the swapped in one is next
                 }
             }
+            Release(pending.state, pending.subscription);
         }
+        deferred.clear();
     }
 
-    static void Subscribe(const std::string &event_type, LuaRef component, LuaRef function)
+private:
+    struct Pending
     {
-        // Ensure that 'function' is actually a function.
-        deferredActions.emplace_back([=]()
-                                     {
-                                         subscribers[event_type].emplace_back(component, function);
-                                     });
+        bool subscribe;
+        int id;
+        Subscription subscription;
+        lua_State *state;
+    };
+
+    static inline std::unordered_map<std::string, int> ids;
+    static inline std::vector<Pending> deferred;
+    static inline int nameCache = LUA_NOREF; // registry reference to the Lua table of name -> id
+
+    // The id of the type at index: a number is taken as an id, a string is interned. -1 for anything else.
+    static int GetTypeArgument(lua_State *L, int index)
+    {
+        index = lua_absindex(L, index);
+        if (lua_type(L, index) == LUA_TNUMBER)
+            return static_cast<int>(lua_tointeger(L, index));
+        if (lua_type(L, index) != LUA_TSTRING)
+            return -1;
+
+        if (nameCache == LUA_NOREF)
+        {
+            lua_newtable(L);
+            nameCache = luaL_ref(L, LUA_REGISTRYINDEX);
+        }
+        lua_rawgeti(L, LUA_REGISTRYINDEX, nameCache);
+        lua_pushvalue(L, index);
+        lua_rawget(L, -2);
+        if (lua_isinteger(L, -1))
+        {
+            int id = static_cast<int>(lua_tointeger(L, -1));
+            lua_pop(L, 2);
+            return id;
+        }
+        lua_pop(L, 1);
+
+        size_t length = 0;
+        const char *name = lua_tolstring(L, index, &length);
+        int id = GetId(std::string(name, length));
+        lua_pushvalue(L, index);
+        lua_pushinteger(L, id);
+        lua_rawset(L, -3);
+        lua_pop(L, 1);
+        return id;
     }
 
-    static void UnSubscribe(const std::string &event_type, LuaRef component, LuaRef function)
+    // Calls each handler of id with the value at payloadIndex; unprotected, errors unwind to the caller
+    static void Dispatch(lua_State *L, int id, int payloadIndex)
     {
-        deferredActions.emplace_back([=]()
-                                     {
-                                         auto &list = subscribers[event_type];
-                                         list.erase(
-                                                 std::remove_if(list.begin(), list.end(), [&](const Subscription &sub)
-                                                 {
-                                                     return sub.first == component && sub.second == function;
-                                                 }), list.end());
-                                     });
+        // by index: a handler may intern a new type, which grows subscribers
+        for (size_t i = 0; id >= 0 && id < static_cast<int>(subscribers.size()) && i < subscribers[id].size(); i++)
+        {
+            if (PushHandler(L, subscribers[id][i], payloadIndex))
+                lua_call(L, 2, 0);
+        }
     }
 
-    static void ProcessDeferredActions()
+    // Pushes function, component (as self) and payload; false, with nothing pushed, if the function is not one
+    static bool PushHandler(lua_State *L, const Subscription &subscription, int payloadIndex)
     {
-        for (auto &action: deferredActions)
+        lua_rawgeti(L, LUA_REGISTRYINDEX, subscription.function);
+        if (!lua_isfunction(L, -1))
         {
-            action(); // Execute each deferred action
+            lua_pop(L, 1);
+            return false;
         }
-        deferredActions.clear(); // Clear the list of deferred actions
+        lua_rawgeti(L, LUA_REGISTRYINDEX, subscription.component);
+        lua_pushvalue(L, payloadIndex);
+        return true;
+    }
+
+    static void Defer(bool subscribe, const luabridge::LuaRef &event_type, const luabridge::LuaRef &component,
+                      const luabridge::LuaRef &function)
+    {
+        lua_State *L = component.state();
+        event_type.push(L);
+        int id = GetTypeArgument(L, -1);
+        lua_pop(L, 1);
+        if (id < 0 || id >= static_cast<int>(subscribers.size()))
+            return;
+
+        component.push(L);
+        int componentRef = luaL_ref(L, LUA_REGISTRYINDEX);
+        function.push(L);
+        int functionRef = luaL_ref(L, LUA_REGISTRYINDEX);
+        deferred.push_back(Pending{subscribe, id, Subscription{componentRef, functionRef}, L});
+    }
+
+    static bool Equals(lua_State *L, int a, int b)
+    {
+        lua_rawgeti(L, LUA_REGISTRYINDEX, a);
+        lua_rawgeti(L, LUA_REGISTRYINDEX, b);
+        bool equal = lua_rawequal(L, -1, -2) != 0;
+        lua_pop(L, 2);
+        return equal;
+    }
+
+    static void Release(lua_State *L, const Subscription &subscription)
+    {
+        luaL_unref(L, LUA_REGISTRYINDEX, subscription.component);
+        luaL_unref(L, LUA_REGISTRYINDEX, subscription.function);
     }
 };
+
+
+#endif //MAIN_CPP_EVENTBUS_H
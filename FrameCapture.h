@@ -0,0 +1,383 @@
+#ifndef MAIN_CPP_FRAMECAPTURE_H
+#define MAIN_CPP_FRAMECAPTURE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <deque>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <algorithm>
+#ifndef __EMSCRIPTEN__
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#endif
+#include "SDL2/SDL.h"
+
+struct FrameCaptureStats
+{
+    uint64_t captured = 0;
+    uint64_t written = 0;
+    uint64_t unchanged = 0; // skipped by FORMAT_CHANGED
+    uint64_t dropped = 0;
+    uint64_t stalls = 0;
+    double stallMs = 0.0;
+    double captureMs = 0.0; // main thread time, stalls included
+    size_t maxQueued = 0;
+};
+
+// Writes the frames captured by Helper::SDL_RenderPresent498 (recording / autograder mode) to disk.
+//
+// The main thread only reads the renderer into one of RING_SIZE preallocated buffers; a background
+// thread encodes and writes them. When every buffer is waiting to be written the main thread stalls
+// until one frees up (FRAME_CAPTURE_DROP=1 drops the frame instead), and both are counted.
+//
+// FRAME_CAPTURE_FORMAT selects the output:
+//   bmp      frame_00042.bmp, 24-bit, the same files SDL_SaveBMP wrote (default)
+//   raw      frame_00042.raw, Header + RGB24 rows
+//   rle      frame_00042.rle, Header + (count, r, g, b) runs of identical pixels
+//   changed  bmp, but only when the frame differs from the last one written
+//
+// The stats go to stderr at exit, autograder runs compare stdout: always with FRAME_CAPTURE_STATS=1 or another
+// FRAME_CAPTURE_* variable set, otherwise only if the main thread stalled or dropped frames.
+//
+// Emscripten builds have no threads, so they encode and write synchronously.
+class FrameCapture
+{
+public:
+    static constexpr int RING_SIZE = 8;
+
+    enum Format
+    {
+        FORMAT_BMP,
+        FORMAT_RAW,
+        FORMAT_RLE,
+        FORMAT_CHANGED
+    };
+
+    // Leads .raw and .rle files
+    struct Header
+    {
+        char magic[4]; // "FRAW" or "FRLE"
+        uint32_t width;
+        uint32_t height;
+        uint32_t frame;
+    };
+
+    static inline FrameCaptureStats stats;
+
+    static void Initialize(int frameWidth, int frameHeight, const std::string &directory)
+    {
+        width = frameWidth;
+        height = frameHeight;
+        outputDirectory = directory;
+        format = ParseFormat(std::getenv("FRAME_CAPTURE_FORMAT"));
+        dropWhenFull = std::getenv("FRAME_CAPTURE_DROP") != nullptr;
+        reportStats = std::getenv("FRAME_CAPTURE_STATS") != nullptr || std::getenv("FRAME_CAPTURE_FORMAT") != nullptr ||
+                      dropWhenFull;
+
+        size_t frameBytes = static_cast<size_t>(width) * height * 3;
+        slots.resize(RING_SIZE);
+        for (int i = 0; i < RING_SIZE; i++)
+        {
+            slots[i].pixels.resize(frameBytes);
+            freeSlots.push_back(i);
+        }
+        encodeBuffer.reserve(frameBytes + 1024);
+
+#ifndef __EMSCRIPTEN__
+        writer = std::thread(WriterLoop);
+#endif
+        std::atexit(Shutdown);
+        initialized = true;
+    }
+
+    // Reads the renderer's current frame and queues it for writing
+    static void Capture(SDL_Renderer *renderer, int frame)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        int slot = AcquireSlot();
+        if (slot < 0)
+        {
+            stats.dropped++;
+            return;
+        }
+
+        if (SDL_RenderReadPixels(renderer, nullptr, SDL_PIXELFORMAT_RGB24, slots[slot].pixels.data(), width * 3) != 0)
+            SDL_Log("SDL_RenderReadPixels() failed: %s", SDL_GetError());
+        slots[slot].frame = frame;
+        stats.captured++;
+
+#ifdef __EMSCRIPTEN__
+        WriteSlot(slots[slot]);
+        freeSlots.push_back(slot);
+#else
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queuedSlots.push_back(slot);
+            stats.maxQueued = std::max(stats.maxQueued, queuedSlots.size());
+        }
+        wakeWriter.notify_one();
+#endif
+
+        stats.captureMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Writes everything still queued and stops the writer; registered with atexit
+    static void Shutdown()
+    {
+        if (!initialized)
+            return;
+        initialized = false;
+
+#ifndef __EMSCRIPTEN__
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeWriter.notify_one();
+        if (writer.joinable())
+            writer.join();
+#endif
+
+        if (!reportStats && stats.stalls == 0 && stats.dropped == 0)
+            return;
+        std::cerr << std::fixed << std::setprecision(3)
+                  << "frame capture: " << stats.captured << " captured, " << stats.written << " written, "
+                  << stats.unchanged << " unchanged, " << stats.dropped << " dropped, " << stats.stalls
+                  << " stalls (" << stats.stallMs << " ms), "
+                  << (stats.captured ? stats.captureMs / stats.captured : 0.0) << " ms/frame on the main thread, "
+                  << "max queue " << stats.maxQueued << "/" << RING_SIZE << std::endl;
+        std::cerr.unsetf(std::ios::floatfield);
+        std::cerr << std::setprecision(6);
+    }
+
+private:
+    struct Slot
+    {
+        std::vector<uint8_t> pixels; // RGB24, top row first
+        int frame = 0;
+    };
+
+    static inline bool initialized = false;
+    static inline int width = 0;
+    static inline int height = 0;
+    static inline std::string outputDirectory;
+    static inline Format format = FORMAT_BMP;
+    static inline bool dropWhenFull = false;
+    static inline bool reportStats = false; // print the stats even without stalls or drops
+
+    static inline std::vector<Slot> slots;
+    static inline std::vector<int> freeSlots;
+    static inline std::deque<int> queuedSlots;
+
+    // writer side only
+    static inline std::vector<uint8_t> encodeBuffer;
+    static inline std::vector<uint8_t> lastWritten;
+
+#ifndef __EMSCRIPTEN__
+    static inline std::thread writer;
+    static inline std::mutex mutex;
+    static inline std::condition_variable wakeWriter;
+    static inline std::condition_variable slotFreed;
+    static inline bool stopping = false;
+#endif
+
+    static Format ParseFormat(const char *name)
+    {
+        std::string value = name ? name : "bmp";
+        if (value == "raw") return FORMAT_RAW;
+        if (value == "rle") return FORMAT_RLE;
+        if (value == "changed") return FORMAT_CHANGED;
+        if (value != "bmp")
+            std::cout << "error: unknown FRAME_CAPTURE_FORMAT " << value << ", using bmp" << std::endl;
+        return FORMAT_BMP;
+    }
+
+    // Returns -1 if the frame has to be dropped
+    static int AcquireSlot()
+    {
+#ifdef __EMSCRIPTEN__
+        int slot = freeSlots.back();
+        freeSlots.pop_back();
+        return slot;
+#else
+        std::unique_lock<std::mutex> lock(mutex);
+        if (freeSlots.empty())
+        {
+            if (dropWhenFull)
+                return -1;
+
+            auto start = std::chrono::steady_clock::now();
+            slotFreed.wait(lock, [] { return !freeSlots.empty(); });
+            stats.stalls++;
+            stats.stallMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+        int slot = freeSlots.back();
+        freeSlots.pop_back();
+        return slot;
+#endif
+    }
+
+#ifndef __EMSCRIPTEN__
+    static void WriterLoop()
+    {
+        while (true)
+        {
+            int slot;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wakeWriter.wait(lock, [] { return stopping || !queuedSlots.empty(); });
+                if (queuedSlots.empty())
+                    return; // stopping, and everything has been written
+                slot = queuedSlots.front();
+                queuedSlots.pop_front();
+            }
+
+            WriteSlot(slots[slot]);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                freeSlots.push_back(slot);
+            }
+            slotFreed.notify_one();
+        }
+    }
+#endif
+
+    static void WriteSlot(const Slot &slot)
+    {
+        if (format == FORMAT_CHANGED)
+        {
+            if (slot.pixels == lastWritten)
+            {
+                stats.unchanged++;
+                return;
+            }
+            lastWritten = slot.pixels;
+        }
+
+        const char *extension = ".bmp";
+        switch (format)
+        {
+            case FORMAT_RAW:
+                EncodeRaw(slot);
+                extension = ".raw";
+                break;
+            case FORMAT_RLE:
+                EncodeRle(slot);
+                extension = ".rle";
+                break;
+            default:
+                EncodeBmp(slot);
+                break;
+        }
+
+        std::stringstream path;
+        path << outputDirectory << "/frame_" << std::setw(5) << std::setfill('0') << slot.frame << extension;
+
+        FILE *file = std::fopen(path.str().c_str(), "wb");
+        if (file == nullptr || std::fwrite(encodeBuffer.data(), 1, encodeBuffer.size(), file) != encodeBuffer.size())
+            std::cout << "error: failed to write " << path.str() << std::endl;
+        if (file != nullptr)
+            std::fclose(file);
+        stats.written++;
+    }
+
+    template<typename T>
+    static void Append(const T &value)
+    {
+        const auto *bytes = reinterpret_cast<const uint8_t *>(&value);
+        encodeBuffer.insert(encodeBuffer.end(), bytes, bytes + sizeof(T));
+    }
+
+    static void AppendHeader(const char *magic, const Slot &slot)
+    {
+        Header header{};
+        std::memcpy(header.magic, magic, 4);
+        header.width = static_cast<uint32_t>(width);
+        header.height = static_cast<uint32_t>(height);
+        header.frame = static_cast<uint32_t>(slot.frame);
+        Append(header);
+    }
+
+    static void EncodeRaw(const Slot &slot)
+    {
+        encodeBuffer.clear();
+        AppendHeader("FRAW", slot);
+        encodeBuffer.insert(encodeBuffer.end(), slot.pixels.begin(), slot.pixels.end());
+    }
+
+    // (count, r, g, b) for runs of up to 255 identical pixels; flat backgrounds shrink to almost nothing
+    static void EncodeRle(const Slot &slot)
+    {
+        encodeBuffer.clear();
+        AppendHeader("FRLE", slot);
+
+        const uint8_t *pixels = slot.pixels.data();
+        size_t pixelCount = static_cast<size_t>(width) * height;
+        size_t i = 0;
+        while (i < pixelCount)
+        {
+            const uint8_t *pixel = pixels + i * 3;
+            size_t run = 1;
+            while (i + run < pixelCount && run < 255 && std::memcmp(pixel, pixels + (i + run) * 3, 3) == 0)
+                run++;
+
+            encodeBuffer.push_back(static_cast<uint8_t>(run));
+            encodeBuffer.insert(encodeBuffer.end(), pixel, pixel + 3);
+            i += run;
+        }
+    }
+
+    // BITMAPFILEHEADER + BITMAPINFOHEADER, BGR rows bottom-up padded to 4 bytes, as SDL_SaveBMP writes RGB24
+    static void EncodeBmp(const Slot &slot)
+    {
+        uint32_t rowBytes = static_cast<uint32_t>(width) * 3;
+        uint32_t paddedRow = (rowBytes + 3) & ~3u;
+        uint32_t imageBytes = paddedRow * static_cast<uint32_t>(height);
+
+        encodeBuffer.clear();
+        encodeBuffer.push_back('B');
+        encodeBuffer.push_back('M');
+        Append<uint32_t>(14 + 40 + imageBytes); // file size
+        Append<uint32_t>(0); // reserved
+        Append<uint32_t>(14 + 40); // pixel data offset
+
+        Append<uint32_t>(40); // info header size
+        Append<int32_t>(width);
+        Append<int32_t>(height); // positive: bottom-up
+        Append<uint16_t>(1); // planes
+        Append<uint16_t>(24); // bits per pixel
+        Append<uint32_t>(0); // BI_RGB
+        Append<uint32_t>(imageBytes);
+        Append<int32_t>(0); // pixels per meter
+        Append<int32_t>(0);
+        Append<uint32_t>(0); // palette colors
+        Append<uint32_t>(0);
+
+        size_t offset = encodeBuffer.size();
+        encodeBuffer.resize(offset + imageBytes, 0);
+        for (int y = 0; y < height; y++)
+        {
+            const uint8_t *source = slot.pixels.data() + static_cast<size_t>(height - 1 - y) * rowBytes;
+            uint8_t *destination = encodeBuffer.data() + offset + static_cast<size_t>(y) * paddedRow;
+            for (uint32_t x = 0; x < rowBytes; x += 3)
+            {
+                destination[x] = source[x + 2];
+                destination[x + 1] = source[x + 1];
+                destination[x + 2] = source[x];
+            }
+        }
+    }
+};
+
+
+#endif //MAIN_CPP_FRAMECAPTURE_H
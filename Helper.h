@@ -29,6 +29,8 @@
 
 #include "SDL2_image/SDL_image.h"
 #include "SDL2/SDL.h"
+#include "FrameCapture.h"
+#include "RenderLog.h"
 
 enum InputStatus { NOT_INITIALIZED, INPUT_FILE_MISSING, INPUT_FILE_PRESENT };
 enum RenderLoggerStatus { RL_NOT_INITIALIZED, RL_NOT_ENABLED, RL_ENABLED };
@@ -46,6 +48,10 @@ public:
 	/* Depending on whether or not an autograder is testing it. */
 	inline static bool _autograder_mode = false;
 
+	/* Headless mode (--headless or the HEADLESS environment variable) runs on SDL's dummy drivers */
+	/* with a software renderer and no frame pacing, for benchmarks and batch jobs. */
+	inline static bool _headless_mode = false;
+
 	/* One way the autograder gauges success is by comparing your "frames" (renderings) to */
 	/* that of a staff solution program fed the exact same input. These are placed into a "frames" folder. */
 	inline static std::string frame_directory_relative_path = "frames";
@@ -54,6 +60,13 @@ public:
 	static inline int frame_number = 0;
 	static inline Uint32 current_frame_start_timestamp = 0;
 	static int GetFrameNumber() { return frame_number; }
+	static bool IsHeadlessMode() { return _headless_mode || IsEnvVariableSet("HEADLESS"); }
+
+	/* Whether every SDL_RenderCopyEx498 call is being logged. */
+	static bool IsRenderLoggingMode() { CheckForRenderLoggerInit(); return render_logger_mode == RL_ENABLED; }
+
+	/* Renderer batches sprites unless frames or render calls are being compared against another build's. */
+	static bool IsExactRenderingMode() { return RECORDING_MODE || _autograder_mode || IsAutograderMode() || IsRenderLoggingMode(); }
 
 	static SDL_Window* SDL_CreateWindow498(const char* title, int x, int y, int w, int h, Uint32 flags)
 	{
@@ -63,6 +76,9 @@ public:
 			y = 0;
 		}
 
+		if (IsHeadlessMode())
+			flags = (flags & ~SDL_WINDOW_SHOWN) | SDL_WINDOW_HIDDEN;
+
 		return SDL_CreateWindow(title, x, y, w, h, flags);
 	}
 
@@ -71,6 +87,9 @@ public:
 		if (IsAutograderMode())
 			flags &= ~SDL_RENDERER_PRESENTVSYNC; // VSync is disabled to let frames render faster in the autograder.
 
+		if (IsHeadlessMode())
+			flags = SDL_RENDERER_SOFTWARE; // There is no GPU behind the dummy video driver.
+
 		SDL_Renderer* renderer = SDL_CreateRenderer(window, index, flags);
 
 		if (renderer == nullptr)
@@ -103,7 +122,6 @@ public:
 		}
 
 		static bool initialized = false;
-		static SDL_Surface* saving_surface = nullptr;
 
 		if (RECORDING_MODE || _autograder_mode)
 		{
@@ -115,28 +133,18 @@ public:
 					std::filesystem::create_directory(frame_directory_relative_path);
 				}
 
-				/* Create reusable surface. */
+				/* Preallocate the capture ring and start its writer thread. */
 				int height, width;
 				SDL_GetRendererOutputSize(renderer, &width, &height);
-				saving_surface = SDL_CreateRGBSurfaceWithFormat(0, width, height, 24, SDL_PIXELFORMAT_RGB24);
+				FrameCapture::Initialize(width, height, frame_directory_relative_path);
 
 				current_frame_start_timestamp = SDL_GetTicks();
 				frame_number = 0;
 				initialized = true;
 			}
 
-			/* Read the current renderer's data and persist it as a .bmp file to disk (BMP format is fast-to-write compared to PNG). */
-			if (SDL_RenderReadPixels(renderer, NULL, SDL_PIXELFORMAT_RGB24, saving_surface->pixels, saving_surface->pitch) != 0) {
-				SDL_Log("SDL_RenderReadPixels() failed: %s", SDL_GetError());
-			}
-			std::stringstream filenameStream;
-			filenameStream << "frame_" << std::setw(5) << std::setfill('0') << frame_number << ".bmp";
-			std::string output_file_name = filenameStream.str();
-			std::string output_file_path = frame_directory_relative_path + "/" + output_file_name;
-
-			if (SDL_SaveBMP(saving_surface, output_file_path.c_str()) != 0) {
-				SDL_Log("SDL_SaveBMP() failed: %s", SDL_GetError());
-			}
+			/* Read the current renderer's data; a background thread persists it as frames/frame_NNNNN.bmp (see FrameCapture.h). */
+			FrameCapture::Capture(renderer, frame_number);
 		}
 
 		/* Present and then wait for the next frame to begin */
@@ -147,10 +155,9 @@ public:
 	}
 
 	/* FEATURE : Render Logger */
-	/* Create a "RENDERLOGGER" environmental variable, run your engine, and check render_logger.txt. */
-	/* Use to compare to test case render_logger.txt files to see what goes wrong in your render. */
+	/* Create a "RENDERLOGGER" environmental variable, run your engine, and turn the render_logger.bin it writes into */
+	/* render_logger.txt with tools/render_log_format. Compare it to test case render_logger.txt files to see what goes wrong in your render. */
 	static inline RenderLoggerStatus render_logger_mode = RL_NOT_INITIALIZED;
-	static inline std::ofstream render_logging_file;
 	static void CheckForRenderLoggerInit()
 	{
 		/* Check environmental variable on first call. */
@@ -159,18 +166,13 @@ public:
 			if (IsLoggingMode())
 			{
 				render_logger_mode = RL_ENABLED;
-				std::ofstream file("render_logger.txt", std::ios::out); // delete the file if it exists.
-				render_logging_file.open("render_logger.txt", std::ios::app);
 
-				if (!render_logging_file.is_open())
+				/* Records are written by a background thread, see RenderLog.h. */
+				if (!RenderLog::Initialize("render_logger.bin"))
 				{
-					std::cerr << "Error : Failed to open render_logger.txt for writing." << std::endl;
+					std::cerr << "Error : Failed to open render_logger.bin for writing." << std::endl;
+					render_logger_mode = RL_NOT_ENABLED;
 				}
-
-				render_logging_file << "== RENDER LOGGER ==" << std::endl;
-				render_logging_file << "Study the following SDL_RenderCopyEx498() calls to debug render-related issues." << std::endl;
-				render_logging_file << "Enable render logger mode on your computer by setting the RENDERLOGGER environmental variable." << std::endl;
-				render_logging_file << "frame:actor_id:actor_name" << std::endl << std::endl;
 			}
 			else
 			{
@@ -186,14 +188,14 @@ public:
 
 		CheckForRenderLoggerInit();
 
-		/* Log render operation to file if necessary */
+		/* Log render operation if necessary */
 		if (render_logger_mode == RL_ENABLED)
 		{
 			float x_scale = 1;
 			float y_scale = 1;
 			SDL_RenderGetScale(renderer, &x_scale, &y_scale);
 
-			render_logging_file << GetFrameNumber() << ":" << actor_id << ":" << actor_name << " dstrect " << dstrect->x << " " << dstrect->y << " " << dstrect->w << " " << dstrect->h << " angle " << angle << " center " << center->x << " " << center->y << " flip " << flip << " renderscale " << x_scale << " " << y_scale << std::endl;
+			RenderLog::Draw(GetFrameNumber(), actor_id, actor_name, dstrect->x, dstrect->y, dstrect->w, dstrect->h, angle, center->x, center->y, flip, x_scale, y_scale);
 		}
 	}
 
@@ -335,7 +337,7 @@ private:
 	/* If the engine detects it is being autograded, it will run as fast as possible. */
 	static void SDL_Delay() {
 
-		if (_autograder_mode)
+		if (_autograder_mode || IsHeadlessMode())
 		{
 			//::SDL_Delay(1); Don't bother delaying at all. Gotta go fast when autograding.
 		}
@@ -0,0 +1,121 @@
+#ifndef MAIN_CPP_INSTANTIATIONQUEUE_H
+#define MAIN_CPP_INSTANTIATIONQUEUE_H
+
+#include <deque>
+#include <vector>
+#include <chrono>
+#include <utility>
+#include <algorithm>
+#include "rapidjson/document.h"
+#include "Lua/lua.hpp"
+#include "LuaBridge/LuaBridge.h"
+#include "Actor.h"
+
+// Actor.InstantiateDeferred(template, props) returns the actor at once, with its name and ID, but creates its
+// components (Lua tables, Rigidbody bodies) later, a few actors per frame, so that a spawn of thousands does
+// not land in one frame:
+//
+//   "instantiation_budget_ms": 2    in game.config: time per frame spent creating queued actors (default 2)
+//
+// Actors come out of the queue in the order they were requested, at least one per frame, and are then
+// added like Actor.Instantiate's: findable right away, OnStart on the next frame. actor:IsInstantiated()
+// is false until then. Destroying a queued actor, or loading another scene, takes it out of the queue.
+//
+// Lua: Debug.GetInstantiationStats() -> {queued=, last_frame_count=, last_frame_ms=, max_frame_ms=, total=}
+class InstantiationQueue
+{
+public:
+    struct Entry
+    {
+        Actor *actor;
+        const rapidjson::Document *actorTemplate; // owned by ComponentManager's template cache
+        luabridge::LuaRef props; // { [component key] = { property = value, ... } } or nil
+    };
+
+    static void LoadFromConfig(const rapidjson::Document &gameConfig)
+    {
+        if (gameConfig.HasMember("instantiation_budget_ms") && gameConfig["instantiation_budget_ms"].IsNumber())
+            budgetMs = gameConfig["instantiation_budget_ms"].GetDouble();
+    }
+
+    static void Enqueue(Actor *actor, const rapidjson::Document &actorTemplate, const luabridge::LuaRef &props)
+    {
+        actor->pendingInstantiation = true;
+        queue.push_back(Entry{actor, &actorTemplate, props});
+    }
+
+    // Once per frame: instantiate(entry) for queued actors until the frame's budget is spent
+    template<typename Instantiate>
+    static void Update(Instantiate &&instantiate)
+    {
+        auto start = std::chrono::steady_clock::now();
+        double elapsedMs = 0.0;
+        lastFrameCount = 0;
+        while (!queue.empty())
+        {
+            Entry entry = std::move(queue.front());
+            queue.pop_front();
+            entry.actor->pendingInstantiation = false;
+            instantiate(entry);
+            lastFrameCount++;
+
+            elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            if (elapsedMs >= budgetMs)
+                break;
+        }
+        lastFrameMs = lastFrameCount > 0 ? elapsedMs : 0.0;
+        maxFrameMs = std::max(maxFrameMs, lastFrameMs);
+        total += lastFrameCount;
+    }
+
+    // false if the actor was not queued
+    static bool Cancel(Actor *actor)
+    {
+        auto it = std::find_if(queue.begin(), queue.end(), [actor](const Entry &entry)
+        {
+            return entry.actor == actor;
+        });
+        if (it == queue.end())
+            return false;
+        actor->pendingInstantiation = false;
+        queue.erase(it);
+        return true;
+    }
+
+    // Empties the queue and returns its actors
+    static std::vector<Actor *> CancelAll()
+    {
+        std::vector<Actor *> actors;
+        for (const Entry &entry: queue)
+        {
+            entry.actor->pendingInstantiation = false;
+            actors.push_back(entry.actor);
+        }
+        queue.clear();
+        return actors;
+    }
+
+    // Lua: Debug.GetInstantiationStats()
+    static luabridge::LuaRef GetStats(lua_State *L)
+    {
+        luabridge::LuaRef stats = luabridge::newTable(L);
+        stats["queued"] = static_cast<int>(queue.size());
+        stats["last_frame_count"] = lastFrameCount;
+        stats["last_frame_ms"] = lastFrameMs;
+        stats["max_frame_ms"] = maxFrameMs;
+        stats["total"] = static_cast<double>(total);
+        return stats;
+    }
+
+private:
+    static inline double budgetMs = 2.0;
+    static inline std::deque<Entry> queue;
+
+    static inline int lastFrameCount = 0;
+    static inline double lastFrameMs = 0.0;
+    static inline double maxFrameMs = 0.0;
+    static inline uint64_t total = 0;
+};
+
+
+#endif //MAIN_CPP_INSTANTIATIONQUEUE_H
@@ -0,0 +1,381 @@
+#ifndef MAIN_CPP_JOBSYSTEM_H
+#define MAIN_CPP_JOBSYSTEM_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <initializer_list>
+#include <algorithm>
+#include <type_traits>
+#include <atomic>
+#include <iostream>
+#ifndef __EMSCRIPTEN__
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#endif
+#include "rapidjson/document.h"
+
+// Jobs started with the same counter; JobSystem::Wait(counter) returns once all of them have finished
+struct JobCounter
+{
+    std::atomic<int> pending{0};
+};
+
+// Work-stealing job scheduler for engine subsystems (render preparation, asset decoding, scene loading).
+//
+// Every thread has its own deque: it pushes and pops jobs at the back, idle threads steal from the front of
+// the others. Waiting threads run jobs instead of blocking, so jobs may start and wait on nested jobs.
+//
+//   "job_threads": 3    in game.config: worker threads besides the main thread
+//                       (default: one less than the hardware threads; 0 runs every job inline)
+//
+// Jobs must not touch Lua, the Box2D world or SDL rendering, none of which are thread-safe, and must not
+// throw. Emscripten builds have no threads and always run jobs inline.
+class JobSystem
+{
+public:
+    static constexpr int MAX_WORKERS = 63;
+
+    static void LoadFromConfig(const rapidjson::Document &gameConfig)
+    {
+        int workers = -1;
+        if (gameConfig.HasMember("job_threads") && gameConfig["job_threads"].IsInt())
+            workers = gameConfig["job_threads"].GetInt();
+        Initialize(workers);
+    }
+
+    // workers < 0 picks one less than the hardware threads
+    static void Initialize(int workers)
+    {
+        Shutdown();
+
+#ifdef __EMSCRIPTEN__
+        (void)workers;
+        workerCount = 0;
+#else
+        if (workers < 0)
+            workers = static_cast<int>(std::thread::hardware_concurrency()) - 1;
+        workers = std::clamp(workers, 0, MAX_WORKERS);
+
+        queues.clear();
+        for (int i = 0; i <= workers; i++)
+            queues.push_back(std::make_unique<Queue>());
+
+        stopping = false;
+        workerCount = workers; // before the workers start, which may Run nested jobs
+        for (int i = 1; i <= workers; i++)
+            threads.emplace_back(WorkerLoop, i);
+
+        static bool registered = false;
+        if (!registered)
+            registered = std::atexit(Shutdown) == 0; // Application.Quit() exits from inside the frame
+#endif
+    }
+
+    static void Shutdown()
+    {
+#ifndef __EMSCRIPTEN__
+        if (threads.empty())
+            return;
+
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread &thread : threads)
+            thread.join();
+        threads.clear();
+        workerCount = 0;
+#endif
+    }
+
+    // Threads that run jobs, the main thread included
+    static int GetThreadCount()
+    {
+        return workerCount + 1;
+    }
+
+    // 0 on the main thread (and any thread outside the pool), 1..workers on workers
+    static int GetThreadIndex()
+    {
+        return threadIndex;
+    }
+
+    static void Run(std::function<void()> function, JobCounter &counter)
+    {
+#ifndef __EMSCRIPTEN__
+        if (workerCount > 0)
+        {
+            counter.pending.fetch_add(1, std::memory_order_relaxed);
+            Queue &queue = *queues[threadIndex];
+            {
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                queue.jobs.push_back(Job{std::move(function), &counter});
+            }
+            queuedJobs.fetch_add(1);
+            if (sleepingWorkers.load() > 0)
+            {
+                // taking the lock orders this against a worker that is about to sleep
+                std::lock_guard<std::mutex> lock(sleepMutex);
+                wake.notify_one();
+            }
+            return;
+        }
+#endif
+        (void)counter;
+        function();
+    }
+
+    // For long jobs (file loading, decoding) that must not end up running inside a Wait or ParallelFor on the
+    // main thread: only workers pick these up, after their regular jobs. Runs inline without workers.
+    static void RunInBackground(std::function<void()> function, JobCounter &counter)
+    {
+#ifndef __EMSCRIPTEN__
+        if (workerCount > 0)
+        {
+            counter.pending.fetch_add(1, std::memory_order_relaxed);
+            {
+                std::lock_guard<std::mutex> lock(backgroundQueue.mutex);
+                backgroundQueue.jobs.push_back(Job{std::move(function), &counter});
+            }
+            {
+                std::lock_guard<std::mutex> lock(sleepMutex);
+                backgroundJobs.fetch_add(1);
+            }
+            wake.notify_one();
+            return;
+        }
+#endif
+        (void)counter;
+        function();
+    }
+
+    // Runs queued jobs on this thread until every job started with counter has finished
+    static void Wait(JobCounter &counter)
+    {
+#ifndef __EMSCRIPTEN__
+        while (counter.pending.load(std::memory_order_acquire) > 0)
+        {
+            if (!TryRunJob(threadIndex))
+                std::this_thread::yield();
+        }
+#else
+        (void)counter;
+#endif
+    }
+
+    // Calls body(begin, end) over [0, count) in chunks of grain (0: about four chunks per thread) and waits.
+    // The calling thread takes the first chunk.
+    template<typename Function>
+    static void ParallelFor(size_t count, size_t grain, Function &&body)
+    {
+        if (count == 0)
+            return;
+        if (grain == 0)
+            grain = std::max<size_t>(1, count / (static_cast<size_t>(GetThreadCount()) * 4));
+        if (workerCount == 0 || count <= grain)
+        {
+            body(size_t(0), count);
+            return;
+        }
+
+        // the chunk jobs capture this and their start only, which fits std::function's inline storage
+        struct Range
+        {
+            std::remove_reference_t<Function> *body;
+            size_t count;
+            size_t grain;
+        } range{&body, count, grain};
+
+        JobCounter counter;
+        for (size_t begin = grain; begin < count; begin += grain)
+        {
+            const Range *shared = &range;
+            Run([shared, begin]() { (*shared->body)(begin, std::min(shared->count, begin + shared->grain)); }, counter);
+        }
+        body(size_t(0), grain);
+        Wait(counter);
+    }
+
+private:
+    struct Job
+    {
+        std::function<void()> function;
+        JobCounter *counter;
+    };
+
+    static inline int workerCount = 0;
+    static inline thread_local int threadIndex = 0;
+
+#ifndef __EMSCRIPTEN__
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    static inline std::vector<std::unique_ptr<Queue>> queues; // [0] is the main thread's
+    static inline std::vector<std::thread> threads;
+    static inline Queue backgroundQueue;
+    static inline std::atomic<int> queuedJobs{0};
+    static inline std::atomic<int> backgroundJobs{0};
+    static inline std::atomic<int> sleepingWorkers{0};
+    static inline std::mutex sleepMutex;
+    static inline std::condition_variable wake;
+    static inline bool stopping = false; // guarded by sleepMutex
+
+    static void WorkerLoop(int index)
+    {
+        threadIndex = index;
+        while (true)
+        {
+            if (TryRunJob(index) || TryRunBackgroundJob())
+                continue;
+
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            sleepingWorkers.fetch_add(1);
+            wake.wait(lock, [] { return stopping || queuedJobs.load() > 0 || backgroundJobs.load() > 0; });
+            sleepingWorkers.fetch_sub(1);
+            if (stopping)
+                return;
+        }
+    }
+
+    // Own jobs newest first (still in cache), then the oldest job of another thread
+    static bool TryRunJob(int index)
+    {
+        Job job;
+        bool found = PopBack(*queues[index], job);
+        for (size_t i = 1; !found && i < queues.size(); i++)
+            found = PopFront(*queues[(index + i) % queues.size()], job);
+        if (!found)
+            return false;
+
+        queuedJobs.fetch_sub(1);
+        job.function();
+        job.counter->pending.fetch_sub(1, std::memory_order_release);
+        return true;
+    }
+
+    static bool TryRunBackgroundJob()
+    {
+        Job job;
+        if (!PopFront(backgroundQueue, job))
+            return false;
+
+        backgroundJobs.fetch_sub(1);
+        job.function();
+        job.counter->pending.fetch_sub(1, std::memory_order_release);
+        return true;
+    }
+
+    static bool PopBack(Queue &queue, Job &job)
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.jobs.empty())
+            return false;
+        job = std::move(queue.jobs.back());
+        queue.jobs.pop_back();
+        return true;
+    }
+
+    static bool PopFront(Queue &queue, Job &job)
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.jobs.empty())
+            return false;
+        job = std::move(queue.jobs.front());
+        queue.jobs.pop_front();
+        return true;
+    }
+#endif
+};
+
+// Tasks with dependencies, built once and run as often as needed:
+//
+//   TaskGraph graph;
+//   int decode = graph.Add(DecodeTextures);
+//   int layout = graph.Add(LayoutText);
+//   graph.Add(BuildDrawList, {decode, layout});
+//   graph.Run();
+//
+// A task starts as soon as everything it depends on has finished; Run returns when all tasks have.
+class TaskGraph
+{
+public:
+    int Add(std::function<void()> task, std::initializer_list<int> dependsOn = {})
+    {
+        // dependencies can only be tasks added earlier, so the graph can't have cycles
+        int id = static_cast<int>(tasks.size());
+        tasks.push_back(Task{std::move(task), {}, 0});
+        for (int dependency : dependsOn)
+        {
+            if (dependency < 0 || dependency >= id)
+            {
+                std::cout << "error: task " << id << " depends on unknown task " << dependency << std::endl;
+                continue;
+            }
+            tasks[dependency].successors.push_back(id);
+            tasks[id].dependencies++;
+        }
+        return id;
+    }
+
+    void Run()
+    {
+        remaining = std::vector<std::atomic<int>>(tasks.size());
+        for (size_t i = 0; i < tasks.size(); i++)
+            remaining[i].store(tasks[i].dependencies, std::memory_order_relaxed);
+
+        JobCounter counter;
+        for (size_t i = 0; i < tasks.size(); i++)
+        {
+            if (tasks[i].dependencies == 0)
+                Start(static_cast<int>(i), counter);
+        }
+        JobSystem::Wait(counter);
+    }
+
+    void Clear()
+    {
+        tasks.clear();
+    }
+
+    size_t Size() const
+    {
+        return tasks.size();
+    }
+
+private:
+    struct Task
+    {
+        std::function<void()> function;
+        std::vector<int> successors;
+        int dependencies;
+    };
+
+    std::vector<Task> tasks;
+    std::vector<std::atomic<int>> remaining;
+
+    void Start(int id, JobCounter &counter)
+    {
+        JobSystem::Run([this, id, &counter]()
+                       {
+                           tasks[id].function();
+                           for (int successor : tasks[id].successors)
+                           {
+                               if (remaining[successor].fetch_sub(1, std::memory_order_acq_rel) == 1)
+                                   Start(successor, counter);
+                           }
+                       }, counter);
+    }
+};
+
+
+#endif //MAIN_CPP_JOBSYSTEM_H
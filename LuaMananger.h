@@ -8,6 +8,9 @@
 #include "Lua/lua.hpp"
 #include "LuaBridge/LuaBridge.h"
 #include <vector>
+#include <string>
+#include <iostream>
+#include "AssetPack.h"
 
 class LuaManager
 {
@@ -17,6 +20,12 @@ public:
     static inline std::string currentSceneName;
     static inline bool sceneChange = false;
 
+    // Scene.LoadAsync, picked up by SceneLoader at the end of the frame
+    static inline std::string asyncSceneName;
+    static inline bool asyncSceneRequested = false;
+    static inline bool sceneLoading = false;
+    static inline float sceneLoadProgress = 1.0f;
+
 
     LuaManager()
     {
@@ -33,6 +42,18 @@ public:
         return lua_state;
     }
 
+    // luaL_dofile that also reads from resources.pak
+    static int DoFile(const std::string &path)
+    {
+        AssetPack::Asset asset{};
+        if (!AssetPack::Find(path, asset))
+            return luaL_dofile(lua_state, path.c_str());
+
+        std::string chunkName = "@" + path;
+        int status = luaL_loadbuffer(lua_state, asset.data, asset.size, chunkName.c_str());
+        return status != LUA_OK ? status : lua_pcall(lua_state, 0, LUA_MULTRET, 0);
+    }
+
     static std::string GetCurrentSceneName()
     {
         return currentSceneName;
@@ -43,6 +64,29 @@ public:
         nextSceneName = sceneName;
         sceneChange = true;
     }
+
+    static void LoadSceneAsync(const std::string &sceneName)
+    {
+        if (sceneLoading)
+        {
+            std::cout << "error: scene " << asyncSceneName << " is still loading" << std::endl;
+            return;
+        }
+        asyncSceneName = sceneName;
+        asyncSceneRequested = true;
+        sceneLoading = true;
+        sceneLoadProgress = 0.0f;
+    }
+
+    static float GetSceneLoadProgress()
+    {
+        return sceneLoadProgress;
+    }
+
+    static bool IsSceneLoading()
+    {
+        return sceneLoading;
+    }
 };
 
 
@@ -0,0 +1,285 @@
+#ifndef MAIN_CPP_LUASTATS_H
+#define MAIN_CPP_LUASTATS_H
+
+#include <cstdlib>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <unordered_map>
+#include "rapidjson/document.h"
+#include "Lua/lua.hpp"
+#include "LuaBridge/LuaBridge.h"
+#include "LuaMananger.h"
+
+// Cost of every component type (resources/component_types/*.lua): calls and wall time per lifecycle
+// function, plus the Lua memory allocated while that type's code was running.
+//
+//   "lua_stats": true                   in game.config turns the timers on
+//   "lua_stats_report_interval": 600    prints the top 10 every 600 frames
+//
+// Lua: Debug.GetStats(n) returns the n most expensive types, Debug.DumpStats(n) prints them,
+// Debug.ResetStats() starts over.
+class LuaStats
+{
+public:
+    enum Function
+    {
+        ON_START,
+        ON_UPDATE,
+        ON_LATE_UPDATE,
+        ON_DESTROY,
+        ON_COLLISION_ENTER,
+        ON_COLLISION_EXIT,
+        ON_TRIGGER_ENTER,
+        ON_TRIGGER_EXIT,
+        FUNCTION_COUNT
+    };
+
+    static constexpr const char *FUNCTION_NAMES[FUNCTION_COUNT] = {
+            "OnStart", "OnUpdate", "OnLateUpdate", "OnDestroy",
+            "OnCollisionEnter", "OnCollisionExit", "OnTriggerEnter", "OnTriggerExit"};
+
+    struct TypeStats
+    {
+        std::string type;
+        uint64_t calls[FUNCTION_COUNT] = {};
+        int64_t timeNs[FUNCTION_COUNT] = {};
+        uint64_t bytesAllocated = 0;
+        uint64_t allocations = 0;
+
+        int64_t TotalTimeNs() const
+        {
+            int64_t total = 0;
+            for (int64_t time: timeNs)
+                total += time;
+            return total;
+        }
+
+        uint64_t TotalCalls() const
+        {
+            uint64_t total = 0;
+            for (uint64_t count: calls)
+                total += count;
+            return total;
+        }
+    };
+
+    static inline bool enabled = false;
+    static inline int reportInterval = 0; // frames, 0 = never
+    static inline int framesRecorded = 0;
+
+    // Lua heap, whoever allocated it
+    static inline size_t liveBytes = 0;
+    static inline size_t peakBytes = 0;
+    static inline uint64_t allocations = 0; // blocks allocated or grown
+
+    // Times one lifecycle call and charges the Lua allocations it makes to the component's type
+    class Scope
+    {
+    public:
+        Scope(const luabridge::LuaRef *component, Function function)
+        {
+            if (!enabled)
+                return;
+
+            stats = &GetTypeStats(component);
+            this->function = function;
+            previous = current;
+            current = stats;
+            start = std::chrono::steady_clock::now();
+        }
+
+        ~Scope()
+        {
+            if (stats == nullptr)
+                return;
+
+            stats->timeNs[function] += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start).count();
+            stats->calls[function]++;
+            current = previous;
+        }
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        TypeStats *stats = nullptr;
+        TypeStats *previous = nullptr;
+        Function function = ON_UPDATE;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    static void LoadFromConfig(const rapidjson::Document &gameConfig)
+    {
+        if (gameConfig.HasMember("lua_stats") && gameConfig["lua_stats"].IsBool())
+            enabled = gameConfig["lua_stats"].GetBool();
+        if (gameConfig.HasMember("lua_stats_report_interval") && gameConfig["lua_stats_report_interval"].IsInt())
+            reportInterval = gameConfig["lua_stats_report_interval"].GetInt();
+    }
+
+    // lua_Alloc for lua_newstate, same contract as the default one in lauxlib
+    static void *Allocate(void *, void *ptr, size_t osize, size_t nsize)
+    {
+        size_t oldSize = ptr ? osize : 0; // for new blocks osize is the object type, not a size
+        if (nsize == 0)
+        {
+            liveBytes -= oldSize;
+            free(ptr);
+            return nullptr;
+        }
+
+        void *block = realloc(ptr, nsize);
+        if (block == nullptr)
+            return nullptr;
+
+        liveBytes = liveBytes - oldSize + nsize;
+        peakBytes = std::max(peakBytes, liveBytes);
+        if (nsize > oldSize)
+            allocations++;
+        if (current != nullptr && nsize > oldSize)
+        {
+            current->bytesAllocated += nsize - oldSize;
+            current->allocations++;
+        }
+        return block;
+    }
+
+    static void EndFrame(int frame)
+    {
+        if (!enabled)
+            return;
+
+        framesRecorded++;
+        if (reportInterval > 0 && frame > 0 && frame % reportInterval == 0)
+            DumpStats(10);
+    }
+
+    // Most expensive first (total time, then calls)
+    static std::vector<const TypeStats *> GetTopTypes(int count)
+    {
+        std::vector<const TypeStats *> sorted;
+        sorted.reserve(types.size());
+        for (const auto &[type, stats]: types)
+            sorted.push_back(&stats);
+
+        std::sort(sorted.begin(), sorted.end(), [](const TypeStats *a, const TypeStats *b)
+        {
+            if (a->TotalTimeNs() != b->TotalTimeNs())
+                return a->TotalTimeNs() > b->TotalTimeNs();
+            return a->type < b->type;
+        });
+
+        if (count >= 0 && sorted.size() > static_cast<size_t>(count))
+            sorted.resize(count);
+        return sorted;
+    }
+
+    // Lua: Debug.DumpStats(n)
+    static void DumpStats(int count)
+    {
+        if (count <= 0)
+            count = 10;
+
+        std::cout << "lua stats: " << framesRecorded << " frames, heap " << liveBytes / 1024 << " KB (peak "
+                  << peakBytes / 1024 << " KB)" << std::endl;
+        std::cout << std::fixed << std::setprecision(3);
+        for (const TypeStats *stats: GetTopTypes(count))
+        {
+            std::cout << "  " << std::left << std::setw(24) << stats->type << std::right
+                      << std::setw(10) << stats->TotalTimeNs() / 1.0e6 << " ms "
+                      << std::setw(9) << stats->TotalCalls() << " calls "
+                      << std::setw(9) << stats->bytesAllocated / 1024 << " KB alloc" << std::endl;
+
+            for (int function = 0; function < FUNCTION_COUNT; function++)
+            {
+                if (stats->calls[function] == 0)
+                    continue;
+                std::cout << "      " << std::left << std::setw(20) << FUNCTION_NAMES[function] << std::right
+                          << std::setw(10) << stats->timeNs[function] / 1.0e6 << " ms "
+                          << std::setw(9) << stats->calls[function] << " calls" << std::endl;
+            }
+        }
+        std::cout.unsetf(std::ios::floatfield);
+        std::cout << std::setprecision(6);
+    }
+
+    // Lua: Debug.GetStats(n) -> { {type=, time_ms=, calls=, bytes_allocated=, allocations=, functions={OnUpdate={calls=, time_ms=}, ...}}, ... }
+    static luabridge::LuaRef GetStats(int count)
+    {
+        lua_State *L = LuaManager::lua_state;
+        luabridge::LuaRef result = luabridge::newTable(L);
+        if (count <= 0)
+            count = 10;
+
+        int index = 1;
+        for (const TypeStats *stats: GetTopTypes(count))
+        {
+            luabridge::LuaRef entry = luabridge::newTable(L);
+            entry["type"] = stats->type;
+            entry["time_ms"] = stats->TotalTimeNs() / 1.0e6;
+            entry["calls"] = static_cast<lua_Integer>(stats->TotalCalls());
+            entry["bytes_allocated"] = static_cast<lua_Integer>(stats->bytesAllocated);
+            entry["allocations"] = static_cast<lua_Integer>(stats->allocations);
+
+            luabridge::LuaRef functions = luabridge::newTable(L);
+            for (int function = 0; function < FUNCTION_COUNT; function++)
+            {
+                if (stats->calls[function] == 0)
+                    continue;
+                luabridge::LuaRef functionStats = luabridge::newTable(L);
+                functionStats["calls"] = static_cast<lua_Integer>(stats->calls[function]);
+                functionStats["time_ms"] = stats->timeNs[function] / 1.0e6;
+                functions[FUNCTION_NAMES[function]] = functionStats;
+            }
+            entry["functions"] = functions;
+
+            result[index++] = entry;
+        }
+        return result;
+    }
+
+    // When a component leaves its actor, so its address can't be charged to its type once reused
+    static void Forget(const luabridge::LuaRef *component)
+    {
+        componentTypes.erase(component);
+    }
+
+    // Lua: Debug.ResetStats()
+    static void ResetStats()
+    {
+        for (auto &[type, stats]: types)
+        {
+            std::string name = std::move(stats.type);
+            stats = TypeStats();
+            stats.type = std::move(name);
+        }
+        framesRecorded = 0;
+        peakBytes = liveBytes;
+    }
+
+private:
+    static inline std::unordered_map<std::string, TypeStats> types;
+    static inline std::unordered_map<const luabridge::LuaRef *, TypeStats *> componentTypes; // component -> its type's stats
+    static inline TypeStats *current = nullptr; // type whose code is running, nullptr for the engine itself
+
+    static TypeStats &GetTypeStats(const luabridge::LuaRef *component)
+    {
+        auto it = componentTypes.find(component);
+        if (it != componentTypes.end())
+            return *it->second;
+
+        std::string type = (*component)["type"].tostring();
+        TypeStats &stats = types[type];
+        stats.type = type;
+        componentTypes[component] = &stats;
+        return stats;
+    }
+};
+
+
+#endif //MAIN_CPP_LUASTATS_H
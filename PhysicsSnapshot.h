@@ -0,0 +1,519 @@
+#ifndef MAIN_CPP_PHYSICSSNAPSHOT_H
+#define MAIN_CPP_PHYSICSSNAPSHOT_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+#include <unordered_set>
+#include <type_traits>
+#include "box2d.h"
+#include "Actor.h"
+#include "Rigidbody.h"
+
+namespace
+{
+    // b2Body::m_sleepTime is private without an accessor. Access is not checked for the arguments of an explicit
+    // instantiation, so one hands the member pointer to a friend function.
+    struct BodySleepTime
+    {
+        using Member = float b2Body::*;
+        friend Member GetMember(BodySleepTime);
+    };
+
+    template<typename Tag, typename Tag::Member Pointer>
+    struct PrivateMember
+    {
+        friend typename Tag::Member GetMember(Tag)
+        {
+            return Pointer;
+        }
+    };
+
+    template struct PrivateMember<BodySleepTime, &b2Body::m_sleepTime>;
+}
+
+// Serializes the state of the global b2World (and the Rigidbody components owning its bodies)
+// into a compact binary blob, for rollback, checkpoints and deterministic tests.
+//
+// Layout: Header, then for every body a BodyRecord followed by one FixtureRecord per fixture, then one
+// ContactRecord per contact in the world's contact list order.
+// Bodies are matched by actor id on restore, so the blob is only meaningful for the same set of actors.
+// Bodies created after the snapshot are left untouched and destroyed ones are not resurrected.
+//
+// SetTransform keeps the live contacts, with the impulses the solver warm starts from and the touching state
+// that decides begin / end callbacks. So contacts between restored bodies are rebuilt from the snapshot: same
+// manifold points and impulses, same touching flag, and the same list order, which is the order the solver
+// and the callbacks see them in. Body sleep timers are stored too.
+//
+// Box2D's broad phase (the fattened bounds and the tree new pairs are found in) is not stored. A restore followed
+// by the same steps repeats the original run bit for bit until fixtures that were apart in the snapshot start
+// touching: the broad phase may have created their contact in another list position, and from then on the run
+// can drift by rounding.
+class PhysicsSnapshot
+{
+public:
+    static constexpr uint32_t MAGIC = 0x504E5350; // "PSNP"
+    static constexpr uint16_t VERSION = 2;
+
+    struct Header
+    {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t reserved;
+        uint32_t bodyCount;
+        uint32_t fixtureCount;
+        uint32_t contactCount;
+    };
+
+    enum BodyFlags : uint8_t
+    {
+        FLAG_AWAKE = 1 << 0,
+        FLAG_ENABLED = 1 << 1,
+        FLAG_BULLET = 1 << 2,
+        FLAG_FIXED_ROTATION = 1 << 3,
+        FLAG_SLEEPING_ALLOWED = 1 << 4,
+        FLAG_COMPONENT_ENABLED = 1 << 5 // Rigidbody.enabled
+    };
+
+    struct BodyRecord
+    {
+        int32_t actorId;
+        uint16_t fixtureCount;
+        uint8_t type;
+        uint8_t flags;
+        float positionX, positionY, angle;
+        float velocityX, velocityY, angularVelocity;
+        float gravityScale, linearDamping, angularDamping;
+        float sleepTime;
+    };
+
+    struct FixtureRecord
+    {
+        float friction, restitution, density;
+        uint16_t categoryBits, maskBits;
+        int16_t groupIndex;
+        uint8_t isSensor;
+        uint8_t reserved;
+    };
+
+    struct ContactPointRecord
+    {
+        float localPointX, localPointY;
+        float normalImpulse, tangentImpulse;
+        uint32_t id; // b2ContactID::key, which matches the point up with the next step's
+    };
+
+    // Fixtures are identified by their actor and their index in the body's fixture list
+    struct ContactRecord
+    {
+        int32_t actorIdA, actorIdB;
+        uint16_t fixtureIndexA, fixtureIndexB;
+        int16_t childIndexA, childIndexB;
+        uint32_t flags; // b2Contact's: touching, enabled, ...
+        uint8_t manifoldType;
+        uint8_t pointCount;
+        uint16_t reserved;
+        float localNormalX, localNormalY, localPointX, localPointY;
+        ContactPointRecord points[b2_maxManifoldPoints];
+    };
+
+    static_assert(std::is_trivially_copyable<BodyRecord>::value, "BodyRecord is copied with memcpy");
+    static_assert(std::is_trivially_copyable<FixtureRecord>::value, "FixtureRecord is copied with memcpy");
+    static_assert(std::is_trivially_copyable<ContactRecord>::value, "ContactRecord is copied with memcpy");
+
+    // Named snapshots for Physics.SaveState / Physics.RestoreState
+    static inline std::unordered_map<std::string, std::vector<uint8_t>> slots;
+
+    static void Capture(std::vector<uint8_t> &out)
+    {
+        out.clear();
+        if (!world)
+            return;
+
+        out.reserve(sizeof(Header) + world->GetBodyCount() * (sizeof(BodyRecord) + 2 * sizeof(FixtureRecord)));
+        out.resize(sizeof(Header));
+
+        Header header = {MAGIC, VERSION, 0, 0, 0, 0};
+
+        for (b2Body *body = world->GetBodyList(); body; body = body->GetNext())
+        {
+            auto *rigidbody = reinterpret_cast<Rigidbody *>(body->GetUserData().pointer);
+            if (rigidbody == nullptr || rigidbody->actor == nullptr)
+                continue; // pooled (disabled) bodies belong to nobody
+
+            BodyRecord record{};
+            record.actorId = rigidbody->actor->actor_id;
+            record.type = static_cast<uint8_t>(body->GetType());
+            record.flags = (body->IsAwake() ? FLAG_AWAKE : 0) | (body->IsEnabled() ? FLAG_ENABLED : 0) |
+                           (body->IsBullet() ? FLAG_BULLET : 0) | (body->IsFixedRotation() ? FLAG_FIXED_ROTATION : 0) |
+                           (body->IsSleepingAllowed() ? FLAG_SLEEPING_ALLOWED : 0) |
+                           (rigidbody->enabled ? FLAG_COMPONENT_ENABLED : 0);
+            record.positionX = body->GetPosition().x;
+            record.positionY = body->GetPosition().y;
+            record.angle = body->GetAngle();
+            record.velocityX = body->GetLinearVelocity().x;
+            record.velocityY = body->GetLinearVelocity().y;
+            record.angularVelocity = body->GetAngularVelocity();
+            record.gravityScale = body->GetGravityScale();
+            record.linearDamping = body->GetLinearDamping();
+            record.angularDamping = body->GetAngularDamping();
+            record.sleepTime = body->*GetMember(BodySleepTime());
+
+            size_t recordOffset = out.size();
+            out.resize(recordOffset + sizeof(BodyRecord));
+
+            for (b2Fixture *fixture = body->GetFixtureList(); fixture; fixture = fixture->GetNext())
+            {
+                FixtureRecord fixtureRecord{};
+                fixtureRecord.friction = fixture->GetFriction();
+                fixtureRecord.restitution = fixture->GetRestitution();
+                fixtureRecord.density = fixture->GetDensity();
+                fixtureRecord.categoryBits = fixture->GetFilterData().categoryBits;
+                fixtureRecord.maskBits = fixture->GetFilterData().maskBits;
+                fixtureRecord.groupIndex = fixture->GetFilterData().groupIndex;
+                fixtureRecord.isSensor = fixture->IsSensor() ? 1 : 0;
+                Append(out, fixtureRecord);
+                record.fixtureCount++;
+            }
+
+            std::memcpy(out.data() + recordOffset, &record, sizeof(BodyRecord));
+            header.bodyCount++;
+            header.fixtureCount += record.fixtureCount;
+        }
+
+        for (b2Contact *contact = world->GetContactList(); contact; contact = contact->GetNext())
+        {
+            ContactRecord record{};
+            if (!Locate(contact->GetFixtureA(), record.actorIdA, record.fixtureIndexA) ||
+                !Locate(contact->GetFixtureB(), record.actorIdB, record.fixtureIndexB))
+                continue;
+
+            const b2Manifold *manifold = contact->GetManifold();
+            record.childIndexA = static_cast<int16_t>(contact->GetChildIndexA());
+            record.childIndexB = static_cast<int16_t>(contact->GetChildIndexB());
+            record.flags = ContactAccess::Flags(contact);
+            record.manifoldType = static_cast<uint8_t>(manifold->type);
+            record.pointCount = static_cast<uint8_t>(manifold->pointCount);
+            record.localNormalX = manifold->localNormal.x;
+            record.localNormalY = manifold->localNormal.y;
+            record.localPointX = manifold->localPoint.x;
+            record.localPointY = manifold->localPoint.y;
+            for (int32 i = 0; i < manifold->pointCount; i++)
+            {
+                const b2ManifoldPoint &point = manifold->points[i];
+                record.points[i] = {point.localPoint.x, point.localPoint.y, point.normalImpulse, point.tangentImpulse,
+                                    point.id.key};
+            }
+            Append(out, record);
+            header.contactCount++;
+        }
+
+        std::memcpy(out.data(), &header, sizeof(Header));
+    }
+
+    // Returns false if the blob is not a snapshot of this version
+    static bool Restore(const std::vector<uint8_t> &blob)
+    {
+        if (!world || blob.size() < sizeof(Header))
+            return false;
+
+        Header header{};
+        std::memcpy(&header, blob.data(), sizeof(Header));
+        if (header.magic != MAGIC || header.version != VERSION)
+        {
+            std::cout << "error: physics snapshot has an unknown format" << std::endl;
+            return false;
+        }
+
+        if (world->IsLocked())
+        {
+            std::cout << "error: physics snapshot restored during a physics step" << std::endl;
+            return false;
+        }
+
+        // actor id -> live body
+        std::unordered_map<int, b2Body *> bodies;
+        bodies.reserve(world->GetBodyCount());
+        for (b2Body *body = world->GetBodyList(); body; body = body->GetNext())
+        {
+            auto *rigidbody = reinterpret_cast<Rigidbody *>(body->GetUserData().pointer);
+            if (rigidbody != nullptr && rigidbody->actor != nullptr)
+                bodies[rigidbody->actor->actor_id] = body;
+        }
+
+        std::unordered_set<b2Body *> restored;
+        size_t offset = sizeof(Header);
+        for (uint32_t i = 0; i < header.bodyCount; i++)
+        {
+            if (offset + sizeof(BodyRecord) > blob.size())
+                return false;
+
+            BodyRecord record{};
+            std::memcpy(&record, blob.data() + offset, sizeof(BodyRecord));
+            offset += sizeof(BodyRecord);
+
+            size_t fixturesOffset = offset;
+            offset += record.fixtureCount * sizeof(FixtureRecord);
+            if (offset > blob.size())
+                return false;
+
+            auto it = bodies.find(record.actorId);
+            if (it == bodies.end())
+                continue; // the actor has been destroyed since
+
+            RestoreBody(it->second, record, blob.data() + fixturesOffset);
+            restored.insert(it->second);
+        }
+
+        if (offset + static_cast<uint64_t>(header.contactCount) * sizeof(ContactRecord) > blob.size())
+            return false;
+        std::vector<ContactRecord> contacts(header.contactCount);
+        if (!contacts.empty())
+            std::memcpy(contacts.data(), blob.data() + offset, contacts.size() * sizeof(ContactRecord));
+        RestoreContacts(contacts, bodies, restored);
+
+        return true;
+    }
+
+    static bool WriteToFile(const std::vector<uint8_t> &blob, const std::string &path)
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+            return false;
+        file.write(reinterpret_cast<const char *>(blob.data()), static_cast<std::streamsize>(blob.size()));
+        return file.good();
+    }
+
+    static bool ReadFromFile(const std::string &path, std::vector<uint8_t> &out)
+    {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file.is_open())
+            return false;
+        out.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(reinterpret_cast<char *>(out.data()), static_cast<std::streamsize>(out.size()));
+        return file.good();
+    }
+
+    // Lua: Physics.SaveState(name) / Physics.RestoreState(name)
+    static void SaveState(const std::string &name)
+    {
+        Capture(slots[name]);
+    }
+
+    static bool RestoreState(const std::string &name)
+    {
+        auto it = slots.find(name);
+        if (it == slots.end())
+            return false;
+        return Restore(it->second);
+    }
+
+    // Lua: Physics.SaveStateToFile(path) / Physics.RestoreStateFromFile(path), for level checkpoints
+    static bool SaveStateToFile(const std::string &path)
+    {
+        std::vector<uint8_t> blob;
+        Capture(blob);
+        return WriteToFile(blob, path);
+    }
+
+    static bool RestoreStateFromFile(const std::string &path)
+    {
+        std::vector<uint8_t> blob;
+        if (!ReadFromFile(path, blob))
+            return false;
+        return Restore(blob);
+    }
+
+private:
+    // b2Contact::m_flags and b2Fixture::m_proxies have no accessors; a derived class may name them
+    struct ContactAccess : b2Contact
+    {
+        static uint32 &Flags(b2Contact *contact)
+        {
+            return contact->*(&ContactAccess::m_flags);
+        }
+    };
+
+    struct FixtureAccess : b2Fixture
+    {
+        static int32 GetProxyCount(b2Fixture *fixture)
+        {
+            return fixture->*(&FixtureAccess::m_proxyCount);
+        }
+
+        static b2FixtureProxy *GetProxy(b2Fixture *fixture, int32 childIndex)
+        {
+            return (fixture->*(&FixtureAccess::m_proxies)) + childIndex;
+        }
+    };
+
+    template<typename T>
+    static void Append(std::vector<uint8_t> &out, const T &value)
+    {
+        size_t offset = out.size();
+        out.resize(offset + sizeof(T));
+        std::memcpy(out.data() + offset, &value, sizeof(T));
+    }
+
+    // The actor id and fixture list index of an owned fixture; false for pooled bodies
+    static bool Locate(b2Fixture *fixture, int32_t &actorId, uint16_t &fixtureIndex)
+    {
+        auto *rigidbody = reinterpret_cast<Rigidbody *>(fixture->GetBody()->GetUserData().pointer);
+        if (rigidbody == nullptr || rigidbody->actor == nullptr)
+            return false;
+
+        actorId = rigidbody->actor->actor_id;
+        fixtureIndex = 0;
+        for (b2Fixture *other = fixture->GetBody()->GetFixtureList(); other != fixture; other = other->GetNext())
+            fixtureIndex++;
+        return true;
+    }
+
+    static b2Fixture *FindFixture(const std::unordered_map<int, b2Body *> &bodies, int32_t actorId, uint16_t index)
+    {
+        auto it = bodies.find(actorId);
+        if (it == bodies.end())
+            return nullptr;
+
+        b2Fixture *fixture = it->second->GetFixtureList();
+        for (uint16_t i = 0; fixture && i < index; i++)
+            fixture = fixture->GetNext();
+        return fixture;
+    }
+
+    // Replaces the contacts between restored bodies with the snapshot's. Contacts with bodies that were not
+    // restored are kept as they are.
+    static void RestoreContacts(const std::vector<ContactRecord> &records,
+                                const std::unordered_map<int, b2Body *> &bodies,
+                                const std::unordered_set<b2Body *> &restored)
+    {
+        auto &manager = const_cast<b2ContactManager &>(world->GetContactManager());
+        b2ContactListener *listener = manager.m_contactListener;
+        manager.m_contactListener = nullptr; // replacing a contact must not end it for the scripts
+
+        for (b2Contact *contact = manager.m_contactList; contact;)
+        {
+            b2Contact *next = contact->GetNext();
+            if (restored.count(contact->GetFixtureA()->GetBody()) > 0 &&
+                restored.count(contact->GetFixtureB()->GetBody()) > 0)
+            {
+                contact->GetManifold()->pointCount = 0; // or b2Contact::Destroy wakes both bodies
+                manager.Destroy(contact);
+            }
+            contact = next;
+        }
+
+        // AddPair puts a new contact at the head of the world's and both bodies' lists, so the last one goes first
+        for (size_t i = records.size(); i-- > 0;)
+        {
+            const ContactRecord &record = records[i];
+            b2Fixture *fixtureA = FindFixture(bodies, record.actorIdA, record.fixtureIndexA);
+            b2Fixture *fixtureB = FindFixture(bodies, record.actorIdB, record.fixtureIndexB);
+            if (fixtureA == nullptr || fixtureB == nullptr ||
+                restored.count(fixtureA->GetBody()) == 0 || restored.count(fixtureB->GetBody()) == 0 ||
+                record.childIndexA < 0 || record.childIndexA >= FixtureAccess::GetProxyCount(fixtureA) ||
+                record.childIndexB < 0 || record.childIndexB >= FixtureAccess::GetProxyCount(fixtureB) ||
+                record.pointCount > b2_maxManifoldPoints)
+                continue;
+
+            b2Contact *head = manager.m_contactList;
+            manager.AddPair(FixtureAccess::GetProxy(fixtureA, record.childIndexA),
+                            FixtureAccess::GetProxy(fixtureB, record.childIndexB));
+            if (manager.m_contactList == head)
+                continue; // the pair is filtered out now
+
+            b2Contact *contact = manager.m_contactList;
+            b2Manifold *manifold = contact->GetManifold();
+            manifold->type = static_cast<b2Manifold::Type>(record.manifoldType);
+            manifold->pointCount = record.pointCount;
+            manifold->localNormal.Set(record.localNormalX, record.localNormalY);
+            manifold->localPoint.Set(record.localPointX, record.localPointY);
+            for (int32 p = 0; p < manifold->pointCount; p++)
+            {
+                const ContactPointRecord &point = record.points[p];
+                manifold->points[p].localPoint.Set(point.localPointX, point.localPointY);
+                manifold->points[p].normalImpulse = point.normalImpulse;
+                manifold->points[p].tangentImpulse = point.tangentImpulse;
+                manifold->points[p].id.key = point.id;
+            }
+            ContactAccess::Flags(contact) = record.flags;
+        }
+
+        manager.m_contactListener = listener;
+    }
+
+    static void RestoreBody(b2Body *body, const BodyRecord &record, const uint8_t *fixtureData)
+    {
+        auto *rigidbody = reinterpret_cast<Rigidbody *>(body->GetUserData().pointer);
+
+        auto type = static_cast<b2BodyType>(record.type);
+        if (body->GetType() != type)
+            body->SetType(type);
+
+        bool enabled = (record.flags & FLAG_ENABLED) != 0;
+        if (body->IsEnabled() != enabled)
+            body->SetEnabled(enabled);
+
+        body->SetTransform(b2Vec2(record.positionX, record.positionY), record.angle);
+        body->SetLinearVelocity(b2Vec2(record.velocityX, record.velocityY));
+        body->SetAngularVelocity(record.angularVelocity);
+        body->SetGravityScale(record.gravityScale);
+        body->SetLinearDamping(record.linearDamping);
+        body->SetAngularDamping(record.angularDamping);
+        body->SetBullet((record.flags & FLAG_BULLET) != 0);
+        body->SetFixedRotation((record.flags & FLAG_FIXED_ROTATION) != 0);
+        body->SetSleepingAllowed((record.flags & FLAG_SLEEPING_ALLOWED) != 0);
+        body->SetAwake((record.flags & FLAG_AWAKE) != 0);
+        body->*GetMember(BodySleepTime()) = record.sleepTime; // after SetAwake, which clears it
+
+        bool massChanged = false;
+        uint16_t index = 0;
+        for (b2Fixture *fixture = body->GetFixtureList(); fixture && index < record.fixtureCount;
+             fixture = fixture->GetNext(), index++)
+        {
+            FixtureRecord fixtureRecord{};
+            std::memcpy(&fixtureRecord, fixtureData + index * sizeof(FixtureRecord), sizeof(FixtureRecord));
+
+            fixture->SetFriction(fixtureRecord.friction);
+            fixture->SetRestitution(fixtureRecord.restitution);
+            fixture->SetSensor(fixtureRecord.isSensor != 0);
+            if (fixture->GetDensity() != fixtureRecord.density)
+            {
+                fixture->SetDensity(fixtureRecord.density);
+                massChanged = true;
+            }
+
+            // SetFilterData flags every contact of the body for re-filtering, so only do it when needed
+            const b2Filter &filter = fixture->GetFilterData();
+            if (filter.categoryBits != fixtureRecord.categoryBits || filter.maskBits != fixtureRecord.maskBits ||
+                filter.groupIndex != fixtureRecord.groupIndex)
+            {
+                b2Filter restored;
+                restored.categoryBits = fixtureRecord.categoryBits;
+                restored.maskBits = fixtureRecord.maskBits;
+                restored.groupIndex = fixtureRecord.groupIndex;
+                fixture->SetFilterData(restored);
+            }
+        }
+
+        if (massChanged)
+            body->ResetMassData();
+
+        // keep the component fields in sync with the body
+        rigidbody->enabled = (record.flags & FLAG_COMPONENT_ENABLED) != 0;
+        rigidbody->x = record.positionX;
+        rigidbody->y = record.positionY;
+        rigidbody->rotation = record.angle * (180.0f / b2_pi);
+        rigidbody->gravity_scale = record.gravityScale;
+        rigidbody->angular_friction = record.angularDamping;
+        rigidbody->precise = (record.flags & FLAG_BULLET) != 0;
+    }
+};
+
+
+#endif //MAIN_CPP_PHYSICSSNAPSHOT_H
@@ -0,0 +1,179 @@
+#ifndef MAIN_CPP_PROFILER_H
+#define MAIN_CPP_PROFILER_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+
+// Frame profiler: nested scoped zones, a ring buffer of the last FRAME_HISTORY frames and
+// an export to Chrome trace_event JSON (open it in chrome://tracing or https://ui.perfetto.dev).
+//
+// Build with -DENGINE_PROFILER (make PROFILER=1, or cmake -DENGINE_PROFILER=ON) to enable it.
+// Without it every PROFILE_* macro expands to nothing.
+//
+//   PROFILE_ZONE("Physics");          // times the enclosing scope
+//   PROFILE_END_FRAME(exportNow);     // once per frame, exportNow = the F9 hotkey
+//
+// Exporting: press F9, or set ENGINE_PROFILE_FRAME=N to export automatically when frame N ends.
+// The file is written to ENGINE_PROFILE_TRACE (default "profile_trace.json").
+class Profiler
+{
+public:
+    static constexpr int FRAME_HISTORY = 300;
+
+    // Zone names must be string literals (or otherwise outlive the profiler)
+    struct ZoneEvent
+    {
+        const char *name;
+        int64_t startNs; // relative to the profiler epoch
+        int64_t durationNs;
+        int depth;
+    };
+
+    struct FrameRecord
+    {
+        int frame = -1;
+        int64_t startNs = 0;
+        int64_t durationNs = 0;
+        std::vector<ZoneEvent> zones; // capacity is reused, so steady state does not allocate
+    };
+
+    class Zone
+    {
+    public:
+        explicit Zone(const char *name) : index(Profiler::BeginZone(name))
+        {
+        }
+
+        ~Zone()
+        {
+            Profiler::EndZone(index);
+        }
+
+        Zone(const Zone &) = delete;
+        Zone &operator=(const Zone &) = delete;
+
+    private:
+        size_t index;
+    };
+
+    static int64_t Now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    static size_t BeginZone(const char *name)
+    {
+        FrameRecord &record = CurrentFrame();
+        record.zones.push_back({name, Now(), 0, depth++});
+        return record.zones.size() - 1;
+    }
+
+    static void EndZone(size_t index)
+    {
+        depth--;
+        ZoneEvent &zone = CurrentFrame().zones[index];
+        zone.durationNs = Now() - zone.startNs;
+    }
+
+    // Closes the current frame and opens the next one
+    static void EndFrame(int frame, bool exportRequested)
+    {
+        FrameRecord &record = CurrentFrame();
+        record.frame = frame;
+        record.durationNs = Now() - record.startNs;
+
+        if (exportRequested || frame == GetExportFrame())
+            ExportChromeTrace(GetTracePath());
+
+        current = (current + 1) % FRAME_HISTORY;
+        FrameRecord &next = CurrentFrame();
+        next.frame = -1;
+        next.startNs = Now();
+        next.zones.clear();
+        depth = 0;
+    }
+
+    // Writes every recorded frame, oldest first, as "X" (complete) events
+    static bool ExportChromeTrace(const std::string &path)
+    {
+        std::ofstream file(path, std::ios::out | std::ios::trunc);
+        if (!file.is_open())
+        {
+            std::cout << "error: failed to open " << path << " for writing" << std::endl;
+            return false;
+        }
+
+        file << std::fixed << std::setprecision(3);
+        file << "{\"traceEvents\":[\n";
+        bool first = true;
+        for (int i = 1; i <= FRAME_HISTORY; i++)
+        {
+            const FrameRecord &record = frames[(current + i) % FRAME_HISTORY];
+            if (record.frame < 0)
+                continue;
+
+            WriteEvent(file, first, "Frame", record.startNs, record.durationNs, record.frame);
+            for (const ZoneEvent &zone: record.zones)
+                WriteEvent(file, first, zone.name, zone.startNs, zone.durationNs, record.frame);
+        }
+        file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+        std::cout << "profiler: wrote " << path << std::endl;
+        return file.good();
+    }
+
+private:
+    static inline const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    static inline std::vector<FrameRecord> frames = std::vector<FrameRecord>(FRAME_HISTORY);
+    static inline int current = 0;
+    static inline int depth = 0;
+
+    static FrameRecord &CurrentFrame()
+    {
+        return frames[current];
+    }
+
+    static int GetExportFrame()
+    {
+        static const int exportFrame = std::getenv("ENGINE_PROFILE_FRAME") ?
+                                       std::atoi(std::getenv("ENGINE_PROFILE_FRAME")) : -1;
+        return exportFrame;
+    }
+
+    static std::string GetTracePath()
+    {
+        const char *path = std::getenv("ENGINE_PROFILE_TRACE");
+        return path ? path : "profile_trace.json";
+    }
+
+    // Chrome trace timestamps are in microseconds
+    static void WriteEvent(std::ofstream &file, bool &first, const char *name, int64_t startNs, int64_t durationNs,
+                           int frame)
+    {
+        if (!first)
+            file << ",\n";
+        first = false;
+        file << "{\"name\":\"" << name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":" << startNs / 1000.0
+             << ",\"dur\":" << durationNs / 1000.0 << ",\"args\":{\"frame\":" << frame << "}}";
+    }
+};
+
+#ifdef ENGINE_PROFILER
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name) Profiler::Zone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_END_FRAME(exportRequested) Profiler::EndFrame(Helper::GetFrameNumber(), exportRequested)
+#else
+#define PROFILE_ZONE(name)
+#define PROFILE_END_FRAME(exportRequested)
+#endif
+
+
+#endif //MAIN_CPP_PROFILER_H
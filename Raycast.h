@@ -9,6 +9,7 @@
 #include "Actor.h"
 #include "Rigidbody.h"
 #include "LuaMananger.h"
+#include "CollisionLayers.h"
 #include <vector>
 #include <algorithm>
 
@@ -30,6 +31,7 @@ class RayCastCallback : public b2RayCastCallback
 {
 public:
     std::vector<HitResult> hits; // store all the hits
+    uint16 layerMask = CollisionLayers::ALL_LAYERS; // only fixtures on these layers are reported
 
     // This function is called for each fixture found in the query.
     // Return the fraction of the ray for the closest hit
@@ -43,6 +45,12 @@ public:
             return -1.0f;
         }
 
+        if ((fixture->GetFilterData().categoryBits & layerMask) == 0)
+        {
+            // Not on a layer we are looking for
+            return -1.0f;
+        }
+
         bool is_trigger = fixture->IsSensor();
         hits.emplace_back(actor, point, normal, is_trigger, fraction);
 
@@ -57,17 +65,51 @@ public:
     }
 };
 
+// Collects every actor whose fixtures overlap a query shape
+class OverlapCallback : public b2QueryCallback
+{
+public:
+    const b2Shape *shape = nullptr;
+    b2Transform transform;
+    uint16 layerMask = CollisionLayers::ALL_LAYERS;
+    std::vector<Actor *> actors;
+
+    bool ReportFixture(b2Fixture *fixture) override
+    {
+        auto *actor = reinterpret_cast<Actor *>(fixture->GetUserData().pointer);
+
+        // Phantom fixtures and fixtures on other layers are skipped
+        if (actor == nullptr || (fixture->GetFilterData().categoryBits & layerMask) == 0)
+            return true;
+
+        // The AABB test of QueryAABB is only a broad check
+        if (b2TestOverlap(shape, 0, fixture->GetShape(), 0, transform, fixture->GetBody()->GetTransform()))
+            actors.push_back(actor);
+
+        return true; // keep looking
+    }
+};
+
 class Physics
 {
 public:
 
+    // The optional "layers" argument of the queries is a comma separated list of layer names
+    static uint16 GetQueryMask(const luabridge::LuaRef &layers)
+    {
+        if (layers.isString())
+            return CollisionLayers::ParseMask(layers.cast<std::string>());
+        return CollisionLayers::ALL_LAYERS;
+    }
+
     // Perform a Raycast with Box2D and return the first actor hit on the path of the ray.
-    static luabridge::LuaRef Raycast(b2Vec2 pos, b2Vec2 dir, float dist)
+    static luabridge::LuaRef Raycast(b2Vec2 pos, b2Vec2 dir, float dist, luabridge::LuaRef layers)
     {
         // if the distance is 0/negative or there are no rigidbodies in existence
         if (!world || dist <= 0) return {LuaManager::lua_state}; // return nil
 
         RayCastCallback callback;
+        callback.layerMask = GetQueryMask(layers);
 
         dir.Normalize(); // Normalize the direction vector to avoid one-pixel issue
 
@@ -106,11 +148,12 @@ public:
 
     // Return all hits(fixtures) that occur during the raycast operation,
     // sorted by distance along the raycast(nearest to furthest)
-    static luabridge::LuaRef RaycastAll(const b2Vec2 &pos, const b2Vec2 &dir, float dist)
+    static luabridge::LuaRef RaycastAll(const b2Vec2 &pos, const b2Vec2 &dir, float dist, luabridge::LuaRef layers)
     {
         if (!world || dist <= 0) return {LuaManager::lua_state}; // return an empty vector
 
         RayCastCallback callback;
+        callback.layerMask = GetQueryMask(layers);
 
         b2Vec2 endPos = pos + dist * dir; // Not Normalized for now
 
@@ -135,6 +178,51 @@ public:
 
         return hitResultsTable; // Return the table filled with hit results
     }
+
+    // Return all actors overlapping a circle, ordered by actor id
+    static luabridge::LuaRef OverlapCircle(const b2Vec2 &center, float radius, luabridge::LuaRef layers)
+    {
+        b2CircleShape circle;
+        circle.m_radius = radius;
+        return Overlap(circle, center, GetQueryMask(layers));
+    }
+
+    // Return all actors overlapping an axis aligned box, ordered by actor id
+    static luabridge::LuaRef OverlapBox(const b2Vec2 &center, float width, float height, luabridge::LuaRef layers)
+    {
+        b2PolygonShape box;
+        box.SetAsBox(width * 0.5f, height * 0.5f);
+        return Overlap(box, center, GetQueryMask(layers));
+    }
+
+private:
+    static luabridge::LuaRef Overlap(const b2Shape &shape, const b2Vec2 &center, uint16 layerMask)
+    {
+        luabridge::LuaRef actorsTable = luabridge::newTable(LuaManager::lua_state);
+        if (!world) return actorsTable;
+
+        OverlapCallback callback;
+        callback.shape = &shape;
+        callback.transform.Set(center, 0.0f);
+        callback.layerMask = layerMask;
+
+        b2AABB aabb;
+        shape.ComputeAABB(&aabb, callback.transform, 0);
+        world->QueryAABB(&callback, aabb);
+
+        // a collider and a trigger of the same actor can both overlap
+        std::sort(callback.actors.begin(), callback.actors.end(), [](const Actor *a, const Actor *b)
+        {
+            return a->actor_id < b->actor_id;
+        });
+        callback.actors.erase(std::unique(callback.actors.begin(), callback.actors.end()), callback.actors.end());
+
+        for (size_t i = 0; i < callback.actors.size(); ++i)
+        {
+            actorsTable[i + 1] = callback.actors[i];
+        }
+        return actorsTable;
+    }
 };
 
 
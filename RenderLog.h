@@ -0,0 +1,234 @@
+#ifndef MAIN_CPP_RENDERLOG_H
+#define MAIN_CPP_RENDERLOG_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <ostream>
+#include <iostream>
+#ifndef __EMSCRIPTEN__
+#include <thread>
+#endif
+
+// One SDL_RenderCopyEx498 call, or the definition of an actor name. Names are written once, the first time
+// they are drawn: a RECORD_NAME whose `frame` holds the name length, followed by the name's bytes padded to
+// whole records. Everything else refers to them by nameId.
+struct RenderLogRecord
+{
+    enum Type : uint32_t
+    {
+        RECORD_DRAW,
+        RECORD_NAME
+    };
+
+    uint32_t type;
+    int32_t frame;
+    int32_t actorId;
+    uint32_t nameId;
+    int32_t x, y, w, h; // dstrect
+    double angle;
+    int32_t centerX, centerY;
+    int32_t flip;
+    float scaleX, scaleY;
+    uint32_t padding;
+};
+static_assert(sizeof(RenderLogRecord) == 64, "render log records are fixed size");
+
+// Binary render logger (RENDERLOGGER environment variable), see Helper::SDL_RenderCopyEx498.
+//
+// Draw calls append fixed-size records to a single producer / single consumer ring; a background thread
+// drains it into render_logger.bin in large writes. The main thread only blocks if the writer falls a full
+// ring behind, which is counted. tools/render_log_format turns the .bin into the render_logger.txt text
+// (FormatHeader and FormatDraw below, shared with the tool).
+//
+// Emscripten builds have no threads, so the ring is written out whenever it fills up and at exit.
+class RenderLog
+{
+public:
+    static constexpr char MAGIC[8] = {'R', 'E', 'N', 'D', 'L', 'O', 'G', '1'};
+    static constexpr size_t RING_RECORDS = 1 << 16; // 4 MB
+
+    static bool Initialize(const std::string &path)
+    {
+        file = std::fopen(path.c_str(), "wb");
+        if (file == nullptr)
+            return false;
+
+        std::fwrite(MAGIC, 1, sizeof(MAGIC), file);
+        ring.resize(RING_RECORDS);
+#ifndef __EMSCRIPTEN__
+        writer = std::thread(WriterLoop);
+#endif
+        std::atexit(Shutdown);
+        return true;
+    }
+
+    static void Draw(int frame, int actorId, const std::string &actorName, int x, int y, int w, int h, double angle,
+                     int centerX, int centerY, int flip, float scaleX, float scaleY)
+    {
+        RenderLogRecord record{};
+        record.type = RenderLogRecord::RECORD_DRAW;
+        record.frame = frame;
+        record.actorId = actorId;
+        record.nameId = GetNameId(actorName);
+        record.x = x;
+        record.y = y;
+        record.w = w;
+        record.h = h;
+        record.angle = angle;
+        record.centerX = centerX;
+        record.centerY = centerY;
+        record.flip = flip;
+        record.scaleX = scaleX;
+        record.scaleY = scaleY;
+        Push(record);
+        draws++;
+    }
+
+    // Writes whatever is still in the ring and closes the file; registered with atexit
+    static void Shutdown()
+    {
+        if (file == nullptr)
+            return;
+
+#ifndef __EMSCRIPTEN__
+        stopping.store(true);
+        if (writer.joinable())
+            writer.join();
+#else
+        Drain();
+#endif
+        std::fclose(file);
+        file = nullptr;
+
+        if (stalls > 0)
+            std::cout << "render logger: " << draws << " draws, main thread waited for the writer " << stalls
+                      << " times (" << stallMs << " ms)" << std::endl;
+    }
+
+    // The text render_logger.txt has always had, one line per draw
+    static void FormatHeader(std::ostream &out)
+    {
+        out << "== RENDER LOGGER ==" << "\n";
+        out << "Study the following SDL_RenderCopyEx498() calls to debug render-related issues." << "\n";
+        out << "Enable render logger mode on your computer by setting the RENDERLOGGER environmental variable." << "\n";
+        out << "frame:actor_id:actor_name" << "\n" << "\n";
+    }
+
+    static void FormatDraw(std::ostream &out, const RenderLogRecord &record, const std::string &actorName)
+    {
+        out << record.frame << ":" << record.actorId << ":" << actorName << " dstrect " << record.x << " " << record.y
+            << " " << record.w << " " << record.h << " angle " << record.angle << " center " << record.centerX << " "
+            << record.centerY << " flip " << record.flip << " renderscale " << record.scaleX << " " << record.scaleY
+            << "\n";
+    }
+
+private:
+    static inline FILE *file = nullptr;
+    static inline std::vector<RenderLogRecord> ring;
+    static inline std::atomic<size_t> writeIndex{0}; // advanced by the main thread
+    static inline std::atomic<size_t> readIndex{0}; // advanced by the writer
+    static inline std::unordered_map<std::string, uint32_t> nameIds;
+
+    static inline uint64_t draws = 0;
+    static inline uint64_t stalls = 0;
+    static inline double stallMs = 0.0;
+
+#ifndef __EMSCRIPTEN__
+    static inline std::thread writer;
+    static inline std::atomic<bool> stopping{false};
+#endif
+
+    static uint32_t GetNameId(const std::string &name)
+    {
+        auto it = nameIds.find(name);
+        if (it != nameIds.end())
+            return it->second;
+
+        uint32_t id = static_cast<uint32_t>(nameIds.size());
+        nameIds.emplace(name, id);
+
+        RenderLogRecord record{};
+        record.type = RenderLogRecord::RECORD_NAME;
+        record.frame = static_cast<int32_t>(name.size());
+        record.nameId = id;
+        Push(record);
+        for (size_t offset = 0; offset < name.size(); offset += sizeof(RenderLogRecord))
+        {
+            RenderLogRecord chunk{};
+            std::memcpy(&chunk, name.data() + offset, std::min(sizeof(RenderLogRecord), name.size() - offset));
+            Push(chunk);
+        }
+        return id;
+    }
+
+    static void Push(const RenderLogRecord &record)
+    {
+        size_t head = writeIndex.load(std::memory_order_relaxed);
+        if (head - readIndex.load(std::memory_order_acquire) == RING_RECORDS)
+            WaitForSpace(head);
+
+        ring[head & (RING_RECORDS - 1)] = record;
+        writeIndex.store(head + 1, std::memory_order_release);
+    }
+
+    static void WaitForSpace(size_t head)
+    {
+        stalls++;
+        auto start = std::chrono::steady_clock::now();
+#ifdef __EMSCRIPTEN__
+        (void)head;
+        Drain();
+#else
+        while (head - readIndex.load(std::memory_order_acquire) == RING_RECORDS)
+            std::this_thread::yield();
+#endif
+        stallMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Writes out every record published so far; returns false if there were none
+    static bool Drain()
+    {
+        size_t tail = readIndex.load(std::memory_order_relaxed);
+        size_t head = writeIndex.load(std::memory_order_acquire);
+        if (head == tail)
+            return false;
+
+        // at most two runs, split where the ring wraps
+        while (tail != head)
+        {
+            size_t start = tail & (RING_RECORDS - 1);
+            size_t count = std::min(head - tail, RING_RECORDS - start);
+            std::fwrite(&ring[start], sizeof(RenderLogRecord), count, file);
+            tail += count;
+        }
+        std::fflush(file);
+        readIndex.store(tail, std::memory_order_release);
+        return true;
+    }
+
+#ifndef __EMSCRIPTEN__
+    static void WriterLoop()
+    {
+        while (true)
+        {
+            bool finish = stopping.load();
+            if (Drain())
+                continue;
+            if (finish)
+                return; // nothing was published after stopping was set
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+#endif
+};
+
+
+#endif //MAIN_CPP_RENDERLOG_H
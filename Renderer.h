@@ -14,6 +14,8 @@
 #include "EngineUtils.h"
 #include "Helper.h"
 #include "Actor.h"
+#include "JobSystem.h"
+#include "TextureLoader.h"
 
 const SDL_Color DEFAULT_COLOR = {255, 255, 255, 255}; // White
 
@@ -56,12 +58,12 @@ public:
         };
     };
 
-    static inline std::queue<Renderer::TextRenderRequest> textRenderRequests;
+    static inline std::vector<Renderer::TextRenderRequest> textRenderRequests;
 
     static void ReadTextRenderRequest(std::string text, int x, int y, std::string font, int size, int r, int g, int b, int a){
         SDL_Color color = {static_cast<Uint8>(std::round(r)), static_cast<Uint8>(std::round(g)), static_cast<Uint8>(std::round(b)), static_cast<Uint8>(std::round(a))};
         Renderer::TextRenderRequest textRenderRequest = Renderer::TextRenderRequest(std::move(text), x, y, std::move(font), size, color);
-        textRenderRequests.push(textRenderRequest);
+        textRenderRequests.push_back(textRenderRequest);
     };
 
     class UIRenderRequest{
@@ -156,7 +158,41 @@ public:
         imageRenderRequests.emplace_back(imageRenderRequest);
     };
 
-    void RenderImage(const Renderer::ImageRenderRequest& imageRenderRequest);
+    // Image requests are drawn in two stages: PrepareImages computes every destination rect, culls and builds
+    // vertex data on the job system, then SubmitImages hands them to SDL on the main thread, one
+    // SDL_RenderGeometry call per run of requests that share a texture.
+    struct ImageTexture
+    {
+        SDL_Texture *texture;
+        int width;
+        int height;
+    };
+
+    struct PreparedImage
+    {
+        SDL_Texture *texture; // nullptr while the image still has to be loaded
+        SDL_Rect dstRect;
+        SDL_Point center;
+        SDL_RendererFlip flip;
+        bool visible;
+    };
+
+    std::unordered_map<std::string, ImageTexture> imageTextures;
+    std::vector<PreparedImage> preparedImages;
+    std::vector<SDL_Vertex> imageVertices; // four per request
+    std::vector<int> batchIndices;
+
+    void RenderImages(const std::vector<Renderer::ImageRenderRequest>& requests);
+    void PrepareImages(const std::vector<Renderer::ImageRenderRequest>& requests, bool cull);
+    void SubmitImages(const std::vector<Renderer::ImageRenderRequest>& requests, bool exact);
+    void PrepareImage(const Renderer::ImageRenderRequest& request, const ImageTexture& imageTexture, bool cull,
+                      PreparedImage& prepared, SDL_Vertex* vertices) const;
+    const ImageTexture& GetImageTexture(const std::string& image);
+    const ImageTexture& LoadImageTexture(const std::string& image);
+    // Uploads an image decoded ahead of time (IMG_Load on a loader thread) and frees the surface
+    void AddImageTexture(const std::string& image, SDL_Surface* surface);
+    // Textures for the images TextureLoader has decoded, within its per-frame budget
+    void UploadTextures();
 
     class PixelRenderRequest{
     public:
@@ -262,7 +298,7 @@ void Renderer::Initialize(const std::string &title, int width, int height)
 void Renderer::LoadClearColor()
 {
     // Check if rendering config exists
-    if (std::filesystem::exists("resources/rendering.config"))
+    if (AssetPack::Exists("resources/rendering.config"))
     {
         rapidjson::Document renderingConfig;
         EngineUtils::ReadJsonFile("resources/rendering.config", renderingConfig);
@@ -316,7 +352,7 @@ void Renderer::RenderText(Renderer::TextRenderRequest textRenderRequest)
     // Check if the font is already loaded
     if (fonts.find(fontName) == fonts.end())
     {
-        TTF_Font *font = TTF_OpenFont(fontPath.c_str(), fontSize); // load font from disk
+        TTF_Font *font = TTF_OpenFontRW(AssetPack::OpenRW(fontPath), 1, fontSize); // load font from disk or the pack
         fonts[fontName][fontSize] = font; // load font now
     }
 
@@ -358,15 +394,12 @@ void Renderer::RenderUIImage(Renderer::UIRenderRequest uiRenderRequest)
     int x = (int)uiRenderRequest.x; // explicit downcast to int
     int y = (int)uiRenderRequest.y; // explicit downcast to int
 
-    std::string fullPath = "resources/images/" + image + ".png";
-
-    SDL_Texture *textureUI = IMG_LoadTexture(renderer, fullPath.c_str());
-
-    textures[image] = textureUI; // Store the loaded texture in the textures map
+    const ImageTexture &imageTexture = GetImageTexture(image);
+    SDL_Texture *textureUI = imageTexture.texture;
+    if (textureUI == nullptr)
+        return;
 
-    int textureWidth, textureHeight;
-    SDL_QueryTexture(textureUI, nullptr, nullptr, &textureWidth, &textureHeight);
-    SDL_Rect dstRect = {x, y, textureWidth, textureHeight};
+    SDL_Rect dstRect = {x, y, imageTexture.width, imageTexture.height};
 
     // if uiRenderRequest.color is not the default color, then apply the color
     if (uiRenderRequest.color.r != DEFAULT_COLOR.r || uiRenderRequest.color.g != DEFAULT_COLOR.g ||
@@ -387,30 +420,100 @@ void Renderer::RenderUIImage(Renderer::UIRenderRequest uiRenderRequest)
     SDL_SetTextureAlphaMod(textureUI, DEFAULT_COLOR.a);
 }
 
-// Image.Draw&DrawEx(image_name, x, y)
-void Renderer::RenderImage(const Renderer::ImageRenderRequest& imageRenderRequest)
+// Image.Draw&DrawEx(image_name, x, y), every request of the frame in sorting order
+void Renderer::RenderImages(const std::vector<Renderer::ImageRenderRequest>& requests)
+{
+    // The render logger lists every call and frame captures are compared with other builds' frames, so
+    // those draw each image with its own SDL_RenderCopyEx, exactly as before.
+    bool exact = Helper::IsExactRenderingMode();
+    PrepareImages(requests, !Helper::IsRenderLoggingMode());
+    SubmitImages(requests, exact);
+}
+
+void Renderer::PrepareImages(const std::vector<Renderer::ImageRenderRequest>& requests, bool cull)
 {
-    std::string image = imageRenderRequest.image;
-    float x = imageRenderRequest.x; // pos_x
-    float y = imageRenderRequest.y; // pos_y
-    float pivot_x = imageRenderRequest.pivot_x;
-    float pivot_y = imageRenderRequest.pivot_y;
-    float scale_x = imageRenderRequest.scale_x;
-    float scale_y = imageRenderRequest.scale_y;
-
-    if (textures.find(image) == textures.end())
+    preparedImages.resize(requests.size());
+    imageVertices.resize(requests.size() * 4);
+
+    // textures are only looked up here, loading (or asking TextureLoader for) them happens on the main thread below
+    JobSystem::ParallelFor(requests.size(), 1024, [this, &requests, cull](size_t begin, size_t end)
     {
-        std::string fullPath = "resources/images/" + image + ".png";
-        SDL_Texture *texture = IMG_LoadTexture(renderer, fullPath.c_str());
+        for (size_t i = begin; i < end; i++)
+        {
+            auto it = imageTextures.find(requests[i].image);
+            if (it == imageTextures.end())
+            {
+                preparedImages[i].texture = nullptr;
+                continue;
+            }
+            PrepareImage(requests[i], it->second, cull, preparedImages[i], &imageVertices[i * 4]);
+        }
+    });
+
+    for (size_t i = 0; i < requests.size(); i++)
+    {
+        if (preparedImages[i].texture == nullptr)
+            PrepareImage(requests[i], GetImageTexture(requests[i].image), cull, preparedImages[i], &imageVertices[i * 4]);
+    }
+}
+
+// The image's texture once it has one. Until then the placeholder (or nothing) while TextureLoader decodes it,
+// unless the frame has to match other builds' or there is no worker to decode on.
+const Renderer::ImageTexture& Renderer::GetImageTexture(const std::string& image)
+{
+    auto it = imageTextures.find(image);
+    if (it != imageTextures.end())
+        return it->second;
+    if (Helper::IsExactRenderingMode() || JobSystem::GetThreadCount() == 1 || image == TextureLoader::placeholder)
+        return LoadImageTexture(image);
+
+    TextureLoader::Request(image);
+    static const ImageTexture loading = {nullptr, 0, 0};
+    return TextureLoader::placeholder.empty() ? loading : LoadImageTexture(TextureLoader::placeholder);
+}
+
+const Renderer::ImageTexture& Renderer::LoadImageTexture(const std::string& image)
+{
+    auto it = imageTextures.find(image);
+    if (it != imageTextures.end())
+        return it->second;
+
+    std::string fullPath = "resources/images/" + image + ".png";
+    SDL_Texture *texture = IMG_LoadTexture_RW(renderer, AssetPack::OpenRW(fullPath), 1);
+    textures[image] = texture; // Store the loaded texture in the textures map
+
+    ImageTexture imageTexture = {texture, 0, 0};
+    SDL_QueryTexture(texture, nullptr, nullptr, &imageTexture.width, &imageTexture.height);
+    return imageTextures.emplace(image, imageTexture).first->second;
+}
 
-        textures[image] = texture; // Store the loaded texture in the textures map
+void Renderer::AddImageTexture(const std::string& image, SDL_Surface* surface)
+{
+    if (imageTextures.find(image) == imageTextures.end())
+    {
+        // an image that failed to load stays without a texture, as with IMG_LoadTexture
+        SDL_Texture *texture = surface != nullptr ? SDL_CreateTextureFromSurface(renderer, surface) : nullptr;
+        textures[image] = texture;
+        imageTextures.emplace(image, texture != nullptr ? ImageTexture{texture, surface->w, surface->h} :
+                                     ImageTexture{nullptr, 0, 0});
     }
+    SDL_FreeSurface(surface);
+}
 
-    SDL_Texture* texture = textures[image];
+void Renderer::UploadTextures()
+{
+    TextureLoader::Update([this](const std::string& image, SDL_Surface* surface)
+    {
+        AddImageTexture(image, surface);
+    });
+}
 
-    int textureWidth, textureHeight;
-    SDL_QueryTexture(texture, nullptr, nullptr, &textureWidth, &textureHeight);
-    SDL_Rect dstRect;
+// Runs on worker threads: reads the camera and the window size, touches nothing but its own outputs
+void Renderer::PrepareImage(const Renderer::ImageRenderRequest& request, const ImageTexture& imageTexture, bool cull,
+                            PreparedImage& prepared, SDL_Vertex* vertices) const
+{
+    float scale_x = request.scale_x;
+    float scale_y = request.scale_y;
 
     int flip_mode = SDL_FLIP_NONE;
     if (scale_x < 0)
@@ -424,37 +527,108 @@ void Renderer::RenderImage(const Renderer::ImageRenderRequest& imageRenderReques
         flip_mode = SDL_FLIP_VERTICAL;
     }
 
-    int final_pixel_pivot_x = static_cast<int>(pivot_x * (float)textureWidth * scale_x);
-    int final_pixel_pivot_y = static_cast<int>(pivot_y * (float)textureHeight * scale_y);
+    int final_pixel_pivot_x = static_cast<int>(request.pivot_x * (float)imageTexture.width * scale_x);
+    int final_pixel_pivot_y = static_cast<int>(request.pivot_y * (float)imageTexture.height * scale_y);
 
-    dstRect.x = static_cast<int>((x - Camera::cam_pos_x) * 100.0f + (float)window_width * 0.5f * (1.0f / Camera::zoom_factor)
+    SDL_Rect &dstRect = prepared.dstRect;
+    dstRect.x = static_cast<int>((request.x - Camera::cam_pos_x) * 100.0f + (float)window_width * 0.5f * (1.0f / Camera::zoom_factor)
             - (float)final_pixel_pivot_x);
-    dstRect.y = static_cast<int>((y - Camera::cam_pos_y) * 100.0f + (float)window_height * 0.5f * (1.0f / Camera::zoom_factor)
+    dstRect.y = static_cast<int>((request.y - Camera::cam_pos_y) * 100.0f + (float)window_height * 0.5f * (1.0f / Camera::zoom_factor)
             - (float)final_pixel_pivot_y);
+    dstRect.w = static_cast<int>((float)imageTexture.width * scale_x);
+    dstRect.h = static_cast<int>((float)imageTexture.height * scale_y);
+
+    prepared.texture = imageTexture.texture;
+    prepared.center = {final_pixel_pivot_x, final_pixel_pivot_y};
+    prepared.flip = static_cast<SDL_RendererFlip>(flip_mode);
+
+    // corners around the pivot, rotated clockwise like SDL_RenderCopyEx does
+    float centerX = (float)(dstRect.x + final_pixel_pivot_x);
+    float centerY = (float)(dstRect.y + final_pixel_pivot_y);
+    float left = (float)-final_pixel_pivot_x;
+    float top = (float)-final_pixel_pivot_y;
+    float right = left + (float)dstRect.w;
+    float bottom = top + (float)dstRect.h;
+    float radians = (float)request.rotation * (3.14159265f / 180.0f);
+    float c = std::cos(radians);
+    float s = std::sin(radians);
+
+    const float corners[4][2] = {{left, top}, {right, top}, {right, bottom}, {left, bottom}};
+    float u0 = flip_mode == SDL_FLIP_HORIZONTAL ? 1.0f : 0.0f;
+    float v0 = flip_mode == SDL_FLIP_VERTICAL ? 1.0f : 0.0f;
+    const float uvs[4][2] = {{u0, v0}, {1.0f - u0, v0}, {1.0f - u0, 1.0f - v0}, {u0, 1.0f - v0}};
+    for (int k = 0; k < 4; k++)
+    {
+        vertices[k].position.x = corners[k][0] * c - corners[k][1] * s + centerX;
+        vertices[k].position.y = corners[k][0] * s + corners[k][1] * c + centerY;
+        vertices[k].color = request.color;
+        vertices[k].tex_coord.x = uvs[k][0];
+        vertices[k].tex_coord.y = uvs[k][1];
+    }
 
-    dstRect.w = static_cast<int>((float)textureWidth * scale_x);
-    dstRect.h = static_cast<int>((float)textureHeight * scale_y);
-
-    SDL_Point center = {final_pixel_pivot_x, final_pixel_pivot_y};
-
-    // if imageRenderRequest.color is not the default color, then apply the color
-    if (imageRenderRequest.color.r != DEFAULT_COLOR.r || imageRenderRequest.color.g != DEFAULT_COLOR.g ||
-        imageRenderRequest.color.b != DEFAULT_COLOR.b)
+    // off screen in render coordinates (the frame is drawn with SDL_RenderSetScale(zoom))? The radius of the
+    // rotated rect around its pivot bounds it at any angle.
+    prepared.visible = imageTexture.texture != nullptr; // SDL_RenderCopyEx drew nothing for failed loads
+    if (cull && prepared.visible)
     {
-        SDL_SetTextureColorMod(texture, imageRenderRequest.color.r, imageRenderRequest.color.g, imageRenderRequest.color.b);
+        float radius = std::sqrt(std::max(left * left, right * right) + std::max(top * top, bottom * bottom));
+        float viewWidth = (float)window_width / Camera::zoom_factor;
+        float viewHeight = (float)window_height / Camera::zoom_factor;
+        prepared.visible = centerX + radius >= 0.0f && centerX - radius <= viewWidth &&
+                           centerY + radius >= 0.0f && centerY - radius <= viewHeight;
     }
+}
 
-    if (imageRenderRequest.color.a != DEFAULT_COLOR.a)
+void Renderer::SubmitImages(const std::vector<Renderer::ImageRenderRequest>& requests, bool exact)
+{
+    if (exact)
     {
-        SDL_SetTextureAlphaMod(texture, imageRenderRequest.color.a);
+        for (size_t i = 0; i < requests.size(); i++)
+        {
+            const Renderer::ImageRenderRequest &request = requests[i];
+            const PreparedImage &prepared = preparedImages[i];
+            if (!prepared.visible)
+                continue;
+
+            // if request.color is not the default color, then apply the color
+            if (request.color.r != DEFAULT_COLOR.r || request.color.g != DEFAULT_COLOR.g || request.color.b != DEFAULT_COLOR.b)
+                SDL_SetTextureColorMod(prepared.texture, request.color.r, request.color.g, request.color.b);
+            if (request.color.a != DEFAULT_COLOR.a)
+                SDL_SetTextureAlphaMod(prepared.texture, request.color.a);
+
+            Helper::SDL_RenderCopyEx498(0, "actor", renderer, prepared.texture, nullptr, &prepared.dstRect,
+                                        request.rotation, &prepared.center, prepared.flip);
+
+            // Reset color and alpha modifications
+            SDL_SetTextureColorMod(prepared.texture, DEFAULT_COLOR.r, DEFAULT_COLOR.g, DEFAULT_COLOR.b);
+            SDL_SetTextureAlphaMod(prepared.texture, DEFAULT_COLOR.a);
+        }
+        return;
     }
 
-    Helper::SDL_RenderCopyEx498(0, "actor", renderer, texture, nullptr, &dstRect,
-                                imageRenderRequest.rotation, &center, static_cast<SDL_RendererFlip> (flip_mode));
+    // consecutive requests with the same texture go out in one call; sorting order is kept
+    SDL_Texture *batchTexture = nullptr;
+    batchIndices.clear();
+    for (size_t i = 0; i <= preparedImages.size(); i++)
+    {
+        bool last = i == preparedImages.size();
+        if (!last && !preparedImages[i].visible)
+            continue;
 
-    // Reset color and alpha modifications
-    SDL_SetTextureColorMod(texture, DEFAULT_COLOR.r, DEFAULT_COLOR.g, DEFAULT_COLOR.b);
-    SDL_SetTextureAlphaMod(texture, DEFAULT_COLOR.a);
+        if (last || preparedImages[i].texture != batchTexture)
+        {
+            if (!batchIndices.empty())
+                SDL_RenderGeometry(renderer, batchTexture, imageVertices.data(), static_cast<int>(imageVertices.size()),
+                                   batchIndices.data(), static_cast<int>(batchIndices.size()));
+            batchIndices.clear();
+            if (last)
+                break;
+            batchTexture = preparedImages[i].texture;
+        }
+
+        int first = static_cast<int>(i * 4);
+        batchIndices.insert(batchIndices.end(), {first, first + 1, first + 2, first + 2, first + 3, first});
+    }
 }
 
 void Renderer::RenderPixel(const Renderer::PixelRenderRequest& pixelRenderRequest)
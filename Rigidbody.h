@@ -8,9 +8,12 @@
 #include <iostream>
 #include <string>
 #include <cmath>
+#include <vector>
+#include <unordered_map>
 // #include "Actor.h"
 #include "box2d.h"
 #include "Helper.h"
+#include "CollisionLayers.h"
 
 // If we want to make rigidbody as a C++ component, we need to:
 // 1. Create a class that has variables a standard component has
@@ -19,6 +22,71 @@
 
 class Actor; // forward declaration
 
+// Recycles b2Bodys of frequently spawned templates (Rigidbody.pooled = true).
+// A released body is disabled instead of destroyed, which also removes it from the broad phase,
+// and is re-enabled by the next Rigidbody with the same shape signature.
+class BodyPool
+{
+public:
+    static inline size_t maxPooledPerTemplate = 256; // "body_pool_size" in game.config
+
+    static inline std::unordered_map<std::string, std::vector<b2Body *>> freeBodies; // pool key -> disabled bodies
+
+    // bodies released while the world is locked (inside a contact callback)
+    static inline std::vector<std::pair<b2Body *, std::string>> pendingReleases;
+
+    static b2Body *Acquire(const std::string &poolKey)
+    {
+        auto it = freeBodies.find(poolKey);
+        if (it == freeBodies.end() || it->second.empty())
+            return nullptr;
+
+        b2Body *body = it->second.back();
+        it->second.pop_back();
+        return body;
+    }
+
+    // An empty pool key means the body is not pooled and is destroyed
+    static void Release(b2Body *body, const std::string &poolKey)
+    {
+        if (world->IsLocked())
+        {
+            pendingReleases.emplace_back(body, poolKey);
+            return;
+        }
+
+        // stale actor pointers must not reach contact callbacks or queries
+        body->GetUserData().pointer = 0;
+        for (b2Fixture *fixture = body->GetFixtureList(); fixture; fixture = fixture->GetNext())
+        {
+            fixture->GetUserData().pointer = 0;
+        }
+
+        if (poolKey.empty() || freeBodies[poolKey].size() >= maxPooledPerTemplate)
+        {
+            world->DestroyBody(body);
+            return;
+        }
+
+        body->SetEnabled(false);
+        freeBodies[poolKey].push_back(body);
+    }
+
+    // Call once the world is unlocked again (after b2World::Step)
+    static void ProcessPendingReleases()
+    {
+        if (pendingReleases.empty())
+            return;
+
+        auto releases = std::move(pendingReleases);
+        pendingReleases.clear();
+        for (auto &[body, poolKey]: releases)
+        {
+            Release(body, poolKey);
+        }
+    }
+};
+
 class Rigidbody
 {
 public:
@@ -59,15 +127,17 @@ public:
     float trigger_height = 1.0f;
     float trigger_radius = 0.5f; // use b2CircleShape and .m_radius when creating a fixture
 
+    std::string layer = "default"; // collision layer declared in game.config
+    std::string collides_with; // comma separated layer names, empty means use the game.config layer matrix
+
+    bool pooled = false; // recycle the b2Body through the BodyPool instead of destroying it
+
     // To ensure it will be seen as a C++ component:
     std::string componentType = "Rigidbody";
     std::string key = "???";
     Actor *actor = nullptr;
     bool enabled = true;
 
-    const uint16 BOX2D_CATEGORY_COLLIDER = 0x0001;
-    const uint16 BOX2D_CATEGORY_SENSOR = 0x0002;
-
     b2Vec2 GetBodyPosition() const
     {
         // x and y govern "where" a body is considered to be prior
@@ -88,14 +158,17 @@ public:
     }
 
     /// to alter an associated b2Body -
+    // Without a body (before Ready, or after Release) there is nothing to push or move
     void AddForce(const b2Vec2 &force) const
     {
-        body->ApplyForceToCenter(force, true);
+        if (body != nullptr)
+            body->ApplyForceToCenter(force, true);
     }
 
     void SetVelocity(const b2Vec2 &velocity) const
     {
-        body->SetLinearVelocity(velocity);
+        if (body != nullptr)
+            body->SetLinearVelocity(velocity);
     }
 
     void SetPosition(const b2Vec2 &position)
@@ -126,13 +199,50 @@ public:
 
     void SetAngularVelocity(float degrees_clockwise)
     {
+        if (body == nullptr)
+            return;
         float radians = degrees_clockwise * (b2_pi / 180.0f);
         body->SetAngularVelocity(radians);
     }
 
-    void SetGravityScale(float scale) const
+    void SetGravityScale(float scale)
     {
-        body->SetGravityScale(scale);
+        if (body == nullptr)
+        {
+            gravity_scale = scale;
+        }
+        else
+        {
+            body->SetGravityScale(scale);
+        }
+    }
+
+    // Move the body to another collision layer (and optionally change what it collides with)
+    // Box2D re-filters existing contacts on the next step
+    void SetLayer(const std::string &new_layer, const std::string &new_collides_with)
+    {
+        layer = new_layer;
+        collides_with = new_collides_with;
+
+        if (body == nullptr)
+            return;
+
+        b2Filter filter = GetLayerFilter();
+        for (b2Fixture *fixture = body->GetFixtureList(); fixture; fixture = fixture->GetNext())
+        {
+            // phantom fixtures have no actor and stay out of every query
+            if (fixture->GetUserData().pointer != 0)
+                fixture->SetFilterData(filter);
+        }
+    }
+
+    b2Filter GetLayerFilter() const
+    {
+        b2Filter filter;
+        filter.categoryBits = CollisionLayers::GetCategoryBits(layer);
+        filter.maskBits = collides_with.empty() ? CollisionLayers::GetMaskBits(layer)
+                                                : CollisionLayers::ParseMask(collides_with);
+        return filter;
     }
 
     // This performs a rotation of the rigidbody such that its local "up" vector
@@ -144,7 +254,7 @@ public:
         b2Vec2 normalized_direction = direction;
         normalized_direction.Normalize();
         float new_angle_radians = glm::atan(normalized_direction.x, -normalized_direction.y);
-        body->SetTransform(body->GetPosition(), new_angle_radians);
+        SetRotation(new_angle_radians * (180.0f / b2_pi));
     }
 
     // This performs a rotation of the rigidbody such that its local "right" vector
@@ -154,13 +264,15 @@ public:
         b2Vec2 normalized_direction = direction;
         normalized_direction.Normalize();
         float new_angle_radians = glm::atan(normalized_direction.x, -normalized_direction.y) - (b2_pi / 2.0f);
-        body->SetTransform(body->GetPosition(), new_angle_radians);
+        SetRotation(new_angle_radians * (180.0f / b2_pi));
     }
 
     /// functions to check an associated b2Body -
     // use b2Body::GetLinearVelocity() to get the velocity of the body
     b2Vec2 GetVelocity() const
     {
+        if (body == nullptr)
+            return {0.0f, 0.0f};
         return body->GetLinearVelocity();
     }
 
@@ -169,12 +281,16 @@ public:
     {
         // std::cout << "GetAngularVelocity called" << std::endl;
         // std::cout << "angular velocity got as: " << body->GetAngularVelocity() * (180.0f / b2_pi) << std::endl;
+        if (body == nullptr)
+            return 0.0f;
         return body->GetAngularVelocity() * (180.0f / b2_pi);
     }
 
     // use b2Body::GetGravityScale() to get the gravity scale of the body
     float GetGravityScale() const
     {
+        if (body == nullptr)
+            return gravity_scale;
         return body->GetGravityScale();
     }
 
@@ -182,7 +298,7 @@ public:
     // This is the vector that points locally "up" out of a body, changing as it rotates
     b2Vec2 GetUpDirection() const
     {
-        float angle = body->GetAngle();
+        float angle = GetBodyRotation() * (b2_pi / 180.0f);
         b2Vec2 result = b2Vec2(glm::sin(angle), -glm::cos(angle));
         result.Normalize();
         return result;
@@ -192,12 +308,40 @@ public:
     // This is the vector that points locally "right" out of a body, changing as it rotates
     b2Vec2 GetRightDirection() const
     {
-        float angle = body->GetAngle();
+        float angle = GetBodyRotation() * (b2_pi / 180.0f);
         b2Vec2 result = b2Vec2(glm::cos(angle), glm::sin(angle));
         result.Normalize();
         return result;
     }
 
+    // Bodies can only be recycled between rigidbodies with identical fixture shapes
+    std::string GetPoolKey() const
+    {
+        std::string poolKey = "c";
+        if (has_collider)
+            poolKey += collider_type + ":" + std::to_string(width) + ":" + std::to_string(height) + ":" +
+                       std::to_string(radius);
+        poolKey += "|t";
+        if (has_trigger)
+            poolKey += trigger_type + ":" + std::to_string(trigger_width) + ":" + std::to_string(trigger_height) + ":" +
+                       std::to_string(trigger_radius);
+        if (!has_collider && !has_trigger)
+            poolKey += "|p" + std::to_string(width) + ":" + std::to_string(height);
+        return poolKey;
+    }
+
+    // Give the b2Body back to the world (or the pool). Safe to call from contact callbacks.
+    void Release()
+    {
+        if (body == nullptr)
+            return;
+
+        BodyPool::Release(body, pooled ? GetPoolKey() : std::string());
+        body = nullptr;
+        if (actor != nullptr && actor->rigidbody == this)
+            actor->rigidbody = nullptr;
+    }
+
     // Ready Function: Kind of OnStart() for Rigidbody
     void Ready()
     {
@@ -209,23 +353,26 @@ public:
             auto *detector = new CollisionDetector();  //  detector = contact_listener
             world->SetContactListener(detector);
 
+            // colliders vs triggers and the layer matrix are both resolved in the broad phase
+            auto *filter = new LayerContactFilter();
+            world->SetContactFilter(filter);
+
             world_initialized = true;
         }
 
-        b2BodyDef bodyDef;
-        if (bodyType == "dynamic")
-        {
-            bodyDef.type = b2_dynamicBody;
-        }
-        else if (bodyType == "static")
+        if (pooled)
         {
-            bodyDef.type = b2_staticBody;
-        }
-        else if (bodyType == "kinematic")
-        {
-            bodyDef.type = b2_kinematicBody;
+            body = BodyPool::Acquire(GetPoolKey());
+            if (body != nullptr)
+            {
+                ResetPooledBody();
+                return;
+            }
         }
 
+        b2BodyDef bodyDef;
+        bodyDef.type = GetBox2DBodyType();
+
         bodyDef.position.Set(x, y);
         // set the rotation to the bodyDef
         float rotationRadians = rotation * (b2_pi / 180.0f); // degree to radians
@@ -233,31 +380,36 @@ public:
         bodyDef.bullet = precise;
         bodyDef.angularDamping = angular_friction;
         bodyDef.gravityScale = gravity_scale;
+        bodyDef.userData.pointer = reinterpret_cast<uintptr_t>(this); // owner, used by PhysicsSnapshot
 
         body = world->CreateBody(&bodyDef); // create the body
+        if (actor != nullptr)
+            actor->rigidbody = this; // for update culling
+
+        b2Filter layerFilter = GetLayerFilter();
         // std::cout << "Rigidbody registered in " << Helper::GetFrameNumber() << std::endl;
 
         // Create Collider Fixture
         if (has_collider)
         {
+            // CreateFixture clones the shape, so the shapes can live on the stack
+            b2PolygonShape polygonShape;
+            b2CircleShape circleShape;
             b2Shape *colliderShape = nullptr;
             if (collider_type == "box")
             {
-                auto *polygonShape = new b2PolygonShape();
-                polygonShape->SetAsBox(width * 0.5f, height * 0.5f); // 1.0f x 1.0f box
-                colliderShape = polygonShape;
+                polygonShape.SetAsBox(width * 0.5f, height * 0.5f); // 1.0f x 1.0f box
+                colliderShape = &polygonShape;
             }
             else if (collider_type == "circle")
             {
-                auto *circleShape = new b2CircleShape();
-                circleShape->m_radius = radius;
-                colliderShape = circleShape;
+                circleShape.m_radius = radius;
+                colliderShape = &circleShape;
             }
 
             b2FixtureDef colliderFixtureDef;
             colliderFixtureDef.isSensor = false;
-            colliderFixtureDef.filter.categoryBits = BOX2D_CATEGORY_COLLIDER;
-            colliderFixtureDef.filter.maskBits = ~BOX2D_CATEGORY_SENSOR;
+            colliderFixtureDef.filter = layerFilter;
             colliderFixtureDef.shape = colliderShape;
             colliderFixtureDef.density = density;
             colliderFixtureDef.friction = friction;
@@ -269,24 +421,23 @@ public:
 
         if (has_trigger)
         {
+            b2PolygonShape polygonShape;
+            b2CircleShape circleShape;
             b2Shape *triggerShape = nullptr;
             if (trigger_type == "box")
             {
-                auto *polygonShape = new b2PolygonShape();
-                polygonShape->SetAsBox(trigger_width * 0.5f, trigger_height * 0.5f); // 1.0f x 1.0f box
-                triggerShape = polygonShape;
+                polygonShape.SetAsBox(trigger_width * 0.5f, trigger_height * 0.5f); // 1.0f x 1.0f box
+                triggerShape = &polygonShape;
             }
             else if (trigger_type == "circle")
             {
-                auto *circleShape = new b2CircleShape();
-                circleShape->m_radius = trigger_radius;
-                triggerShape = circleShape;
+                circleShape.m_radius = trigger_radius;
+                triggerShape = &circleShape;
             }
 
             b2FixtureDef triggerFixtureDef;
             triggerFixtureDef.isSensor = true;
-            triggerFixtureDef.filter.categoryBits = BOX2D_CATEGORY_SENSOR;
-            triggerFixtureDef.filter.maskBits = ~BOX2D_CATEGORY_COLLIDER;
+            triggerFixtureDef.filter = layerFilter;
             triggerFixtureDef.shape = triggerShape;
             triggerFixtureDef.density = density;
             triggerFixtureDef.friction = friction;
@@ -309,11 +460,56 @@ public:
 
             // Because it is a sensor (with no callback even), no collisions will ever occur
             phantomFixtureDef.isSensor = true;
+            // and with no layer bits it never even reaches the narrow phase
+            phantomFixtureDef.filter.categoryBits = 0;
+            phantomFixtureDef.filter.maskBits = 0;
             body->CreateFixture(&phantomFixtureDef); // create the fixture
         }
 
     };
 
+private:
+    b2BodyType GetBox2DBodyType() const
+    {
+        if (bodyType == "static")
+            return b2_staticBody;
+        if (bodyType == "kinematic")
+            return b2_kinematicBody;
+        return b2_dynamicBody;
+    }
+
+    // Bring a recycled body back into the same state a freshly created one would have
+    void ResetPooledBody()
+    {
+        body->SetType(GetBox2DBodyType());
+        body->GetUserData().pointer = reinterpret_cast<uintptr_t>(this);
+        if (actor != nullptr)
+            actor->rigidbody = this;
+        body->SetTransform(b2Vec2(x, y), rotation * (b2_pi / 180.0f));
+        body->SetLinearVelocity(b2Vec2(0.0f, 0.0f));
+        body->SetAngularVelocity(0.0f);
+        body->SetBullet(precise);
+        body->SetAngularDamping(angular_friction);
+        body->SetGravityScale(gravity_scale);
+
+        b2Filter layerFilter = GetLayerFilter();
+        for (b2Fixture *fixture = body->GetFixtureList(); fixture; fixture = fixture->GetNext())
+        {
+            fixture->SetDensity(density);
+            if (has_collider || has_trigger)
+            {
+                fixture->SetFriction(friction);
+                fixture->SetRestitution(bounciness);
+                fixture->SetFilterData(layerFilter);
+                fixture->GetUserData().pointer = reinterpret_cast<uintptr_t>(actor);
+            }
+        }
+        body->ResetMassData();
+
+        body->SetEnabled(true);
+        body->SetAwake(true);
+    }
+
 
 };
 
@@ -15,9 +15,11 @@
 #include "Actor.h"
 #include "Renderer.h"
 #include "EngineUtils.h"
+#include "SceneReader.h"
 #include "rapidjson/document.h"
 #include "glm/glm.hpp"
 #include "LuaMananger.h"
+#include "CompiledScene.h"
 
 class Scene
 {
@@ -29,7 +31,6 @@ public:
 
     bool gameEnd = false, gameWin = false, sceneChange = false; // Flags to indicate game win and scene change
 
-    AudioManager sceneAudioManager; // Audio manager for the scene
     ComponentManager componentManager; // Component manager for the scene
 
     Scene() = default; // Default constructor
@@ -47,10 +48,10 @@ public:
     }
 
     static void
-    ApplyComponentOverrides(lua_State *L, const std::string &componentName, const rapidjson::Value &componentValue)
+    ApplyComponentOverrides(lua_State *L, luabridge::LuaRef *component, const rapidjson::Value &componentValue)
     {
 
-        luabridge::LuaRef currentComponent = *ComponentManager::component_tables[componentName];
+        luabridge::LuaRef currentComponent = *component;
 
         for (auto it = componentValue.MemberBegin(); it != componentValue.MemberEnd(); ++it)
         {
@@ -89,8 +90,7 @@ public:
             }
 
             // The top of the stack now has the value we just pushed
-            auto *ref = new luabridge::LuaRef(luabridge::LuaRef::fromStack(L, -1));
-            currentComponent[key] = *ref;
+            currentComponent[key] = luabridge::LuaRef::fromStack(L, -1);
 
             lua_pop(L, 1); // Clean up the stack by removing the pushed value
         }
@@ -100,183 +100,142 @@ public:
     {
         rapidjson::Document document;
         EngineUtils::ReadJsonFile(templatePath, document);
+        updateFromTemplate(actor, document, false);
+    }
 
-        // Temporary map for components
-        std::map<std::string, luabridge::LuaRef *> tempComponents;
+    // Gives the actor the template's update policy and components. deferReady leaves the Rigidbody bodies to
+    // SceneLoader::Switch, so they don't collide with the scene that keeps running while the others load.
+    void updateFromTemplate(Actor *actor, const rapidjson::Value &document, bool deferReady)
+    {
+        actor->updatePolicyFromJson(document);
 
         if (document.HasMember("components") && document["components"].IsObject())
         {
-            const auto &componentsObject = document["components"].GetObject();
-            for (const auto &component: componentsObject)
+            for (const auto &component: document["components"].GetObject())
             {
                 const std::string componentName = component.name.GetString();
                 const std::string componentType = component.value["type"].GetString();
+                actor->components[componentName] = InstantiateSceneComponent(componentName, componentType, actor,
+                                                                             component.value, deferReady);
+            }
+        }
+    }
 
-                std::string componentPath = "resources/component_types/" + componentType + ".lua";
+    // Instances a component named in a .scene or .template file and applies the file's overrides.
+    // Rigidbody is the one C++ component; its Ready creates the body once the overrides are in.
+    luabridge::LuaRef *InstantiateSceneComponent(const std::string &componentName, const std::string &componentType,
+                                                 Actor *actor, const rapidjson::Value &componentValue, bool deferReady)
+    {
+        if (componentType == "Rigidbody")
+        {
+            auto *rbComponent = ComponentManager::CreateRigidbody(componentName, actor);
+            (*rbComponent)["key"] = componentName;
+            ApplyComponentOverrides(LuaManager::lua_state, rbComponent, componentValue);
+
+            if (deferReady)
+                actor->componentsOnReady.push_back(rbComponent);
+            else if ((*rbComponent)["Ready"].isFunction())
+                (*rbComponent)["Ready"](*rbComponent);
+            return rbComponent;
+        }
 
-                // Check if the component Lua file exists
-                if (!std::filesystem::exists(componentPath))
-                {
-                    std::cout << "error: failed to locate component " << componentType;
-                    exit(0);
-                }
+        std::string componentPath = "resources/component_types/" + componentType + ".lua";
+
+        // Check if the component Lua file exists
+        if (!AssetPack::Exists(componentPath))
+        {
+            std::cout << "error: failed to locate component " << componentType;
+            exit(0);
+        }
 
-                // Load and instance the component
-                componentManager.InstantiateComponent(componentName, componentType, actor);
+        // Load and instance the component
+        componentManager.InstantiateComponent(componentName, componentType, actor);
+        luabridge::LuaRef *component = ComponentManager::component_tables[componentName];
+        ApplyComponentOverrides(LuaManager::lua_state, component, componentValue);
+        return component;
+    }
 
-                tempComponents.insert(
-                        {componentName, ComponentManager::component_tables[componentName]});
+    // Creates one actor of a .scene file. templates holds already parsed templates by name (nullptr: read
+    // them from disk). The scene's components either add one (with a "type") or override the template's.
+    Actor *LoadActor(const rapidjson::Value &actorValue, const CompiledScene::Templates *templates, bool deferReady)
+    {
+        auto *actor = new Actor();
 
-                // Apply overrides
-                ApplyComponentOverrides(LuaManager::lua_state, componentName, component.value);
-            }
+        actor->updateFromJson(actorValue); // only update the actor's name for now
 
-            actor->components = std::move(tempComponents);
+        if (actorValue.HasMember("template") && actorValue["template"].IsString())
+        {
+            const std::string templateName = actorValue["template"].GetString();
+            const rapidjson::Document *cached = nullptr;
+            if (templates != nullptr && templates->count(templateName) > 0)
+                cached = &templates->at(templateName);
+
+            if (cached != nullptr)
+            {
+                updateFromTemplate(actor, *cached, deferReady);
+            }
+            else
+            {
+                rapidjson::Document document;
+                EngineUtils::ReadJsonFile("resources/actor_templates/" + templateName + ".template", document);
+                updateFromTemplate(actor, document, deferReady);
+            }
+            actor->updatePolicyFromJson(actorValue); // the scene overrides the template
         }
 
+        if (actorValue.HasMember("components") && actorValue["components"].IsObject())
+        {
+            for (const auto &component: actorValue["components"].GetObject())
+            {
+                const std::string componentName = component.name.GetString();
+                if (component.value.HasMember("type") && component.value["type"].IsString())
+                {
+                    const std::string componentType = component.value["type"].GetString();
+                    actor->components[componentName] = InstantiateSceneComponent(componentName, componentType, actor,
+                                                                                 component.value, deferReady);
+                }
+                else if (actor->components.count(componentName) > 0)
+                {
+                    ApplyComponentOverrides(LuaManager::lua_state, actor->components[componentName], component.value);
+                }
+            }
+        }
 
+        return actor;
     }
 
-    // Load scene data (all actors' data) from a .scene file
+    // Load scene data (all actors' data) from a .scene file, or from its .scenec when that is up to date
     void LoadFromJson(const std::string &file_path)
     {
         rapidjson::Document document;
-        EngineUtils::ReadJsonFile(file_path, document);
+        CompiledScene::Templates templates;
+        CompiledScene compiled;
+        if (!CompiledScene::IsUpToDate(file_path) ||
+            !compiled.Load(CompiledScene::PathFor(file_path), document, templates))
+        {
+            // Without a compiled scene the actors are created as the file is parsed, never holding its DOM
+            bool parsed = SceneReader::ForEachActor(file_path, [this, &templates](const rapidjson::Value &actorValue)
+            {
+                ReadTemplate(actorValue, templates);
+                Actor *actor = LoadActor(actorValue, &templates, false);
+                addActor(actor);
+                ComponentManager::actorTable.emplace_back(actor);
+            });
+            if (!parsed)
+            {
+                std::cout << "error parsing json at [" << file_path << "]" << std::endl;
+                exit(0);
+            }
+            return;
+        }
 
-        if (document.HasMember("actors") && document["actors"].IsArray())
+        if (document.IsObject() && document.HasMember("actors") && document["actors"].IsArray())
         {
-            const auto &actorsArray = document["actors"].GetArray();
-            for (const auto &actorValue: actorsArray)
+            for (const auto &actorValue: document["actors"].GetArray())
             {
                 if (actorValue.IsObject())
                 {
-                    auto *actor = new Actor();
-
-                    actor->updateFromJson(actorValue); // only update the actor's name for now
-
-                    if (actorValue.HasMember("template") && actorValue["template"].IsString())
-                    {
-
-                        const std::string templateName = actorValue["template"].GetString();
-                        const std::string templatePath = "resources/actor_templates/" + templateName + ".template";
-                        // new function to load actor template
-                        updateFromTemplate(actor, templatePath);
-
-
-                        if (actorValue.HasMember("components") && actorValue["components"].IsObject())
-                        {
-                            // Temporary map for components
-                            std::map<std::string, luabridge::LuaRef *> tempComponents;
-
-                            const auto &componentsObject = actorValue["components"].GetObject();
-
-                            for (const auto &component: componentsObject)
-                            {
-                                // for things like test-case 1-5
-                                if (component.value.HasMember("type") && component.value["type"].IsString())
-                                {
-
-                                    const std::string componentName = component.name.GetString();
-                                    const std::string componentType = component.value["type"].GetString();
-
-                                    std::string componentPath = "resources/component_types/" + componentType + ".lua";
-
-                                    // Check if the component Lua file exists
-                                    if (!std::filesystem::exists(componentPath))
-                                    {
-                                        std::cout << "error: failed to locate component " << componentType;
-                                        exit(0);
-                                    }
-
-                                    // Load and instance the component
-                                    componentManager.InstantiateComponent(componentName, componentType, actor);
-
-                                    tempComponents.insert(
-                                            {componentName, ComponentManager::component_tables[componentName]});
-
-                                    // Apply overrides
-                                    ApplyComponentOverrides(LuaManager::lua_state, componentName, component.value);
-                                }
-                                else // for things like test-case 1-6
-                                {
-                                    const std::string componentName = component.name.GetString();
-                                    tempComponents.insert(
-                                            {componentName, ComponentManager::component_tables[componentName]});
-                                    // Apply overrides
-                                    ApplyComponentOverrides(LuaManager::lua_state, componentName, component.value);
-                                }
-
-                            }
-
-                            actor->components = std::move(tempComponents);
-
-                        }
-
-
-                    }
-
-                    if (actorValue.HasMember("components") && actorValue["components"].IsObject() &&
-                        !actorValue.HasMember("template"))
-                    {
-                        // Temporary map for components
-                        std::map<std::string, luabridge::LuaRef *> tempComponents;
-
-                        const auto &componentsObject = actorValue["components"].GetObject();
-                        for (const auto &component: componentsObject)
-                        {
-                            const std::string componentName = component.name.GetString();
-                            const std::string componentType = component.value["type"].GetString();
-
-                            if (componentType != "Rigidbody")
-                            {
-                                std::string componentPath = "resources/component_types/" + componentType + ".lua";
-
-                                // Check if the component Lua file exists
-                                if (!std::filesystem::exists(componentPath))
-                                {
-                                    std::cout << "error: failed to locate component " << componentType;
-                                    exit(0);
-                                }
-
-                                // Load and instance the component
-                                componentManager.InstantiateComponent(componentName, componentType, actor);
-
-                                tempComponents.insert(
-                                        {componentName, ComponentManager::component_tables[componentName]});
-
-                                // Apply overrides
-                                ApplyComponentOverrides(LuaManager::lua_state, componentName, component.value);
-                            }
-                            else // for Rigidbody, this kind of C++ component
-                            {
-                                auto *rbComponent = ComponentManager::CreateRigidbody(componentName, actor);
-                                // rbComponent->componentType = "Rigidbody";
-                                // rbComponent = table["rigidbody"] = componentRef
-
-                                // and even the template for Rigidbody?
-
-                                // for property in ComponentJson:
-                                //     AddPropertyToComponent(component, property)
-                                ApplyComponentOverrides(LuaManager::lua_state, componentName, component.value);
-                                // need to rewrite the component overrides
-
-                                // add the Ready function to the Rigidbody class
-                                if ((*rbComponent)["Ready"].isFunction())
-                                {
-                                    (*rbComponent)["Ready"](*rbComponent);
-                                    // std::cout << "Ready function called for Rigidbody" << std::endl;
-                                }
-
-                                tempComponents.insert({componentName, rbComponent});
-
-                            }
-
-                        }
-
-                        actor->components = std::move(tempComponents);
-                    }
-
-
+                    Actor *actor = LoadActor(actorValue, &templates, false);
                     addActor(actor);
                     ComponentManager::actorTable.emplace_back(actor); // differ push_back and emplace_back again
                 }
@@ -284,49 +243,54 @@ public:
         }
     }
 
-    // FIXME: Need to fix the LoadScene function
-    void LoadNextScene(const std::string &sceneName)
+    // The actor's template, read the first time an actor of the scene uses it rather than once per actor
+    static void ReadTemplate(const rapidjson::Value &actorValue, CompiledScene::Templates &templates)
     {
-        std::string scenePath = "resources/scenes/" + sceneName + ".scene";
+        if (!actorValue.HasMember("template") || !actorValue["template"].IsString())
+            return;
+        const std::string templateName = actorValue["template"].GetString();
+        if (templates.count(templateName) == 0)
+            EngineUtils::ReadJsonFile("resources/actor_templates/" + templateName + ".template",
+                                      templates[templateName]);
+    }
 
-        // Clear the current scene data Or DontDestroyOnLoad
-        // actors.clear();
-
-        // Handle Don't Destroy On Load in Scene Loading
-        // for (int i = 0; i < Scene::currentScene.actors.size(); i++)
-        // {
-        //     if (Scene::currentScene.actors[i].dontDestroyOnLoad)
-        //     {
-        //         scene.actors.push_back(Scene::currentScene.actors[i]);
-        //         Scene::currentScene.actors[i]->fromAnotherScene = true;
-        //     }
-        // }
-
-        // if (actor->dontDestroyOnLoad) we keep it in the actors as well and label it as fromAnotherScene
-        for (auto &actor: actors)
+    // Actors not marked DontDestroy go the way of Actor.Destroy: their OnDestroy runs at the end of the next
+    // frame, then their bodies are released. The others carry over to the next scene.
+    static void UnloadActors()
+    {
+        // so do the ones Actor.InstantiateDeferred has yet to create
+        for (auto *actor: InstantiationQueue::CancelAll())
+            ComponentManager::DestroyActor(actor);
+
+        for (auto *actor: actors)
         {
             if (actor->dontDestroyOnLoad)
-            {
                 actor->fromAnotherScene = true;
-            }
             else
-            {
-                // erase it from static inline std::vector<Actor *> actors; // List of actors in the scene
-                actors.erase(std::remove(actors.begin(), actors.end(), actor), actors.end());
-
-                // remove it from actorTable as well:
-                // ComponentManager::actorTable.erase(std::remove(ComponentManager::actorTable.begin(), ComponentManager::actorTable.end(), actor), ComponentManager::actorTable.end());
-            }
+                ComponentManager::DestroyActor(actor);
         }
+    }
 
-        // std::cout << "Actors size for now: " << actors.size() << std::endl;
+    // The actors of a newly loaded scene start on the next frame, in the order of the initial scene's
+    static void QueueOnStart(Actor *actor)
+    {
+        for (const auto &component: actor->components)
+            componentsAwaitingOnStart.push_back(component.second);
+    }
+
+    void LoadNextScene(const std::string &sceneName)
+    {
+        std::string scenePath = "resources/scenes/" + sceneName + ".scene";
 
-        // std::cout << "Loading Scene: " << sceneName << std::endl;
+        UnloadActors();
 
         // Load the new scene
+        size_t firstNewActor = actors.size();
         LoadFromJson(scenePath);
+        for (size_t i = firstNewActor; i < actors.size(); i++)
+            QueueOnStart(actors[i]);
 
-        // std::cout << "Actors size after loading: " << actors.size() << std::endl;
+        LuaManager::currentSceneName = sceneName;
     }
 
 };
@@ -0,0 +1,268 @@
+#ifndef MAIN_CPP_SCENELOADER_H
+#define MAIN_CPP_SCENELOADER_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <unordered_map>
+#include <unordered_set>
+#include <filesystem>
+#include "Scene.h"
+#include "Rigidbody.h"
+#include "TextureLoader.h"
+#include "JobSystem.h"
+#include "LuaMananger.h"
+#include "CompiledScene.h"
+#include "EngineUtils.h"
+#include "rapidjson/document.h"
+
+// Scene.LoadAsync(name) loads the next scene while the current one keeps running.
+//
+// A background job reads the .scene file (or its .scenec) and templates and decodes the images the scene names
+// (string properties matching a file in resources/images). Lua and Box2D are not thread-safe, so the actors
+// are then created on the main thread, a few per frame:
+//
+//   "scene_load_budget_ms": 2    in game.config: time per frame spent creating actors (default 2)
+//
+// Once the last one exists the scenes switch at the end of the frame, like Scene.Load, and the new actors'
+// OnStart runs on the next. Scene.GetLoadProgress() goes from 0 to 1 as the actors are created and
+// Scene.IsLoading() is true until the switch. A Scene.Load in the meantime abandons the async load.
+class SceneLoader
+{
+public:
+    static void LoadFromConfig(const rapidjson::Document &gameConfig)
+    {
+        if (gameConfig.HasMember("scene_load_budget_ms") && gameConfig["scene_load_budget_ms"].IsNumber())
+            budgetMs = gameConfig["scene_load_budget_ms"].GetDouble();
+    }
+
+    // Once per frame, where Scene.Load is handled
+    static void Update(Scene &scene)
+    {
+        if (prepared != nullptr && preparing.pending.load(std::memory_order_acquire) > 0)
+            return;
+        if (cancelled)
+            Discard();
+
+        if (LuaManager::asyncSceneRequested)
+        {
+            LuaManager::asyncSceneRequested = false;
+            Start(LuaManager::asyncSceneName);
+        }
+
+        // without worker threads the preparation already ran inside Start
+        if (prepared == nullptr || preparing.pending.load(std::memory_order_acquire) > 0)
+            return;
+
+        if (!prepared->error.empty())
+        {
+            std::cout << prepared->error;
+            exit(0);
+        }
+
+        for (auto &image: prepared->images)
+            TextureLoader::Adopt(image.first, image.second);
+        prepared->images.clear();
+
+        const auto &actorsArray = prepared->scene["actors"].GetArray();
+        auto start = std::chrono::steady_clock::now();
+        while (nextActor < actorsArray.Size())
+        {
+            const auto &actorValue = actorsArray[nextActor++];
+            if (actorValue.IsObject())
+                pendingActors.push_back(scene.LoadActor(actorValue, &prepared->templates, true));
+
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            if (std::chrono::duration<double, std::milli>(elapsed).count() >= budgetMs)
+                break;
+        }
+        if (nextActor < actorsArray.Size())
+            LuaManager::sceneLoadProgress = static_cast<float>(nextActor) / static_cast<float>(actorsArray.Size());
+        else
+            Switch();
+    }
+
+    // Scene.Load was called; the actors created so far never joined the scene
+    static void Cancel()
+    {
+        LuaManager::asyncSceneRequested = false;
+        LuaManager::sceneLoading = false;
+        LuaManager::sceneLoadProgress = 1.0f;
+        if (prepared == nullptr)
+            return;
+
+        cancelled = true;
+        if (preparing.pending.load(std::memory_order_acquire) == 0)
+            Discard();
+    }
+
+private:
+    struct PreparedScene
+    {
+        std::string name;
+        std::string error; // the whole message, printed on the main thread
+        CompiledScene compiled; // the documents point into it when the scene was compiled
+        rapidjson::Document scene;
+        CompiledScene::Templates templates;
+        std::vector<std::pair<std::string, SDL_Surface *>> images;
+    };
+
+    static inline double budgetMs = 2.0;
+    static inline std::unique_ptr<PreparedScene> prepared;
+    static inline JobCounter preparing;
+    static inline bool cancelled = false;
+    static inline size_t nextActor = 0;
+    static inline std::vector<Actor *> pendingActors;
+
+    static void Start(const std::string &sceneName)
+    {
+        prepared = std::make_unique<PreparedScene>();
+        prepared->name = sceneName;
+        cancelled = false;
+        nextActor = 0;
+
+        PreparedScene *target = prepared.get();
+        JobSystem::RunInBackground([target]() { Prepare(*target); }, preparing);
+    }
+
+    // On the loader thread: nothing here may touch Lua, the renderer or the actors
+    static void Prepare(PreparedScene &target)
+    {
+        std::string scenePath = "resources/scenes/" + target.name + ".scene";
+        if (!AssetPack::Exists(scenePath))
+        {
+            target.error = "error: scene " + target.name + " is missing";
+            return;
+        }
+        std::string compiledPath = CompiledScene::PathFor(scenePath);
+        bool compiled = CompiledScene::IsUpToDate(scenePath) &&
+                        target.compiled.Load(compiledPath, target.scene, target.templates);
+        if (!compiled && !ReadJson(scenePath, target.scene, target.error))
+            return;
+        if (!target.scene.IsObject() || !target.scene.HasMember("actors") || !target.scene["actors"].IsArray())
+        {
+            target.scene.SetObject();
+            target.scene.AddMember("actors", rapidjson::Value(rapidjson::kArrayType), target.scene.GetAllocator());
+        }
+
+        std::unordered_set<std::string> images;
+        for (const auto &actorValue: target.scene["actors"].GetArray())
+        {
+            if (!actorValue.IsObject())
+                continue;
+            CollectImages(actorValue, images);
+
+            if (compiled || !actorValue.HasMember("template") || !actorValue["template"].IsString())
+                continue;
+            std::string templateName = actorValue["template"].GetString();
+            if (target.templates.count(templateName) > 0)
+                continue;
+            if (!ReadJson("resources/actor_templates/" + templateName + ".template", target.templates[templateName],
+                          target.error))
+                return;
+        }
+        for (const auto &entry: target.templates)
+            CollectImages(entry.second, images);
+
+        for (const std::string &image: images)
+        {
+            SDL_Surface *surface = IMG_Load_RW(AssetPack::OpenRW("resources/images/" + image + ".png"), 1);
+            if (surface != nullptr)
+                target.images.emplace_back(image, surface);
+        }
+    }
+
+    static bool ReadJson(const std::string &path, rapidjson::Document &document, std::string &error)
+    {
+        if (!EngineUtils::ParseJsonFile(path, document))
+        {
+            error = "error parsing json at [" + path + "]";
+            return false;
+        }
+        return true;
+    }
+
+    // String properties of the components that name an image, e.g. a SpriteRenderer's "sprite"
+    static void CollectImages(const rapidjson::Value &actorValue, std::unordered_set<std::string> &images)
+    {
+        if (!actorValue.IsObject() || !actorValue.HasMember("components") || !actorValue["components"].IsObject())
+            return;
+
+        for (const auto &component: actorValue["components"].GetObject())
+        {
+            if (!component.value.IsObject())
+                continue;
+            for (const auto &property: component.value.GetObject())
+            {
+                if (!property.value.IsString() || std::string(property.name.GetString()) == "type")
+                    continue;
+                std::string image = property.value.GetString();
+                if (images.count(image) == 0 && AssetPack::Exists("resources/images/" + image + ".png"))
+                    images.insert(image);
+            }
+        }
+    }
+
+    static void Switch()
+    {
+        Scene::UnloadActors();
+        for (auto *actor: pendingActors)
+        {
+            Scene::addActor(actor);
+            ComponentManager::actorTable.emplace_back(actor);
+
+            // the bodies now, like Scene.Load: the next frame's OnStart pass comes before its Ready pass
+            for (auto *component: actor->componentsOnReady)
+            {
+                if ((*component)["Ready"].isFunction())
+                    (*component)["Ready"](*component);
+            }
+            actor->componentsOnReady.clear();
+            Scene::QueueOnStart(actor);
+        }
+
+        LuaManager::currentSceneName = prepared->name;
+        LuaManager::sceneLoading = false;
+        LuaManager::sceneLoadProgress = 1.0f;
+        pendingActors.clear();
+        prepared.reset();
+    }
+
+    static void Discard()
+    {
+        for (auto *actor: pendingActors)
+            Free(actor);
+        pendingActors.clear();
+        for (auto &image: prepared->images)
+            SDL_FreeSurface(image.second);
+        prepared.reset();
+        cancelled = false;
+    }
+
+    // An actor that never joined the scene: no script has seen its components, so they go with it
+    static void Free(Actor *actor)
+    {
+        std::vector<Rigidbody *> rigidbodies;
+        std::vector<luabridge::LuaRef *> components;
+        for (auto &component: actor->components)
+        {
+            auto table = ComponentManager::component_tables.find(component.first);
+            if (table != ComponentManager::component_tables.end() && table->second == component.second)
+                ComponentManager::component_tables.erase(table);
+            if ((*component.second)["type"].tostring() == "Rigidbody")
+                rigidbodies.push_back(component.second->cast<Rigidbody *>());
+            components.push_back(component.second);
+        }
+
+        actor->OnDestroy(); // bodies released, stats forgotten
+        for (auto *rigidbody: rigidbodies)
+            delete rigidbody;
+        for (auto *component: components)
+            delete component;
+        delete actor;
+    }
+};
+
+
+#endif //MAIN_CPP_SCENELOADER_H
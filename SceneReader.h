@@ -0,0 +1,164 @@
+#ifndef MAIN_CPP_SCENEREADER_H
+#define MAIN_CPP_SCENEREADER_H
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include "rapidjson/reader.h"
+#include "rapidjson/document.h"
+#include "EngineUtils.h"
+
+// Streams the actors of a .scene file: the file is read once and parsed in situ by rapidjson's SAX reader,
+// and only the actor being handed to the callback exists as a DOM, built in a pool that is cleared for the
+// next one. Peak memory is the file plus one actor instead of the file plus the scene's whole DOM.
+//
+//   SceneReader::ForEachActor(path, [](const rapidjson::Value &actor) { ... });
+//
+// The values passed to the callback, and their strings, are only valid during the call.
+class SceneReader
+{
+public:
+    // false if the file can't be read or parsed; the actors before a parse error have been handed out
+    template<typename Callback>
+    static bool ForEachActor(const std::string &path, Callback &&callback)
+    {
+        std::vector<char> file;
+        char *buffer = EngineUtils::ReadWholeFile(path, [&file](size_t bytes)
+        {
+            file.resize(bytes);
+            return file.data();
+        });
+        if (buffer == nullptr)
+            return false;
+
+        char chunk[16 * 1024]; // the pool's first chunk, reused by every actor
+        rapidjson::MemoryPoolAllocator<> allocator(chunk, sizeof(chunk));
+        Handler<Callback> handler(allocator, callback);
+        rapidjson::InsituStringStream stream(buffer);
+        rapidjson::Reader reader;
+        return !reader.Parse<rapidjson::kParseInsituFlag>(stream, handler).IsError();
+    }
+
+private:
+    // Outside an actor only tracks where it is; inside one builds its value
+    template<typename Callback>
+    class Handler
+    {
+    public:
+        Handler(rapidjson::MemoryPoolAllocator<> &allocator, Callback &callback) :
+                allocator(allocator), callback(callback) {}
+
+        bool Null() { return Add(rapidjson::Value()); }
+        bool Bool(bool b) { return Add(rapidjson::Value(b)); }
+        bool Int(int i) { return Add(rapidjson::Value(i)); }
+        bool Uint(unsigned u) { return Add(rapidjson::Value(u)); }
+        bool Int64(int64_t i) { return Add(rapidjson::Value(i)); }
+        bool Uint64(uint64_t u) { return Add(rapidjson::Value(u)); }
+        bool Double(double d) { return Add(rapidjson::Value(d)); }
+        bool RawNumber(const char *, rapidjson::SizeType, bool) { return false; } // needs kParseNumbersAsStringsFlag
+
+        // in situ, so the strings stay in the file buffer
+        bool String(const char *str, rapidjson::SizeType length, bool)
+        {
+            return Add(rapidjson::Value(rapidjson::StringRef(str, length)));
+        }
+
+        bool Key(const char *str, rapidjson::SizeType length, bool)
+        {
+            if (!open.empty())
+                keys.emplace_back(rapidjson::StringRef(str, length));
+            else if (depth == 1)
+                actorsKey = length == 6 && std::memcmp(str, "actors", 6) == 0;
+            return true;
+        }
+
+        bool StartObject()
+        {
+            if (!open.empty() || (inActors && depth == 2))
+                open.emplace_back(rapidjson::kObjectType);
+            else
+                depth++;
+            return true;
+        }
+
+        bool EndObject(rapidjson::SizeType)
+        {
+            if (open.empty())
+            {
+                depth--;
+                return true;
+            }
+            return Close();
+        }
+
+        bool StartArray()
+        {
+            if (!open.empty())
+            {
+                open.emplace_back(rapidjson::kArrayType);
+                return true;
+            }
+            if (depth == 1) // a stray array inside "actors" leaves the actors that follow it alone
+                inActors = actorsKey;
+            depth++;
+            return true;
+        }
+
+        bool EndArray(rapidjson::SizeType)
+        {
+            if (open.empty())
+            {
+                if (inActors && depth == 2)
+                    inActors = false;
+                depth--;
+                return true;
+            }
+            return Close();
+        }
+
+    private:
+        rapidjson::MemoryPoolAllocator<> &allocator;
+        Callback &callback;
+        int depth = 0; // containers outside the actor being built
+        bool actorsKey = false; // the last key of the scene object was "actors"
+        bool inActors = false;
+        std::vector<rapidjson::Value> open; // containers of the actor being built, outermost first
+        std::vector<rapidjson::Value> keys; // names of the members being built
+
+        bool Close()
+        {
+            rapidjson::Value value(std::move(open.back()));
+            open.pop_back();
+            return Add(std::move(value));
+        }
+
+        bool Add(rapidjson::Value &&value)
+        {
+            if (open.empty())
+            {
+                // a whole actor; anything else outside an actor, like a number in the actors array, is skipped
+                if (value.IsObject())
+                {
+                    callback(static_cast<const rapidjson::Value &>(value));
+                    allocator.Clear();
+                }
+                return true;
+            }
+
+            rapidjson::Value &parent = open.back();
+            if (parent.IsObject())
+            {
+                parent.AddMember(keys.back(), value, allocator);
+                keys.pop_back();
+            }
+            else
+            {
+                parent.PushBack(value, allocator);
+            }
+            return true;
+        }
+    };
+};
+
+
+#endif //MAIN_CPP_SCENEREADER_H
@@ -0,0 +1,250 @@
+#ifndef MAIN_CPP_SOFTWAREMIXER_H
+#define MAIN_CPP_SOFTWAREMIXER_H
+
+#include <string>
+#include <iostream>
+#include <vector>
+#include <cstdint>
+#include <chrono>
+#include <algorithm>
+#include <mutex>
+#include "SDL2/SDL.h"
+#include "SDL2_mixer/SDL_mixer.h"
+#include "rapidjson/document.h"
+#include "Lua/lua.hpp"
+#include "LuaBridge/LuaBridge.h"
+#include "AudioHelper.h"
+#include "AudioManager.h"
+#include "AudioMix.h"
+
+// The engine's own mixer for the voices of Audio.PlaySfx / Audio.PlayAt, instead of one SDL_mixer channel
+// each: SDL_mixer mixes its channels (Audio.Play, emitters) as before, then hands the device buffer to
+// PostMix, which adds every playing voice to it with AudioMix's SIMD loops and runs the sum through one bus.
+//
+//   "audio_mixer": "engine"    in game.config (default "sdl_mixer")
+//
+// The main thread and the audio thread each have their own copy of the voices. Play and SetGains change the
+// main thread's; Update, once per frame, swaps starts, gains and finished voices with the audio thread's under
+// mixingMutex, which PostMix holds for its whole run (SDL_LockAudio only locks device 1, and SDL_mixer's device
+// may have another id). Clips stay referenced in AudioManager until their voice is seen to be done, or until
+// the swap that hands the audio thread what replaced them: no callback reads a chunk after that.
+//
+// Only the device format Mix_OpenAudio498 asks for (16-bit stereo) is mixed; with another one the engine
+// falls back to SDL_mixer channels. Streamed clips (AudioStream.h) are decoded whole when played here.
+//
+// Lua: Audio.SetBusVolume(0..1), Audio.SetBusLowPass(cutoff Hz, 0 = off)
+//      Audio.GetMixerStats() -> {mixer=, path=, voices_mixed=, callback_ms=, voices_per_ms=}
+class SoftwareMixer
+{
+public:
+    static void LoadFromConfig(const rapidjson::Document &gameConfig)
+    {
+        if (!gameConfig.HasMember("audio_mixer") || !gameConfig["audio_mixer"].IsString())
+            return;
+        std::string mixer = gameConfig["audio_mixer"].GetString();
+        if (mixer != "engine")
+            return;
+
+        int frequency = 0, channels = 0;
+        Uint16 format = 0;
+        if (Mix_QuerySpec(&frequency, &format, &channels) != 0)
+        {
+            if (format != AUDIO_S16SYS || channels != 2)
+            {
+                std::cout << "error: audio_mixer engine needs a 16-bit stereo device, using sdl_mixer" << std::endl;
+                return;
+            }
+            sampleRate = frequency;
+        }
+        enabled = true; // PostMix is registered by SetVoiceCount, once there are voices
+    }
+
+    static bool IsEnabled()
+    {
+        return enabled;
+    }
+
+    // VoiceManager's voice count; main thread, before anything plays
+    static void SetVoiceCount(int count)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mixingMutex);
+            voices.assign(count, Voice());
+            mixing.assign(count, Voice());
+        }
+        AudioHelper::Mix_SetPostMix498(PostMix, nullptr);
+    }
+
+    // Starts clip on voice, replacing what played there; false if the clip can't be read
+    static bool Play(int voice, const std::string &clip)
+    {
+        std::string path = AudioManager::clips.count(clip) > 0 ? std::string() : AudioManager::FindClip(clip);
+        Mix_Chunk *chunk = AudioManager::AcquireClip(clip, path);
+        if (chunk == nullptr)
+            return false;
+
+        Voice &target = voices[voice];
+        if (!target.clip.empty())
+            released.push_back(target.clip); // after Update, when the audio thread has let go of it
+        target.clip = clip;
+        target.samples = reinterpret_cast<const int16_t *>(chunk->abuf);
+        target.frames = chunk->alen / 4;
+        target.position = 0;
+        target.left = 1.0f;
+        target.right = 1.0f;
+        target.start = ++starts;
+        return true;
+    }
+
+    static void SetGains(int voice, float left, float right)
+    {
+        voices[voice].left = left;
+        voices[voice].right = right;
+    }
+
+    static bool IsPlaying(int voice)
+    {
+        const Voice &v = voices[voice];
+        return !v.clip.empty() && v.position < v.frames;
+    }
+
+    // Lua: Audio.SetBusVolume(volume)
+    static void SetBusVolume(float volume)
+    {
+        busVolume = std::max(0.0f, volume);
+    }
+
+    // Lua: Audio.SetBusLowPass(cutoffHz)
+    static void SetBusLowPass(float cutoffHz)
+    {
+        busCutoffHz = cutoffHz;
+    }
+
+    // Once per frame, after the voices changed: hands them to the audio thread and takes back how far each got
+    static void Update()
+    {
+        if (!enabled)
+            return;
+
+        {
+            std::lock_guard<std::mutex> lock(mixingMutex);
+            for (size_t i = 0; i < voices.size(); i++)
+            {
+                Voice &main = voices[i];
+                Voice &audio = mixing[i];
+                if (audio.start != main.start)
+                {
+                    // a new sound; the clip name stays on this side
+                    audio.samples = main.samples;
+                    audio.frames = main.frames;
+                    audio.position = main.position;
+                    audio.start = main.start;
+                }
+                else
+                    main.position = audio.position;
+                audio.left = main.left;
+                audio.right = main.right;
+            }
+            mixingBusVolume = busVolume;
+            mixingBusCoefficient = AudioMix::LowPassCoefficient(busCutoffHz, sampleRate);
+            stats = mixingStats;
+        }
+
+        for (Voice &voice: voices)
+        {
+            if (!voice.clip.empty() && voice.position >= voice.frames)
+            {
+                released.push_back(voice.clip);
+                voice.clip.clear();
+            }
+        }
+        // the audio thread has every new start now, so nothing it mixes points into these
+        for (const std::string &clip: released)
+            AudioManager::ReleaseClip(clip);
+        released.clear();
+    }
+
+    // Lua: Audio.GetMixerStats()
+    static luabridge::LuaRef GetStats(lua_State *L)
+    {
+        luabridge::LuaRef result = luabridge::newTable(L);
+        result["mixer"] = enabled ? "engine" : "sdl_mixer";
+        result["path"] = AudioMix::GetPath();
+        result["voices_mixed"] = stats.voices;
+        result["callback_ms"] = stats.milliseconds;
+        result["voices_per_ms"] = stats.milliseconds > 0.0 ? stats.voices / stats.milliseconds : 0.0;
+        return result;
+    }
+
+private:
+    struct Voice
+    {
+        std::string clip; // empty: free; only kept on the main thread
+        const int16_t *samples = nullptr; // the clip's chunk, in the device format
+        size_t frames = 0;
+        size_t position = 0; // frames played
+        float left = 1.0f;
+        float right = 1.0f;
+        uint64_t start = 0; // tells a new sound on the voice from the last one
+    };
+
+    struct Stats
+    {
+        int voices; // mixed in the last callback
+        double milliseconds; // spent in the last callback
+    };
+
+    static constexpr size_t BLOCK_FRAMES = 1024;
+
+    static inline bool enabled = false;
+    static inline int sampleRate = 44100;
+    static inline std::vector<Voice> voices; // main thread
+    static inline std::vector<std::string> released; // clips to let go of after the next swap
+    static inline uint64_t starts = 0;
+    static inline float busVolume = 1.0f;
+    static inline float busCutoffHz = 0.0f;
+    static inline Stats stats = {0, 0.0};
+
+    // audio thread, or under mixingMutex
+    static inline std::mutex mixingMutex;
+    static inline std::vector<Voice> mixing;
+    static inline float mixingBusVolume = 1.0f;
+    static inline float mixingBusCoefficient = 1.0f;
+    static inline float lowPassState[2] = {0.0f, 0.0f};
+    static inline float block[BLOCK_FRAMES * 2];
+    static inline Stats mixingStats = {0, 0.0};
+
+    // Audio thread: SDL_mixer's channels are already in stream
+    static void PostMix(void *, Uint8 *stream, int length)
+    {
+        std::lock_guard<std::mutex> lock(mixingMutex);
+        auto begin = std::chrono::steady_clock::now();
+        auto *out = reinterpret_cast<int16_t *>(stream);
+        size_t frames = static_cast<size_t>(length) / 4;
+        int mixed = 0;
+        for (size_t done = 0; done < frames; done += BLOCK_FRAMES)
+        {
+            size_t count = std::min(BLOCK_FRAMES, frames - done);
+            std::fill(block, block + count * 2, 0.0f);
+            for (Voice &voice: mixing)
+            {
+                if (voice.position >= voice.frames)
+                    continue;
+                size_t take = std::min(count, voice.frames - voice.position);
+                AudioMix::AddVoice(block, voice.samples + voice.position * 2, take, voice.left, voice.right);
+                voice.position += take;
+                if (done == 0)
+                    mixed++;
+            }
+            if (mixingBusCoefficient < 1.0f)
+                AudioMix::LowPass(block, count, mixingBusCoefficient, lowPassState);
+            AudioMix::AddToStream(out + done * 2, block, count * 2, mixingBusVolume);
+        }
+        mixingStats.voices = mixed;
+        mixingStats.milliseconds =
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    }
+};
+
+
+#endif //MAIN_CPP_SOFTWAREMIXER_H
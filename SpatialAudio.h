@@ -0,0 +1,372 @@
+#ifndef MAIN_CPP_SPATIALAUDIO_H
+#define MAIN_CPP_SPATIALAUDIO_H
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include "SDL2/SDL.h"
+#include "rapidjson/document.h"
+#include "Lua/lua.hpp"
+#include "LuaBridge/LuaBridge.h"
+#include "AudioHelper.h"
+#include "AudioManager.h"
+#include "VoiceManager.h"
+#include "Actor.h"
+#include "Rigidbody.h"
+
+// Sounds placed in the world (meters, like Rigidbody positions), heard from the camera: quieter with
+// distance and panned towards their side of the screen.
+//
+//   "audio_hearing_distance": 10    in game.config: meters at zoom 1 past which a sound is silent (default 10);
+//                                   zooming out hears further, zooming in less far
+//   "audio_max_emitters": 8         emitters heard at once (default 8), on channels after Audio.PlaySfx's
+//
+// Audio.PlayAt(clip, x, y [, priority]) plays a one-shot on a voice of Audio.PlaySfx; it is not started if it
+// would be silent. Audio.AttachEmitter(actor, clip [, priority]) loops a clip at the actor's Rigidbody, or at
+// the position Audio.SetEmitterPosition gives actors without one. Of the emitters in hearing distance the
+// "audio_max_emitters" with the highest priority, then the loudest, play; the others are halted until they
+// make the cut again, and restart from the beginning.
+//
+// Once per frame Update works out the volume and panning of every playing positional sound in one pass.
+//
+// Lua: Audio.PlayAt(clip, x, y [, priority = 0]) -> channel or -1
+//      Audio.AttachEmitter(actor, clip [, priority = 0]) -> id, Audio.SetEmitterPosition(id, x, y),
+//      Audio.DetachEmitter(id)
+//      Audio.GetSpatialStats() -> {positional=, emitters=, audible=, culled=}
+class SpatialAudio
+{
+public:
+    static void LoadFromConfig(const rapidjson::Document &gameConfig)
+    {
+        if (gameConfig.HasMember("audio_hearing_distance") && gameConfig["audio_hearing_distance"].IsNumber())
+            hearingDistance = std::max(0.01f, gameConfig["audio_hearing_distance"].GetFloat());
+        if (gameConfig.HasMember("audio_max_emitters") && gameConfig["audio_max_emitters"].IsInt())
+            maxEmitters = std::max(0, gameConfig["audio_max_emitters"].GetInt());
+
+        // after VoiceManager's, whose LoadFromConfig runs first
+        firstChannel = VoiceManager::FIRST_VOICE + VoiceManager::GetVoiceCount();
+        slots.assign(maxEmitters, Slot());
+        AudioHelper::Mix_AllocateChannels498(firstChannel + maxEmitters);
+    }
+
+    // Lua: Audio.PlayAt(clip, x, y, priority)
+    static int PlayAt(const std::string &clip, float x, float y, luabridge::LuaRef priorityArgument)
+    {
+        float gain = 0.0f, pan = 0.0f;
+        Hear(x, y, gain, pan);
+        if (gain <= 0.0f)
+        {
+            culled++;
+            return -1;
+        }
+
+        int channel = VoiceManager::Play(clip, priorityArgument.isNumber() ? priorityArgument.cast<int>() : 0);
+        if (channel < 0)
+            return -1;
+
+        uint64_t startOrder = VoiceManager::GetStartOrder(channel);
+        for (Positional &sound: positional)
+        {
+            // the same clip again this frame: one sound, heard from the nearer place
+            if (sound.channel == channel && sound.startOrder == startOrder)
+            {
+                float soundGain = 0.0f, soundPan = 0.0f;
+                Hear(sound.x, sound.y, soundGain, soundPan);
+                if (gain > soundGain)
+                {
+                    sound = Positional{channel, startOrder, x, y};
+                    VoiceManager::SetPanning(channel, ToVolume(gain * Left(pan)), ToVolume(gain * Right(pan)));
+                }
+                return channel;
+            }
+        }
+        positional.push_back(Positional{channel, startOrder, x, y});
+        VoiceManager::SetPanning(channel, ToVolume(gain * Left(pan)), ToVolume(gain * Right(pan)));
+        return channel;
+    }
+
+    // Lua: Audio.AttachEmitter(actor, clip, priority)
+    static int AttachEmitter(Actor *actor, const std::string &clip, luabridge::LuaRef priorityArgument)
+    {
+        if (actor == nullptr)
+            return -1;
+        Emitter emitter;
+        emitter.id = nextEmitterId++;
+        emitter.actor = actor;
+        emitter.clip = clip;
+        emitter.priority = priorityArgument.isNumber() ? priorityArgument.cast<int>() : 0;
+        emitters.push_back(emitter);
+        return emitter.id;
+    }
+
+    // Lua: Audio.SetEmitterPosition(id, x, y), for actors without a Rigidbody
+    static void SetEmitterPosition(int id, float x, float y)
+    {
+        Emitter *emitter = FindEmitter(id);
+        if (emitter == nullptr)
+            return;
+        emitter->x = x;
+        emitter->y = y;
+    }
+
+    // Lua: Audio.DetachEmitter(id)
+    static void DetachEmitter(int id)
+    {
+        auto it = std::find_if(emitters.begin(), emitters.end(), [id](const Emitter &emitter)
+        {
+            return emitter.id == id;
+        });
+        if (it == emitters.end())
+            return;
+        Silence(*it);
+        emitters.erase(it);
+    }
+
+    // Called by ComponentManager::DestroyActor
+    static void DetachActor(const Actor *actor)
+    {
+        for (Emitter &emitter: emitters)
+        {
+            if (emitter.actor == actor)
+                Silence(emitter);
+        }
+        emitters.erase(std::remove_if(emitters.begin(), emitters.end(), [actor](const Emitter &emitter)
+        {
+            return emitter.actor == actor;
+        }), emitters.end());
+    }
+
+    // Once per frame, with the current camera: volume and panning of the positional sounds, and which
+    // emitters play
+    static void Update(float camX, float camY, float zoom)
+    {
+        cameraX = camX;
+        cameraY = camY;
+        hearingRadius = hearingDistance / std::max(zoom, 0.01f);
+
+        positional.erase(std::remove_if(positional.begin(), positional.end(), [](const Positional &sound)
+        {
+            return VoiceManager::GetStartOrder(sound.channel) != sound.startOrder;
+        }), positional.end());
+
+        // positions of the one-shots, then the emitters
+        size_t count = positional.size() + emitters.size();
+        xs.resize(count);
+        ys.resize(count);
+        gains.resize(count);
+        pans.resize(count);
+        for (size_t i = 0; i < positional.size(); i++)
+        {
+            xs[i] = positional[i].x;
+            ys[i] = positional[i].y;
+        }
+        for (size_t i = 0; i < emitters.size(); i++)
+        {
+            Emitter &emitter = emitters[i];
+            if (emitter.actor->rigidbody != nullptr)
+            {
+                b2Vec2 position = emitter.actor->rigidbody->GetBodyPosition();
+                emitter.x = position.x;
+                emitter.y = position.y;
+            }
+            xs[positional.size() + i] = emitter.x;
+            ys[positional.size() + i] = emitter.y;
+        }
+
+        HearAll(count);
+
+        for (size_t i = 0; i < positional.size(); i++)
+            VoiceManager::SetPanning(positional[i].channel, ToVolume(gains[i] * Left(pans[i])),
+                                     ToVolume(gains[i] * Right(pans[i])));
+
+        ChooseEmitters(positional.size());
+    }
+
+    // Lua: Audio.GetSpatialStats()
+    static luabridge::LuaRef GetStats(lua_State *L)
+    {
+        luabridge::LuaRef stats = luabridge::newTable(L);
+        stats["positional"] = static_cast<int>(positional.size());
+        stats["emitters"] = static_cast<int>(emitters.size());
+        stats["audible"] = audible;
+        stats["culled"] = culled;
+        return stats;
+    }
+
+private:
+    struct Positional
+    {
+        int channel;
+        uint64_t startOrder; // VoiceManager's, to notice the voice moving on
+        float x;
+        float y;
+    };
+
+    struct Emitter
+    {
+        int id = 0;
+        Actor *actor = nullptr;
+        std::string clip;
+        int priority = 0;
+        float x = 0.0f;
+        float y = 0.0f;
+        int slot = -1; // index into slots while playing
+        bool chosen = false; // by the last ChooseEmitters
+    };
+
+    struct Slot
+    {
+        int emitter = 0; // id, 0 when free
+        Uint8 left = 255;
+        Uint8 right = 255;
+    };
+
+    static inline float hearingDistance = 10.0f;
+    static inline int maxEmitters = 8;
+    static inline int firstChannel = VoiceManager::FIRST_VOICE + 16;
+
+    static inline float cameraX = 0.0f;
+    static inline float cameraY = 0.0f;
+    static inline float hearingRadius = 10.0f;
+
+    static inline std::vector<Positional> positional;
+    static inline std::vector<Emitter> emitters;
+    static inline std::vector<Slot> slots = std::vector<Slot>(8);
+    static inline int nextEmitterId = 1;
+
+    // one entry per positional sound, filled by Update
+    static inline std::vector<float> xs, ys, gains, pans;
+    static inline std::vector<size_t> order;
+
+    static inline int audible = 0; // emitters playing after the last Update
+    static inline int culled = 0; // PlayAt calls out of hearing, emitters halted
+
+    // gain 0 (silent) to 1 at the camera, pan -1 (left) to 1 (right)
+    static void Hear(float x, float y, float &gain, float &pan)
+    {
+        float dx = x - cameraX;
+        float dy = y - cameraY;
+        gain = std::max(0.0f, 1.0f - std::sqrt(dx * dx + dy * dy) / hearingRadius);
+        pan = std::min(1.0f, std::max(-1.0f, 2.0f * dx / hearingRadius));
+    }
+
+    // Hear for xs / ys [0, count), into gains / pans; a plain loop over arrays the compiler can vectorize
+    static void HearAll(size_t count)
+    {
+        const float inverseRadius = 1.0f / hearingRadius;
+        for (size_t i = 0; i < count; i++)
+        {
+            float dx = xs[i] - cameraX;
+            float dy = ys[i] - cameraY;
+            gains[i] = std::max(0.0f, 1.0f - std::sqrt(dx * dx + dy * dy) * inverseRadius);
+            pans[i] = std::min(1.0f, std::max(-1.0f, 2.0f * dx * inverseRadius));
+        }
+    }
+
+    static float Left(float pan)
+    {
+        return std::min(1.0f, 1.0f - pan);
+    }
+
+    static float Right(float pan)
+    {
+        return std::min(1.0f, 1.0f + pan);
+    }
+
+    static Uint8 ToVolume(float gain)
+    {
+        return static_cast<Uint8>(std::lround(std::clamp(gain, 0.0f, 1.0f) * 255.0f));
+    }
+
+    // The emitters in hearing distance by priority, then loudness, get the slots; first is their offset in
+    // gains / pans
+    static void ChooseEmitters(size_t first)
+    {
+        order.resize(emitters.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [first](size_t a, size_t b)
+        {
+            if (emitters[a].priority != emitters[b].priority)
+                return emitters[a].priority > emitters[b].priority;
+            return gains[first + a] > gains[first + b];
+        });
+
+        // silence the ones that missed the cut before starting the others in their slots
+        size_t chosen = 0;
+        for (size_t index: order)
+        {
+            Emitter &emitter = emitters[index];
+            emitter.chosen = gains[first + index] > 0.0f && chosen < slots.size();
+            if (emitter.chosen)
+                chosen++;
+            else if (emitter.slot >= 0)
+            {
+                Silence(emitter);
+                culled++;
+            }
+        }
+
+        audible = 0;
+        for (size_t index = 0; index < emitters.size(); index++)
+        {
+            Emitter &emitter = emitters[index];
+            if (!emitter.chosen)
+                continue;
+            if (emitter.slot < 0)
+            {
+                emitter.slot = FindFreeSlot();
+                slots[emitter.slot].emitter = emitter.id;
+                AudioManager::PlayMusic(firstChannel + emitter.slot, emitter.clip, true);
+            }
+            audible++;
+
+            float gain = gains[first + index];
+            Slot &slot = slots[emitter.slot];
+            Uint8 left = ToVolume(gain * Left(pans[first + index]));
+            Uint8 right = ToVolume(gain * Right(pans[first + index]));
+            if (slot.left != left || slot.right != right)
+            {
+                slot.left = left;
+                slot.right = right;
+                AudioHelper::Mix_SetPanning498(firstChannel + emitter.slot, left, right);
+            }
+        }
+    }
+
+    static int FindFreeSlot()
+    {
+        for (int i = 0; i < static_cast<int>(slots.size()); i++)
+        {
+            if (slots[i].emitter == 0)
+                return i;
+        }
+        return -1;
+    }
+
+    static void Silence(Emitter &emitter)
+    {
+        if (emitter.slot < 0)
+            return;
+        AudioHelper::Mix_HaltChannel498(firstChannel + emitter.slot);
+        // halting unregisters the channel's effects, panning included, so the next emitter starts from none
+        slots[emitter.slot].emitter = 0;
+        slots[emitter.slot].left = 255;
+        slots[emitter.slot].right = 255;
+        emitter.slot = -1;
+    }
+
+    static Emitter *FindEmitter(int id)
+    {
+        for (Emitter &emitter: emitters)
+        {
+            if (emitter.id == id)
+                return &emitter;
+        }
+        return nullptr;
+    }
+};
+
+
+#endif //MAIN_CPP_SPATIALAUDIO_H
@@ -0,0 +1,139 @@
+#ifndef MAIN_CPP_TEXTURELOADER_H
+#define MAIN_CPP_TEXTURELOADER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <utility>
+#include <chrono>
+#include <unordered_set>
+#ifndef __EMSCRIPTEN__
+#include <mutex>
+#endif
+#include "SDL2/SDL.h"
+#include "SDL2_image/SDL_image.h"
+#include "rapidjson/document.h"
+#include "Lua/lua.hpp"
+#include "LuaBridge/LuaBridge.h"
+#include "JobSystem.h"
+#include "AssetPack.h"
+
+// Images are decoded (IMG_Load) on background jobs and turned into textures on the main thread, a few per
+// frame, instead of IMG_LoadTexture stalling the frame that first draws them.
+//
+//   "texture_upload_budget_ms": 1       in game.config: time per frame spent creating textures (default 1)
+//   "texture_placeholder": "loading"    image drawn, at its own size, in place of images still loading
+//                                       (default: those are not drawn)
+//
+// Lua: Image.Preload({"a", "b", ...}) starts decoding images ahead of their first draw, e.g. behind a loading
+// screen; Image.GetPendingLoads() is the number not uploaded yet.
+//
+// Without worker threads, and when frames are compared with other builds' (Helper::IsExactRenderingMode),
+// draws load their image on the spot as before.
+class TextureLoader
+{
+public:
+    static inline std::string placeholder;
+
+    static void LoadFromConfig(const rapidjson::Document &gameConfig)
+    {
+        if (gameConfig.HasMember("texture_upload_budget_ms") && gameConfig["texture_upload_budget_ms"].IsNumber())
+            budgetMs = gameConfig["texture_upload_budget_ms"].GetDouble();
+        if (gameConfig.HasMember("texture_placeholder") && gameConfig["texture_placeholder"].IsString())
+            placeholder = gameConfig["texture_placeholder"].GetString();
+    }
+
+    // Starts decoding the image unless it was requested before; main thread only
+    static void Request(const std::string &image)
+    {
+        if (!requested.insert(image).second)
+            return;
+        pending++;
+
+        JobSystem::RunInBackground([image]()
+        {
+            SDL_Surface *surface = IMG_Load_RW(AssetPack::OpenRW("resources/images/" + image + ".png"), 1);
+            AddDecoded(image, surface);
+        }, decoding);
+    }
+
+    // An image decoded elsewhere (Scene.LoadAsync's job) to upload with the others; main thread only
+    static void Adopt(const std::string &image, SDL_Surface *surface)
+    {
+        if (requested.insert(image).second)
+        {
+            pending++;
+            uploads.emplace_back(image, surface);
+        }
+        else
+            SDL_FreeSurface(surface);
+    }
+
+    // Once per frame, before drawing: upload(image, surface) for decoded images until the budget is spent.
+    // upload takes the surface, which is nullptr when the image could not be read.
+    template<typename Upload>
+    static void Update(Upload &&upload)
+    {
+        {
+#ifndef __EMSCRIPTEN__
+            std::lock_guard<std::mutex> lock(decodedMutex);
+#endif
+            for (auto &image: decoded)
+                uploads.push_back(std::move(image));
+            decoded.clear();
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        while (!uploads.empty())
+        {
+            auto image = std::move(uploads.front());
+            uploads.pop_front();
+            upload(image.first, image.second);
+            pending--;
+
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            if (std::chrono::duration<double, std::milli>(elapsed).count() >= budgetMs)
+                break;
+        }
+    }
+
+    // Lua: Image.Preload(names)
+    static void Preload(const luabridge::LuaRef &images)
+    {
+        if (!images.isTable())
+            return;
+        for (int i = 1; i <= images.length(); i++)
+        {
+            if (images[i].isString())
+                Request(images[i].cast<std::string>());
+        }
+    }
+
+    // Lua: Image.GetPendingLoads()
+    static int GetPendingLoads()
+    {
+        return pending;
+    }
+
+private:
+    static inline double budgetMs = 1.0;
+    static inline JobCounter decoding;
+    static inline std::unordered_set<std::string> requested; // every image ever requested
+    static inline int pending = 0; // requested and not uploaded yet
+    static inline std::deque<std::pair<std::string, SDL_Surface *>> uploads;
+    static inline std::vector<std::pair<std::string, SDL_Surface *>> decoded; // filled by the decoding jobs
+#ifndef __EMSCRIPTEN__
+    static inline std::mutex decodedMutex;
+#endif
+
+    static void AddDecoded(const std::string &image, SDL_Surface *surface)
+    {
+#ifndef __EMSCRIPTEN__
+        std::lock_guard<std::mutex> lock(decodedMutex);
+#endif
+        decoded.emplace_back(image, surface);
+    }
+};
+
+
+#endif //MAIN_CPP_TEXTURELOADER_H
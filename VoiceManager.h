@@ -0,0 +1,237 @@
+#ifndef MAIN_CPP_VOICEMANAGER_H
+#define MAIN_CPP_VOICEMANAGER_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+#include "rapidjson/document.h"
+#include "Lua/lua.hpp"
+#include "LuaBridge/LuaBridge.h"
+#include "AudioHelper.h"
+#include "AudioManager.h"
+#include "SoftwareMixer.h"
+#include "Helper.h"
+
+// One-shot sound effects without picking channels: Audio.PlaySfx(clip, priority) finds a voice itself.
+// Voices are channels after the 50 that Audio.Play(channel, ...) addresses, so the two never meet, or with
+// "audio_mixer": "engine" voices of SoftwareMixer.
+//
+//   "audio_voices": 16             in game.config: channels for PlaySfx (default 16)
+//   "audio_max_per_clip": 4        voices one clip may hold at once (default 4)
+//
+// A clip that already started this frame is not started again. A clip at its limit restarts its oldest
+// voice. Otherwise a free voice is used, or the oldest of the lowest priority voices at or below the new
+// sound's priority is stolen; if every voice outranks it, or started this frame, the sound is dropped.
+// Either way no more than "audio_voices" effects mix at once, however many bounces a frame has.
+//
+// Lua: Audio.PlaySfx(clip [, priority = 0]) -> channel, or -1 if dropped or the clip does not exist
+//      Audio.SetClipLimit(clip, n)
+//      Audio.GetVoiceStats() -> {voices=, playing=, played=, deduplicated=, restarted=, stolen=, dropped=}
+class VoiceManager
+{
+public:
+    static constexpr int FIRST_VOICE = 50; // Audio.Play's channels come first
+
+    static void LoadFromConfig(const rapidjson::Document &gameConfig)
+    {
+        int count = 16;
+        if (gameConfig.HasMember("audio_voices") && gameConfig["audio_voices"].IsInt())
+            count = std::max(1, gameConfig["audio_voices"].GetInt());
+        if (gameConfig.HasMember("audio_max_per_clip") && gameConfig["audio_max_per_clip"].IsInt())
+            maxPerClip = std::max(1, gameConfig["audio_max_per_clip"].GetInt());
+
+        voices.assign(count, Voice());
+        AudioHelper::Mix_AllocateChannels498(FIRST_VOICE + count);
+        if (SoftwareMixer::IsEnabled())
+            SoftwareMixer::SetVoiceCount(count);
+    }
+
+    // Lua: Audio.PlaySfx(clip, priority)
+    static int PlaySfx(const std::string &clip, luabridge::LuaRef priorityArgument)
+    {
+        return Play(clip, priorityArgument.isNumber() ? priorityArgument.cast<int>() : 0);
+    }
+
+    // The channel the clip plays on, -1 if it was dropped or does not exist
+    static int Play(const std::string &clip, int priority)
+    {
+        if (AudioManager::clips.count(clip) == 0 && AudioManager::FindClip(clip).empty())
+            return -1;
+
+        int frame = Helper::GetFrameNumber();
+        int clipVoices = 0;
+        int oldestOfClip = -1;
+        for (int i = 0; i < static_cast<int>(voices.size()); i++)
+        {
+            Voice &voice = voices[i];
+            if (voice.clip != clip || !IsPlaying(i))
+                continue;
+            if (voice.startFrame == frame)
+            {
+                deduplicated++;
+                return FIRST_VOICE + i;
+            }
+            clipVoices++;
+            if (oldestOfClip < 0 || voice.startOrder < voices[oldestOfClip].startOrder)
+                oldestOfClip = i;
+        }
+
+        int target;
+        if (clipVoices >= GetClipLimit(clip))
+        {
+            target = oldestOfClip;
+            restarted++;
+        }
+        else
+        {
+            target = FindVoice(priority);
+            if (target < 0)
+            {
+                dropped++;
+                return -1;
+            }
+            if (IsPlaying(target))
+                stolen++;
+        }
+
+        Voice &voice = voices[target];
+        if (SoftwareMixer::IsEnabled())
+        {
+            if (!SoftwareMixer::Play(target, clip))
+                return -1;
+            voice.left = 255; // Play resets the gains
+            voice.right = 255;
+        }
+        else
+        {
+            AudioManager::PlayMusic(FIRST_VOICE + target, clip, false);
+            SetPanning(FIRST_VOICE + target, 255, 255); // panning stays with the channel, not the clip
+        }
+        voice.clip = clip;
+        voice.priority = priority;
+        voice.startFrame = frame;
+        voice.startOrder = nextStartOrder++;
+        played++;
+        return FIRST_VOICE + target;
+    }
+
+    // Identifies one sound of the voice on channel: 0 once it has stopped or another sound took the voice
+    static uint64_t GetStartOrder(int channel)
+    {
+        int voice = channel - FIRST_VOICE;
+        if (voice < 0 || voice >= static_cast<int>(voices.size()) || !IsPlaying(voice))
+            return 0;
+        return voices[voice].startOrder;
+    }
+
+    // Left and right volume (255 is full) of a voice's channel, for positional sounds
+    static void SetPanning(int channel, Uint8 left, Uint8 right)
+    {
+        Voice &voice = voices[channel - FIRST_VOICE];
+        if (voice.left == left && voice.right == right)
+            return;
+        voice.left = left;
+        voice.right = right;
+        if (SoftwareMixer::IsEnabled())
+            SoftwareMixer::SetGains(channel - FIRST_VOICE, left / 255.0f, right / 255.0f);
+        else
+            AudioHelper::Mix_SetPanning498(channel, left, right);
+    }
+
+    static int GetVoiceCount()
+    {
+        return static_cast<int>(voices.size());
+    }
+
+    // Lua: Audio.SetClipLimit(clip, n), n < 1 goes back to "audio_max_per_clip"
+    static void SetClipLimit(const std::string &clip, int limit)
+    {
+        if (limit < 1)
+            clipLimits.erase(clip);
+        else
+            clipLimits[clip] = limit;
+    }
+
+    // Lua: Audio.GetVoiceStats()
+    static luabridge::LuaRef GetStats(lua_State *L)
+    {
+        int playing = 0;
+        for (int i = 0; i < static_cast<int>(voices.size()); i++)
+            playing += IsPlaying(i) ? 1 : 0;
+
+        luabridge::LuaRef stats = luabridge::newTable(L);
+        stats["voices"] = static_cast<int>(voices.size());
+        stats["playing"] = playing;
+        stats["played"] = played;
+        stats["deduplicated"] = deduplicated;
+        stats["restarted"] = restarted;
+        stats["stolen"] = stolen;
+        stats["dropped"] = dropped;
+        return stats;
+    }
+
+private:
+    struct Voice
+    {
+        std::string clip; // empty: never used
+        int priority = 0;
+        int startFrame = -1;
+        uint64_t startOrder = 0;
+        Uint8 left = 255;
+        Uint8 right = 255;
+    };
+
+    static inline std::vector<Voice> voices = std::vector<Voice>(16);
+    static inline std::unordered_map<std::string, int> clipLimits;
+    static inline int maxPerClip = 4;
+    static inline uint64_t nextStartOrder = 1;
+
+    static inline int played = 0;
+    static inline int deduplicated = 0;
+    static inline int restarted = 0;
+    static inline int stolen = 0;
+    static inline int dropped = 0;
+
+    static int GetClipLimit(const std::string &clip)
+    {
+        auto it = clipLimits.find(clip);
+        return it != clipLimits.end() ? it->second : maxPerClip;
+    }
+
+    // Without a real device (autograder mode) nothing is ever playing, so a voice counts as busy for the frame
+    // it started in
+    static bool IsPlaying(int voice)
+    {
+        if (voices[voice].clip.empty())
+            return false;
+        if (voices[voice].startFrame == Helper::GetFrameNumber())
+            return true;
+        if (SoftwareMixer::IsEnabled())
+            return SoftwareMixer::IsPlaying(voice);
+        return AudioHelper::Mix_Playing498(FIRST_VOICE + voice) != 0;
+    }
+
+    // A free voice, else the oldest of the lowest priority ones that priority may steal; -1 if none.
+    // Voices started this frame are never stolen.
+    static int FindVoice(int priority)
+    {
+        int best = -1;
+        for (int i = 0; i < static_cast<int>(voices.size()); i++)
+        {
+            if (!IsPlaying(i))
+                return i;
+            const Voice &voice = voices[i];
+            if (voice.priority > priority || voice.startFrame == Helper::GetFrameNumber())
+                continue; // outranks it, or has not been heard yet
+            if (best < 0 || voice.priority < voices[best].priority ||
+                (voice.priority == voices[best].priority && voice.startOrder < voices[best].startOrder))
+                best = i;
+        }
+        return best;
+    }
+};
+
+
+#endif //MAIN_CPP_VOICEMANAGER_H
@@ -0,0 +1,327 @@
+#!/usr/bin/env python3
+"""Generates the benchmark scenes into bench/out/<scene>/.
+
+Every scene directory is a complete game (resources/ plus sdl_user_input.txt). The input file replays
+an SDL_QUIT (event 256) on the last frame, so the engine runs exactly --frames frames and exits.
+
+    python3 bench/generate.py --frames 600 --scale 1.0
+"""
+
+import argparse
+import json
+import math
+import os
+import shutil
+
+BENCH_DIR = os.path.dirname(os.path.abspath(__file__))
+REPO_DIR = os.path.dirname(BENCH_DIR)
+SDL_QUIT = 256
+
+SPRITE = "box1"  # copied from resources/images
+FONT = "NotoSans-Regular"  # copied from resources/fonts
+
+
+def rigidbody(**overrides):
+    component = {"type": "Rigidbody"}
+    component.update(overrides)
+    return component
+
+
+def actor(name, components):
+    return {"name": name, "components": {str(i + 1): c for i, c in enumerate(components)}}
+
+
+# --- Lua component types --------------------------------------------------------------------------------
+
+SPRITE_SWARM_LUA = """-- Draws `count` moving sprites every frame from a single component
+SpriteSwarm = {
+	count = 1000,
+	sprite = "box1",
+
+	OnUpdate = function(self)
+		local t = Application.GetFrame() * 0.02
+		for i = 1, self.count do
+			local x = math.sin(i * 0.37 + t) * 3.0
+			local y = math.cos(i * 0.61 + t) * 1.6
+			Image.DrawEx(self.sprite, x, y, i + t * 50, 0.25, 0.25, 0.5, 0.5, 255, i % 256, 255, 255, i % 8)
+		end
+	end
+}
+"""
+
+BOX_SPRITE_LUA = """-- Draws the actor's sprite at its Rigidbody
+BoxSprite = {
+	sprite = "box1",
+
+	OnStart = function(self)
+		self.rb = self.actor:GetComponent("Rigidbody")
+	end,
+
+	OnUpdate = function(self)
+		local pos = self.rb:GetPosition()
+		Image.DrawEx(self.sprite, pos.x, pos.y, self.rb:GetRotation(), 0.1, 0.1, 0.5, 0.5, 255, 255, 255, 255, 0)
+	end
+}
+"""
+
+PROJECTILE_LUA = """Projectile = {
+	vx = 0,
+	vy = 0,
+	lifetime_frames = 60,
+	age = 0,
+
+	OnStart = function(self)
+		self.rb = self.actor:GetComponent("Rigidbody")
+	end,
+
+	OnUpdate = function(self)
+		-- the body only exists once Ready has run, so launch on the first update
+		if self.age == 0 then
+			self.rb:SetVelocity(Vector2(self.vx, self.vy))
+		end
+
+		self.age = self.age + 1
+		if self.age >= self.lifetime_frames then
+			Actor.Destroy(self.actor)
+		end
+	end
+}
+"""
+
+PROJECTILE_SPAWNER_LUA = """-- Keeps spawns_per_second / 60 * lifetime_frames pooled projectiles alive
+ProjectileSpawner = {
+	spawns_per_second = 10000,
+	lifetime_frames = 60,
+	speed = 5,
+	spawned = 0,
+
+	OnStart = function(self)
+		self.carry = 0
+	end,
+
+	OnUpdate = function(self)
+		self.carry = self.carry + self.spawns_per_second / 60
+		local count = math.floor(self.carry)
+		self.carry = self.carry - count
+
+		for i = 1, count do
+			local projectile = Actor.Instantiate("Projectile")
+			local rb = projectile:GetComponent("Rigidbody")
+			rb.x = 0
+			rb.y = 0
+
+			-- golden angle spread keeps the pattern identical from run to run
+			local angle = self.spawned * 2.399963
+			local behaviour = projectile:GetComponent("Projectile")
+			behaviour.vx = math.cos(angle) * self.speed
+			behaviour.vy = math.sin(angle) * self.speed
+			behaviour.lifetime_frames = self.lifetime_frames
+
+			self.spawned = self.spawned + 1
+		end
+	end
+}
+"""
+
+LISTENER_LUA = """Listener = {
+	received = 0,
+
+	OnStart = function(self)
+		Event.Subscribe("tick", self, self.OnTick)
+		Event.Subscribe("damage", self, self.OnDamage)
+	end,
+
+	OnTick = function(self, event)
+		self.received = self.received + event.value
+	end,
+
+	OnDamage = function(self, event)
+		self.received = self.received - event.value
+	end
+}
+"""
+
+PUBLISHER_LUA = """-- Publishes `events_per_frame` events, alternating between two event types
+Publisher = {
+	events_per_frame = 100,
+
+	OnUpdate = function(self)
+		local event = { value = 1 }
+		for i = 1, self.events_per_frame do
+			if i % 2 == 0 then
+				Event.Publish("tick", event)
+			else
+				Event.Publish("damage", event)
+			end
+		end
+	end
+}
+"""
+
+HUD_LUA = """-- A text heavy HUD: `lines` labels whose numbers change every frame
+StressHud = {
+	lines = 100,
+	font = "NotoSans-Regular",
+
+	OnUpdate = function(self)
+		local frame = Application.GetFrame()
+		for i = 1, self.lines do
+			local x = ((i - 1) % 4) * 160
+			local y = math.floor((i - 1) / 4) * 14
+			Text.Draw("score " .. i .. ": " .. (frame * i) % 100000, x, y, self.font, 12, 255, 255, 255, 255)
+		end
+	end
+}
+"""
+
+RAYCAST_SWARM_LUA = """-- Casts `rays_per_frame` rays (and a few RaycastAll) through the scattered bodies every frame
+RaycastSwarm = {
+	rays_per_frame = 1000,
+	all_rays_per_frame = 50,
+	hits = 0,
+
+	OnUpdate = function(self)
+		local t = Application.GetFrame() * 0.01
+		for i = 1, self.rays_per_frame do
+			local angle = i * 2.399963 + t
+			local hit = Physics.Raycast(Vector2(0, 0), Vector2(math.cos(angle), math.sin(angle)), 20)
+			if hit ~= nil then
+				self.hits = self.hits + 1
+			end
+		end
+		for i = 1, self.all_rays_per_frame do
+			local angle = i * 0.7 + t
+			local hits = Physics.RaycastAll(Vector2(0, 0), Vector2(math.cos(angle), math.sin(angle)), 20)
+			self.hits = self.hits + #hits
+		end
+	end
+}
+"""
+
+# --- scenes -------------------------------------------------------------------------------------------
+
+
+def sprite_stress(scale):
+    count = int(10000 * scale)
+    actors = [actor("Swarm", [{"type": "SpriteSwarm", "count": count, "sprite": SPRITE}])]
+    return {"actors": actors}, {"SpriteSwarm": SPRITE_SWARM_LUA}, {}, {}
+
+
+def physics_pile(scale):
+    count = int(2000 * scale)
+    actors = [actor("Ground", [rigidbody(x=0, y=1.7, body_type="static", width=6.4, height=0.2, has_trigger=False)])]
+    columns = 50
+    for i in range(count):
+        x = -2.5 + (i % columns) * 0.1 + (0.05 if (i // columns) % 2 else 0)
+        y = 1.5 - (i // columns) * 0.1
+        actors.append(actor("Box", [
+            rigidbody(x=round(x, 3), y=round(y, 3), width=0.09, height=0.09, has_trigger=False),
+            {"type": "BoxSprite", "sprite": SPRITE}]))
+    return {"actors": actors}, {"BoxSprite": BOX_SPRITE_LUA}, {}, {}
+
+
+def spawn_churn(scale):
+    spawns = int(10000 * scale)
+    actors = [actor("Spawner", [{"type": "ProjectileSpawner", "spawns_per_second": spawns, "lifetime_frames": 60}])]
+    templates = {"Projectile": {
+        "name": "Projectile",
+        "components": {
+            "1": rigidbody(collider_type="circle", radius=0.05, has_trigger=False, gravity_scale=0,
+                           layer="projectile", pooled=True),
+            "2": {"type": "Projectile"},
+        }}}
+    config = {"body_pool_size": spawns * 2, "collision_layers": {"default": ["default"], "projectile": []}}
+    return {"actors": actors}, {"Projectile": PROJECTILE_LUA, "ProjectileSpawner": PROJECTILE_SPAWNER_LUA}, \
+        templates, config
+
+
+def event_storm(scale):
+    listeners = int(1000 * scale)
+    actors = [actor("Listener", [{"type": "Listener"}]) for _ in range(listeners)]
+    actors.append(actor("Publisher", [{"type": "Publisher", "events_per_frame": 100}]))
+    return {"actors": actors}, {"Listener": LISTENER_LUA, "Publisher": PUBLISHER_LUA}, {}, {}
+
+
+def text_hud(scale):
+    lines = int(100 * scale)
+    actors = [actor("HUD", [{"type": "StressHud", "lines": lines, "font": FONT}])]
+    return {"actors": actors}, {"StressHud": HUD_LUA}, {}, {}
+
+
+def raycast_swarm(scale):
+    bodies = int(1000 * scale)
+    actors = [actor("Caster", [{"type": "RaycastSwarm", "rays_per_frame": int(1000 * scale)}])]
+    for i in range(bodies):
+        # sunflower spiral around the caster
+        radius = 0.5 + 8.0 * math.sqrt((i + 1) / bodies)
+        angle = i * 2.399963
+        actors.append(actor("Target", [rigidbody(
+            x=round(math.cos(angle) * radius, 3), y=round(math.sin(angle) * radius, 3),
+            body_type="static", collider_type="circle", radius=0.1, has_trigger=False)]))
+    return {"actors": actors}, {"RaycastSwarm": RAYCAST_SWARM_LUA}, {}, {}
+
+
+SCENES = {
+    "sprite_stress": sprite_stress,
+    "physics_pile": physics_pile,
+    "spawn_churn": spawn_churn,
+    "event_storm": event_storm,
+    "text_hud": text_hud,
+    "raycast_swarm": raycast_swarm,
+}
+
+
+def write_json(path, value):
+    os.makedirs(os.path.dirname(path), exist_ok=True)
+    with open(path, "w") as f:
+        json.dump(value, f, indent="\t")
+
+
+def generate(name, frames, scale, out_dir):
+    scene, lua, templates, extra_config = SCENES[name](scale)
+
+    root = os.path.join(out_dir, name)
+    shutil.rmtree(root, ignore_errors=True)
+    resources = os.path.join(root, "resources")
+
+    config = {"game_title": "Benchmark: " + name, "initial_scene": name}
+    config.update(extra_config)
+    write_json(os.path.join(resources, "game.config"), config)
+    write_json(os.path.join(resources, "rendering.config"), {"x_resolution": 640, "y_resolution": 360})
+    write_json(os.path.join(resources, "scenes", name + ".scene"), scene)
+
+    for template_name, template in templates.items():
+        write_json(os.path.join(resources, "actor_templates", template_name + ".template"), template)
+
+    os.makedirs(os.path.join(resources, "component_types"))
+    for type_name, source in lua.items():
+        with open(os.path.join(resources, "component_types", type_name + ".lua"), "w") as f:
+            f.write(source)
+
+    os.makedirs(os.path.join(resources, "images"))
+    shutil.copy(os.path.join(REPO_DIR, "resources", "images", SPRITE + ".png"), os.path.join(resources, "images"))
+    os.makedirs(os.path.join(resources, "fonts"))
+    shutil.copy(os.path.join(REPO_DIR, "resources", "fonts", FONT + ".ttf"), os.path.join(resources, "fonts"))
+
+    with open(os.path.join(root, "sdl_user_input.txt"), "w") as f:
+        f.write("%d;%d;\n" % (frames, SDL_QUIT))
+
+    return root
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--frames", type=int, default=600, help="frames to run before quitting")
+    parser.add_argument("--scale", type=float, default=1.0, help="multiplies every scene's entity counts")
+    parser.add_argument("--out", default=os.path.join(BENCH_DIR, "out"), help="output directory")
+    parser.add_argument("scenes", nargs="*", default=list(SCENES), help="scenes to generate (default: all)")
+    args = parser.parse_args()
+
+    for name in args.scenes:
+        if name not in SCENES:
+            parser.error("unknown scene %s, expected one of %s" % (name, ", ".join(SCENES)))
+        print(generate(name, args.frames, args.scale, args.out))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,137 @@
+// Startup asset reads, loose files against resources.pak (AssetPack.h), on a generated resources/ of 2000
+// files: component scripts, templates, images and clips of 1-64 KB.
+//
+//     cmake --build build --target asset_load_bench && ./build/asset_load_bench [files] [directory]
+//
+// Loose reads do what the engine did for every asset, an exists() check then open, read and close; pack
+// reads open the pack once and look each file up. Every byte is read in both. On Linux the "cold" runs drop
+// the files from the page cache first (posix_fadvise), which is the closest to a cold disk without root.
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <filesystem>
+#include "AssetPack.h"
+
+using Clock = std::chrono::steady_clock;
+
+static uint64_t Checksum(const char *data, size_t size)
+{
+    uint64_t sum = 0;
+    for (size_t i = 0; i < size; i += 64)
+        sum += static_cast<unsigned char>(data[i]);
+    return sum;
+}
+
+static void DropFromCache(const std::string &path)
+{
+#ifdef ASSET_PACK_MMAP
+    int descriptor = open(path.c_str(), O_RDONLY);
+    if (descriptor >= 0)
+    {
+        fdatasync(descriptor);
+        posix_fadvise(descriptor, 0, 0, POSIX_FADV_DONTNEED);
+        close(descriptor);
+    }
+#else
+    (void)path;
+#endif
+}
+
+static uint64_t ReadLoose(const std::vector<std::string> &paths)
+{
+    uint64_t sum = 0;
+    std::vector<char> contents;
+    for (const std::string &path: paths)
+    {
+        if (!std::filesystem::exists(path))
+            continue;
+        FILE *file = std::fopen(path.c_str(), "rb");
+        std::fseek(file, 0, SEEK_END);
+        contents.resize(static_cast<size_t>(std::ftell(file)));
+        std::fseek(file, 0, SEEK_SET);
+        size_t read = std::fread(contents.data(), 1, contents.size(), file);
+        std::fclose(file);
+        sum += Checksum(contents.data(), read);
+    }
+    return sum;
+}
+
+static uint64_t ReadPack(const std::string &packPath, const std::vector<std::string> &paths)
+{
+    AssetPack::Open(packPath);
+    uint64_t sum = 0;
+    for (const std::string &path: paths)
+    {
+        AssetPack::Asset asset{};
+        if (AssetPack::Find(path, asset))
+            sum += Checksum(asset.data, asset.size);
+    }
+    AssetPack::Close();
+    return sum;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000;
+    std::filesystem::path directory = argc > 2 ? argv[2] : std::filesystem::temp_directory_path() / "asset_load_bench";
+
+    const char *kinds[][2] = {{"component_types", ".lua"}, {"actor_templates", ".template"}, {"images", ".png"},
+                              {"audio", ".wav"}};
+    std::mt19937 random(498);
+    std::vector<std::string> paths, diskPaths;
+    uint64_t bytes = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        const char **kind = kinds[i % 4];
+        std::filesystem::create_directories(directory / "resources" / kind[0]);
+        std::string path = "resources/" + std::string(kind[0]) + "/asset" + std::to_string(i) + kind[1];
+        std::vector<char> contents(1024 + random() % (63 * 1024), static_cast<char>('a' + i % 26));
+        FILE *file = std::fopen((directory / path).string().c_str(), "wb");
+        std::fwrite(contents.data(), 1, contents.size(), file);
+        std::fclose(file);
+        paths.push_back(path);
+        diskPaths.push_back((directory / path).string());
+        bytes += contents.size();
+    }
+
+    std::string packPath = (directory / "resources.pak").string();
+    if (!AssetPack::Write(packPath, paths, diskPaths))
+    {
+        std::printf("error: failed to write %s\n", packPath.c_str());
+        return 1;
+    }
+
+    // the engine opens paths relative to the game directory
+    std::filesystem::current_path(directory);
+    std::printf("%zu files, %.1f MB\n", count, bytes / 1048576.0);
+    for (bool cold: {false, true})
+    {
+        double looseMs = 1e30, packMs = 1e30;
+        uint64_t looseSum = 0, packSum = 0;
+        for (int run = 0; run < 5; run++)
+        {
+            if (cold)
+            {
+                for (const std::string &path: paths)
+                    DropFromCache(path);
+            }
+            auto start = Clock::now();
+            looseSum = ReadLoose(paths);
+            looseMs = std::min(looseMs, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+
+            if (cold)
+                DropFromCache(packPath);
+            start = Clock::now();
+            packSum = ReadPack(packPath, paths);
+            packMs = std::min(packMs, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+        }
+        std::printf("  %s  loose %8.2f ms   pack %8.2f ms  %5.1fx%s\n", cold ? "cold" : "warm", looseMs, packMs,
+                    looseMs / packMs, looseSum == packSum ? "" : "  (contents differ!)");
+    }
+    return 0;
+}
@@ -0,0 +1,139 @@
+// Voices mixed per millisecond by SoftwareMixer's loops (AudioMix.h) against SDL_mixer's per-channel path, for
+// 16 to 1024 panned voices of 16-bit stereo into one 2048 frame device buffer (Mix_OpenAudio498's chunk size).
+//
+//     cmake --build build --target audio_mix_bench && ./build/audio_mix_bench [max voices] [buffers]
+//
+// The bench builds without SDL, so the SDL_mixer column repeats what SDL_mixer 2 does for each playing channel:
+// copy the chunk's samples into the channel buffer, run the Mix_SetPanning effect over them, then
+// SDL_MixAudioFormat them into the stream, one clamped sample at a time. The engine columns are AudioMix's
+// scalar reference and its SIMD path (SSE2, or AVX2 when built with -DENGINE_AVX2=ON); both must give the
+// same stream.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include "AudioMix.h"
+
+using Clock = std::chrono::steady_clock;
+
+static constexpr size_t BUFFER_FRAMES = 2048;
+static constexpr size_t CLIP_FRAMES = 44100;
+
+struct Voice
+{
+    std::vector<int16_t> samples;
+    size_t position;
+    float left;
+    float right;
+};
+
+// SDL_mixer: mix_channels -> Mix_SetPanning's _Eff_position_s16lsb -> SDL_MixAudioFormat(AUDIO_S16LSB)
+static void MixLikeSdlMixer(std::vector<Voice> &voices, int16_t *stream, std::vector<int16_t> &channelBuffer)
+{
+    const int volume = 128; // MIX_MAX_VOLUME
+    for (Voice &voice: voices)
+    {
+        size_t count = BUFFER_FRAMES * 2;
+        std::memcpy(channelBuffer.data(), voice.samples.data() + voice.position * 2, count * sizeof(int16_t));
+        for (size_t i = 0; i < count; i += 2)
+        {
+            channelBuffer[i] = static_cast<int16_t>(static_cast<float>(channelBuffer[i]) * voice.left);
+            channelBuffer[i + 1] = static_cast<int16_t>(static_cast<float>(channelBuffer[i + 1]) * voice.right);
+        }
+        for (size_t i = 0; i < count; i++)
+        {
+            int sample = channelBuffer[i] * volume / 128 + stream[i];
+            stream[i] = static_cast<int16_t>(std::min(32767, std::max(-32768, sample)));
+        }
+    }
+}
+
+template<bool Simd>
+static void MixWithEngine(std::vector<Voice> &voices, int16_t *stream, std::vector<float> &block)
+{
+    std::fill(block.begin(), block.end(), 0.0f);
+    for (Voice &voice: voices)
+    {
+        const int16_t *samples = voice.samples.data() + voice.position * 2;
+        if (Simd)
+            AudioMix::AddVoice(block.data(), samples, BUFFER_FRAMES, voice.left, voice.right);
+        else
+            AudioMix::AddVoiceScalar(block.data(), samples, BUFFER_FRAMES, voice.left, voice.right);
+    }
+    if (Simd)
+        AudioMix::AddToStream(stream, block.data(), BUFFER_FRAMES * 2, 1.0f);
+    else
+        AudioMix::AddToStreamScalar(stream, block.data(), BUFFER_FRAMES * 2, 1.0f);
+}
+
+// Best of 5 runs of buffers callbacks; returns voices mixed per millisecond and leaves the last stream
+template<typename Mix>
+static double Measure(std::vector<Voice> &voices, int buffers, std::vector<int16_t> &stream, Mix &&mix)
+{
+    double bestMs = 1e30;
+    for (int run = 0; run < 5; run++)
+    {
+        auto start = Clock::now();
+        for (int buffer = 0; buffer < buffers; buffer++)
+        {
+            for (Voice &voice: voices)
+                voice.position = (buffer * BUFFER_FRAMES) % (CLIP_FRAMES - BUFFER_FRAMES);
+            std::fill(stream.begin(), stream.end(), static_cast<int16_t>(0));
+            mix(stream.data());
+        }
+        bestMs = std::min(bestMs, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+    }
+    return static_cast<double>(voices.size()) * buffers / bestMs;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t maxVoices = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1024;
+    int buffers = argc > 2 ? std::atoi(argv[2]) : 20;
+
+    std::mt19937 random(498);
+    std::uniform_int_distribution<int> sample(-6000, 6000);
+    std::uniform_real_distribution<float> gain(0.0f, 1.0f);
+
+    std::vector<int16_t> stream(BUFFER_FRAMES * 2), reference(BUFFER_FRAMES * 2), channelBuffer(BUFFER_FRAMES * 2);
+    std::vector<float> block(BUFFER_FRAMES * 2);
+
+    std::printf("engine path: %s, %zu frame buffers\n", AudioMix::GetPath(), BUFFER_FRAMES);
+    std::printf("%8s %16s %16s %16s %10s\n", "voices", "sdl_mixer /ms", "scalar /ms", "simd /ms", "speed-up");
+    for (size_t count = 16; count <= maxVoices; count *= 4)
+    {
+        std::vector<Voice> voices(count);
+        for (Voice &voice: voices)
+        {
+            voice.samples.resize(CLIP_FRAMES * 2);
+            for (int16_t &value: voice.samples)
+                value = static_cast<int16_t>(sample(random));
+            voice.left = gain(random);
+            voice.right = gain(random);
+        }
+
+        double sdlMixer = Measure(voices, buffers, stream, [&](int16_t *out)
+        {
+            MixLikeSdlMixer(voices, out, channelBuffer);
+        });
+        double scalar = Measure(voices, buffers, reference, [&](int16_t *out)
+        {
+            MixWithEngine<false>(voices, out, block);
+        });
+        double simd = Measure(voices, buffers, stream, [&](int16_t *out)
+        {
+            MixWithEngine<true>(voices, out, block);
+        });
+        if (stream != reference)
+        {
+            std::printf("error: %s and scalar mixes differ at %zu voices\n", AudioMix::GetPath(), count);
+            return 1;
+        }
+        std::printf("%8zu %16.0f %16.0f %16.0f %9.1fx\n", count, sdlMixer, scalar, simd, simd / sdlMixer);
+    }
+    return 0;
+}
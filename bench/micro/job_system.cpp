@@ -0,0 +1,121 @@
+// Microbenchmarks for JobSystem.h: job spawn overhead, ParallelFor scaling and TaskGraph overhead.
+//
+//     cmake --build build --target job_system_bench && ./build/job_system_bench [max threads]
+//
+// Thread counts go 1, 2, 4, ... up to max threads (default: hardware threads, at most 16). A larger max
+// oversubscribes the machine, which is only useful to check correctness.
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include "JobSystem.h"
+
+using Clock = std::chrono::steady_clock;
+
+static double MillisecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Best of a few runs, to keep the numbers stable on a busy machine
+template<typename Function>
+static double BestOf(int runs, Function &&function)
+{
+    double best = 1e30;
+    for (int i = 0; i < runs; i++)
+    {
+        auto start = Clock::now();
+        function();
+        best = std::min(best, MillisecondsSince(start));
+    }
+    return best;
+}
+
+static void SpawnOverhead(int threads)
+{
+    const int jobs = 200000;
+    std::atomic<int> executed{0};
+
+    double ms = BestOf(5, [&]()
+    {
+        JobCounter counter;
+        for (int i = 0; i < jobs; i++)
+            JobSystem::Run([&executed]() { executed.fetch_add(1, std::memory_order_relaxed); }, counter);
+        JobSystem::Wait(counter);
+    });
+    std::printf("  spawn + wait   %2d threads  %8.1f ns/job\n", threads, ms * 1e6 / jobs);
+}
+
+// Enough math per element that the loop is compute bound rather than memory bound
+static double ParallelForKernel(std::vector<float> &values)
+{
+    return BestOf(5, [&values]()
+    {
+        JobSystem::ParallelFor(values.size(), 0, [&values](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; i++)
+            {
+                float x = values[i];
+                for (int k = 0; k < 16; k++)
+                    x = std::sqrt(x * x + 1.0f) * 0.999f;
+                values[i] = x;
+            }
+        });
+    });
+}
+
+// Layers of tasks, each depending on two tasks of the previous layer
+static double TaskGraphRun(TaskGraph &graph)
+{
+    return BestOf(5, [&graph]() { graph.Run(); });
+}
+
+int main(int argc, char *argv[])
+{
+    int hardware = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    int maxThreads = argc > 1 ? std::atoi(argv[1]) : std::min(hardware, 16);
+    std::printf("%d hardware threads\n", hardware);
+
+    std::vector<float> values(1 << 22);
+    for (size_t i = 0; i < values.size(); i++)
+        values[i] = static_cast<float>(i % 1000);
+
+    std::atomic<int> taskWork{0};
+    TaskGraph graph;
+    const int layers = 64, width = 64;
+    for (int layer = 0; layer < layers; layer++)
+    {
+        for (int i = 0; i < width; i++)
+        {
+            auto task = [&taskWork]() { taskWork.fetch_add(1, std::memory_order_relaxed); };
+            if (layer == 0)
+                graph.Add(task);
+            else
+                graph.Add(task, {(layer - 1) * width + i, (layer - 1) * width + (i + 1) % width});
+        }
+    }
+
+    double singleThreadMs = 0.0;
+    for (int threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        JobSystem::Initialize(threads - 1);
+        std::printf("%d threads:\n", JobSystem::GetThreadCount());
+        SpawnOverhead(threads);
+
+        double ms = ParallelForKernel(values);
+        if (threads == 1)
+            singleThreadMs = ms;
+        std::printf("  parallel_for   %2d threads  %8.2f ms  %5.2fx\n", threads, ms, singleThreadMs / ms);
+
+        double graphMs = TaskGraphRun(graph);
+        std::printf("  task graph     %2d threads  %8.1f ns/task (%zu tasks)\n", threads, graphMs * 1e6 / graph.Size(),
+                    graph.Size());
+    }
+
+    JobSystem::Shutdown();
+    return 0;
+}
@@ -0,0 +1,64 @@
+// Microbenchmark for the image preparation stage of Renderer::RenderImages: destination rects, culling and
+// vertex data for 50k sprite requests, at 1, 2, 4, ... threads up to the hardware threads (or the number given).
+//
+//     cmake --build build --target render_prep_bench && ./build/render_prep_bench [max threads] [sprites]
+//
+// Only the preparation runs, against a fake texture, so no window or renderer is created.
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include "Renderer.h"
+
+using Clock = std::chrono::steady_clock;
+
+int main(int argc, char *argv[])
+{
+    int hardware = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    int maxThreads = argc > 1 ? std::atoi(argv[1]) : std::min(hardware, 16);
+    size_t sprites = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 50000;
+
+    Renderer renderer;
+    renderer.window_width = 1280;
+    renderer.window_height = 720;
+    renderer.imageTextures["box1"] = {reinterpret_cast<SDL_Texture *>(&renderer), 100, 100};
+
+    // the sprite_stress pattern, spread a little wider so some of them are culled
+    std::vector<Renderer::ImageRenderRequest> requests;
+    for (size_t i = 0; i < sprites; i++)
+    {
+        float x = std::sin(i * 0.37f) * 8.0f;
+        float y = std::cos(i * 0.61f) * 5.0f;
+        SDL_Color color = {255, static_cast<Uint8>(i % 256), 255, 255};
+        requests.emplace_back("box1", color, x, y, static_cast<float>(i % 8), static_cast<float>(i % 360),
+                              i % 3 ? 0.25f : -0.25f, 0.25f, 0.5f, 0.5f);
+    }
+
+    std::printf("%d hardware threads, %zu sprites\n", hardware, sprites);
+    double singleThreadMs = 0.0;
+    for (int threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        JobSystem::Initialize(threads - 1);
+
+        double best = 1e30;
+        for (int run = 0; run < 20; run++)
+        {
+            auto start = Clock::now();
+            renderer.PrepareImages(requests, true);
+            best = std::min(best, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+        }
+        if (threads == 1)
+            singleThreadMs = best;
+
+        size_t visible = std::count_if(renderer.preparedImages.begin(), renderer.preparedImages.end(),
+                                       [](const Renderer::PreparedImage &image) { return image.visible; });
+        std::printf("  %2d threads  %7.3f ms  %5.2fx  (%zu visible)\n", threads, best, singleThreadMs / best, visible);
+    }
+
+    JobSystem::Shutdown();
+    return 0;
+}
@@ -0,0 +1,172 @@
+// Scene file load times for a generated 50k actor scene: the JSON as it used to be read (streamed through a
+// FileReadStream, the templates parsed again for every actor), the JSON with each template parsed once, the
+// same parsed in situ (EngineUtils::ParseJsonFile), the actors streamed one at a time without the scene's DOM
+// (SceneReader.h), and the compiled .scenec (CompiledScene.h).
+//
+//     cmake --build build --target scene_load_bench && ./build/scene_load_bench [actors] [directory]
+//
+// Only the files are read into documents; creating the actors and their Lua components comes on top of all
+// of them. The scene and templates are written to the directory (default: a temporary one) and left there.
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <filesystem>
+#include "CompiledScene.h"
+#include "EngineUtils.h"
+#include "SceneReader.h"
+#include "rapidjson/filereadstream.h"
+
+using Clock = std::chrono::steady_clock;
+
+// EngineUtils::ReadJsonFile as it was before it parsed in situ
+static void ReadJsonFile(const std::string &path, rapidjson::Document &document)
+{
+    FILE *file = std::fopen(path.c_str(), "rb");
+    char buffer[65536];
+    rapidjson::FileReadStream stream(file, buffer, sizeof(buffer));
+    document.ParseStream(stream);
+    std::fclose(file);
+}
+
+static void WriteScene(const std::filesystem::path &directory, size_t actors)
+{
+    std::filesystem::create_directories(directory / "actor_templates");
+    const char *templates[] = {"Enemy", "Coin", "Wall", "Tree"};
+    for (const char *name: templates)
+    {
+        FILE *file = std::fopen((directory / "actor_templates" / (std::string(name) + ".template")).string().c_str(), "w");
+        std::fprintf(file, "{\"components\": {\"1\": {\"type\": \"SpriteRenderer\", \"sprite\": \"%s\", \"x\": 0, "
+                           "\"y\": 0}, \"2\": {\"type\": \"Rigidbody\", \"body_type\": \"static\", \"width\": 1.0, "
+                           "\"height\": 1.0}, \"3\": {\"type\": \"%sBehaviour\", \"speed\": 2.5, \"active\": true}}}",
+                     name, name);
+        std::fclose(file);
+    }
+
+    FILE *file = std::fopen((directory / "bench.scene").string().c_str(), "w");
+    std::fprintf(file, "{\"actors\": [\n");
+    for (size_t i = 0; i < actors; i++)
+    {
+        std::fprintf(file, "  {\"name\": \"actor%zu\", \"template\": \"%s\", \"components\": {\"2\": {\"x\": %zu, "
+                           "\"y\": %.2f}, \"3\": {\"speed\": %zu}}}%s\n",
+                     i, templates[i % 4], i % 100, (i % 37) * 0.5, i % 7, i + 1 < actors ? "," : "");
+    }
+    std::fprintf(file, "]}\n");
+    std::fclose(file);
+}
+
+template<typename Function>
+static double BestOf(int runs, Function &&function)
+{
+    double best = 1e30;
+    for (int i = 0; i < runs; i++)
+    {
+        auto start = Clock::now();
+        function();
+        best = std::min(best, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+    }
+    return best;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t actors = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 50000;
+    std::filesystem::path directory = argc > 2 ? argv[2] : std::filesystem::temp_directory_path() / "scene_load_bench";
+    WriteScene(directory, actors);
+
+    std::string scenePath = (directory / "bench.scene").string();
+    auto templatePath = [&directory](const rapidjson::Value &actor)
+    {
+        return (directory / "actor_templates" / (std::string(actor["template"].GetString()) + ".template")).string();
+    };
+
+    double perActorMs = BestOf(3, [&]()
+    {
+        rapidjson::Document scene;
+        ReadJsonFile(scenePath, scene);
+        for (const auto &actor: scene["actors"].GetArray())
+        {
+            rapidjson::Document document;
+            ReadJsonFile(templatePath(actor), document);
+        }
+    });
+
+    CompiledScene::Templates templates;
+    double cachedMs = BestOf(3, [&]()
+    {
+        rapidjson::Document scene;
+        templates.clear();
+        ReadJsonFile(scenePath, scene);
+        for (const auto &actor: scene["actors"].GetArray())
+        {
+            std::string name = actor["template"].GetString();
+            if (templates.count(name) == 0)
+                ReadJsonFile(templatePath(actor), templates[name]);
+        }
+    });
+
+    size_t insituBytes = 0;
+    double insituMs = BestOf(3, [&]()
+    {
+        rapidjson::Document scene;
+        templates.clear();
+        EngineUtils::ParseJsonFile(scenePath, scene);
+        for (const auto &actor: scene["actors"].GetArray())
+        {
+            std::string name = actor["template"].GetString();
+            if (templates.count(name) == 0)
+                EngineUtils::ParseJsonFile(templatePath(actor), templates[name]);
+        }
+        insituBytes = scene.GetAllocator().Capacity();
+    });
+
+    size_t streamedActors = 0;
+    double streamedMs = BestOf(3, [&]()
+    {
+        templates.clear();
+        streamedActors = 0;
+        SceneReader::ForEachActor(scenePath, [&](const rapidjson::Value &actor)
+        {
+            std::string name = actor["template"].GetString();
+            if (templates.count(name) == 0)
+                EngineUtils::ParseJsonFile(templatePath(actor), templates[name]);
+            streamedActors++;
+        });
+    });
+    if (streamedActors != actors)
+    {
+        std::printf("error: streamed %zu of %zu actors\n", streamedActors, actors);
+        return 1;
+    }
+
+    rapidjson::Document scene;
+    ReadJsonFile(scenePath, scene);
+    if (!CompiledScene::Write(CompiledScene::PathFor(scenePath), scene, templates))
+    {
+        std::printf("error: failed to write %s\n", CompiledScene::PathFor(scenePath).c_str());
+        return 1;
+    }
+
+    double compiledMs = BestOf(3, [&]()
+    {
+        CompiledScene compiled;
+        rapidjson::Document compiledScene;
+        CompiledScene::Templates compiledTemplates;
+        if (!compiled.Load(CompiledScene::PathFor(scenePath), compiledScene, compiledTemplates))
+            std::printf("error: failed to load the compiled scene\n");
+    });
+
+    std::printf("%zu actors, %.1f MB of JSON, %.1f MB compiled\n", actors,
+                std::filesystem::file_size(scenePath) / 1048576.0,
+                std::filesystem::file_size(CompiledScene::PathFor(scenePath)) / 1048576.0);
+    std::printf("  json, templates per actor  %8.2f ms\n", perActorMs);
+    std::printf("  json, templates once       %8.2f ms  %5.1fx\n", cachedMs, perActorMs / cachedMs);
+    std::printf("  json in situ               %8.2f ms  %5.1fx  (%.1f MB of DOM and text)\n", insituMs,
+                perActorMs / insituMs, insituBytes / 1048576.0);
+    std::printf("  json streamed              %8.2f ms  %5.1fx  (the text and one actor)\n", streamedMs,
+                perActorMs / streamedMs);
+    std::printf("  compiled                   %8.2f ms  %5.1fx\n", compiledMs, perActorMs / compiledMs);
+    return 0;
+}
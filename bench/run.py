@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+"""Runs the benchmark scenes headless and collects their reports into one JSON file.
+
+The engine must be built with the benchmark report enabled:
+
+    cmake -S . -B build -DENGINE_BENCHMARK=ON && cmake --build build -j
+    python3 bench/run.py --engine build/game_engine_jhinpan --out bench/results.json
+
+With --baseline, the run is compared against an earlier results file and the script exits with 1 if
+any scene's mean or p99 frame time, or its allocations per frame, grew by more than --tolerance.
+
+With --golden, every scene also captures its frames (AUTOGRADER=1) and tools/frame_diff compares them against
+<golden>/<scene>/; a scene without goldens yet has its frames copied there instead.
+"""
+
+import argparse
+import json
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+
+import generate
+
+GATED_METRICS = [
+    ("frame_ms", "mean"),
+    ("frame_ms", "p99"),
+    ("allocations", "per_frame"),
+]
+
+
+def run_scene(engine, scene_dir, timeout, capture):
+    with tempfile.TemporaryDirectory() as tmp:
+        report_path = os.path.join(tmp, "report.json")
+        env = dict(os.environ, ENGINE_BENCHMARK_REPORT=report_path)
+        if capture:
+            env["AUTOGRADER"] = "1"
+        process = subprocess.run([engine, "--headless"], cwd=scene_dir, env=env, timeout=timeout,
+                                 stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, text=True)
+        if not os.path.exists(report_path):
+            raise RuntimeError("no report (exit code %d): %s" % (process.returncode, process.stderr.strip()))
+        with open(report_path) as f:
+            return json.load(f)
+
+
+def diff_frames(frame_diff, golden_root, name, scene_dir):
+    """Returns True if the scene's frames match its goldens (or the goldens were just created)."""
+    frames = os.path.join(scene_dir, "frames")
+    golden = os.path.join(golden_root, name)
+    if not os.path.isdir(golden):
+        shutil.copytree(frames, golden)
+        print("  %-14s no goldens, copied %d frames to %s" % (name, len(os.listdir(golden)), golden))
+        return True
+
+    process = subprocess.run([frame_diff, "--diff-dir", os.path.join(scene_dir, "frame_diffs"), golden, frames],
+                             stdout=subprocess.PIPE, text=True)
+    print("  %-14s %s" % (name, process.stdout.strip().splitlines()[-1] if process.stdout.strip() else "no output"))
+    return process.returncode == 0
+
+
+def compare(results, baseline, tolerance):
+    regressions = []
+    for name, report in results["scenes"].items():
+        base = baseline.get("scenes", {}).get(name)
+        if base is None:
+            continue
+        for group, metric in GATED_METRICS:
+            old, new = base[group][metric], report[group][metric]
+            change = (new - old) / old if old > 0 else 0.0
+            flag = "REGRESSION" if change > tolerance else ""
+            print("  %-14s %-22s %10.3f -> %10.3f  %+6.1f%%  %s" % (name, group + "." + metric, old, new,
+                                                                  change * 100, flag))
+            if flag:
+                regressions.append((name, group + "." + metric))
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--engine", required=True, help="engine binary built with -DENGINE_BENCHMARK=ON")
+    parser.add_argument("--frames", type=int, default=600)
+    parser.add_argument("--scale", type=float, default=1.0)
+    parser.add_argument("--out", default=os.path.join(generate.BENCH_DIR, "results.json"))
+    parser.add_argument("--baseline", help="earlier results file to gate against")
+    parser.add_argument("--tolerance", type=float, default=0.10, help="allowed relative growth (default 0.10)")
+    parser.add_argument("--timeout", type=float, default=600, help="seconds per scene")
+    parser.add_argument("--golden", help="directory of golden frames per scene; enables frame capture")
+    parser.add_argument("--frame-diff", default=os.path.join(generate.REPO_DIR, "build", "frame_diff"),
+                        help="frame_diff binary (default build/frame_diff)")
+    parser.add_argument("scenes", nargs="*", default=list(generate.SCENES))
+    args = parser.parse_args()
+
+    engine = os.path.abspath(args.engine)
+    out_dir = os.path.join(generate.BENCH_DIR, "out")
+    results = {"engine": engine, "frames": args.frames, "scale": args.scale, "scenes": {}}
+    frame_failures = []
+
+    for name in args.scenes:
+        scene_dir = generate.generate(name, args.frames, args.scale, out_dir)
+        report = run_scene(engine, scene_dir, args.timeout, args.golden is not None)
+        results["scenes"][name] = report
+        frame_ms = report["frame_ms"]
+        print("%-14s mean %8.3f  p50 %8.3f  p99 %8.3f  max %8.3f ms  %8.1f allocs/frame  %7d KB peak RSS" % (
+            name, frame_ms["mean"], frame_ms["p50"], frame_ms["p99"], frame_ms["max"],
+            report["allocations"]["per_frame"], report["peak_rss_kb"]))
+        if args.golden and not diff_frames(os.path.abspath(args.frame_diff), args.golden, name, scene_dir):
+            frame_failures.append(name)
+
+    with open(args.out, "w") as f:
+        json.dump(results, f, indent=2)
+    print("wrote " + args.out)
+
+    failed = False
+    if frame_failures:
+        print("frames differ from the goldens in: " + ", ".join(frame_failures))
+        failed = True
+
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+        print("against " + args.baseline + ":")
+        regressions = compare(results, baseline, args.tolerance)
+        if regressions:
+            print("%d regression(s) over %.0f%%" % (len(regressions), args.tolerance * 100))
+            failed = True
+
+    if failed:
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
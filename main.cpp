@@ -5,16 +5,26 @@
 #include "rapidjson/document.h"
 #include "EngineUtils.h"
 #include "Scene.h"
+#include "SceneLoader.h"
 #include "Helper.h"
 #include "Renderer.h"
 #include "AudioManager.h"
+#include "VoiceManager.h"
+#include "SpatialAudio.h"
+#include "SoftwareMixer.h"
 #include "Input.h"
+#include "ActivityCulling.h"
+#include "Profiler.h"
+#include "Benchmark.h"
+#include "JobSystem.h"
 #include "SDL2/SDL.h"
 #include "SDL2_image/SDL_image.h"
 #include "Lua/lua.hpp"
 #include "LuaBridge/LuaBridge.h"
 #include "box2d.h"
+#ifdef __EMSCRIPTEN__
 #include "emscripten.h"
+#endif
 
 enum GameState
 {
@@ -29,6 +39,13 @@ Renderer renderer;
 Scene currentScene;
 
 void initialize() {
+    // no window and no sound card: the dummy drivers still run the full renderer and mixer
+    if (Helper::IsHeadlessMode())
+    {
+        SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+        SDL_setenv("SDL_AUDIODRIVER", "dummy", 1);
+    }
+
     if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) < 0)
     {
         std::cerr << "SDL could not initialize! SDL_Error: " << SDL_GetError() << std::endl;
@@ -45,12 +62,16 @@ void initialize() {
         exit(1);
     }
 
-    // After SDL, IMG, and TTF initialization, initialize the audio system
-    AudioManager audioManager;
+    // After SDL, IMG, and TTF initialization, initialize the audio system. Only now, with the headless drivers
+    // picked, and only once: static, so the device stays open until exit instead of closing with initialize()
+    static AudioManager audioManager;
     std::string gameTitle; // Default to empty string if not defined
 
 
-    if (!std::filesystem::exists("resources/game.config"))
+    // resources.pak, when there is one, serves resources/ from a single mapped file (tools/asset_pack.cpp)
+    AssetPack::Open("resources.pak");
+
+    if (!AssetPack::Exists("resources/game.config"))
     {
         std::cerr << "error: resources/game.config missing";
         exit(1);
@@ -61,12 +82,48 @@ void initialize() {
     if (gameConfig.HasMember("game_title") && gameConfig["game_title"].IsString())
         gameTitle = gameConfig["game_title"].GetString();
 
+    // named collision layers and their layer matrix
+    CollisionLayers::LoadFromConfig(gameConfig);
+
+    if (gameConfig.HasMember("body_pool_size") && gameConfig["body_pool_size"].IsInt())
+        BodyPool::maxPooledPerTemplate = gameConfig["body_pool_size"].GetInt();
+
+    // fixed seeds and per-frame state hashes for replay verification
+    Determinism::LoadFromConfig(gameConfig);
+
+    // per component type call counts, time and Lua memory
+    LuaStats::LoadFromConfig(gameConfig);
+
+    // worker threads for render preparation, asset decoding and scene loading
+    JobSystem::LoadFromConfig(gameConfig);
+
+    // time per frame spent creating the actors of Scene.LoadAsync
+    SceneLoader::LoadFromConfig(gameConfig);
+
+    // time per frame spent creating the actors of Actor.InstantiateDeferred
+    InstantiationQueue::LoadFromConfig(gameConfig);
+
+    // images decoded on workers, uploaded within a per-frame budget
+    TextureLoader::LoadFromConfig(gameConfig);
+
+    // clips over this size stream from their file instead of being decoded whole
+    AudioManager::LoadFromConfig(gameConfig);
+
+    // the engine's SIMD mixer for Audio.PlaySfx / PlayAt voices instead of SDL_mixer channels
+    SoftwareMixer::LoadFromConfig(gameConfig);
+
+    // channels Audio.PlaySfx picks from, and how many of them one clip may hold
+    VoiceManager::LoadFromConfig(gameConfig);
+
+    // how far positional sounds carry, and how many emitters play at once
+    SpatialAudio::LoadFromConfig(gameConfig);
+
 
     // Resolution settings
     int windowWidth = 640; // Default width
     int windowHeight = 360; // Default height
     rapidjson::Document renderingConfig;
-    if (std::filesystem::exists("resources/rendering.config"))
+    if (AssetPack::Exists("resources/rendering.config"))
     {
         EngineUtils::ReadJsonFile("resources/rendering.config", renderingConfig);
         if (renderingConfig.HasMember("x_resolution"))
@@ -102,6 +159,7 @@ void initialize() {
                         if (onStart.isFunction() && (*component.second)["enabled"] && !(*component.second)["removed"])
                         {
                             actor->componentsOnStart.insert({component.first, component.second});
+                            LuaStats::Scope scope(component.second, LuaStats::ON_START);
                             try
                             {
                                 onStart(*component.second);
@@ -122,20 +180,26 @@ void initialize() {
 }
 
 void main_loop(){
+    BENCHMARK_BEGIN_FRAME();
 
     SDL_Event next_event; // Event handler
+#ifdef __EMSCRIPTEN__
         if (quit) {
             emscripten_cancel_main_loop();  // Optionally stop the loop if needed
         }
+#endif
 
-    // Handle events(or actually inputs) on queue
-    while (Helper::SDL_PollEvent498(&next_event))
-    { // return 1 if events
-        Input::ProcessEvent(next_event); // Call every frame at start of event loop.
+    {
+        PROFILE_ZONE("Input");
+        // Handle events(or actually inputs) on queue
+        while (Helper::SDL_PollEvent498(&next_event))
+        { // return 1 if events
+            Input::ProcessEvent(next_event); // Call every frame at start of event loop.
 
-        if (next_event.type == SDL_QUIT)
-        {
-            quit = true;
+            if (next_event.type == SDL_QUIT)
+            {
+                quit = true;
+            }
         }
     }
 
@@ -151,268 +215,363 @@ void main_loop(){
         }
         case SCENE:
         {
-            // Run the newly added actors' OnStart functions
-            // Queue OnStart calls for each component in alphabetical order
-            if (!componentsAwaitingOnStart.empty())
             {
-                for (const auto &component: componentsAwaitingOnStart)
+                PROFILE_ZONE("OnStart");
+                // Run the newly added actors' OnStart functions
+                // Queue OnStart calls for each component in alphabetical order
+                if (!componentsAwaitingOnStart.empty())
                 {
-
-                    // only if it has the OnStart function
-                    luabridge::LuaRef onStart = (*component)["OnStart"];
-                    if (onStart.isFunction() && (*component)["enabled"] && !(*component)["removed"]
-                        && !(*component)["actor"]["fromAnotherScene"])
+                    for (const auto &component: componentsAwaitingOnStart)
                     {
-                        try
-                        {
-                            onStart(*component);
-                        }
-                        catch (const luabridge::LuaException &e)
+
+                        // only if it has the OnStart function
+                        luabridge::LuaRef onStart = (*component)["OnStart"];
+                        if (onStart.isFunction() && (*component)["enabled"] && !(*component)["removed"]
+                            && !(*component)["actor"]["fromAnotherScene"])
                         {
-                            std::cout << "\033[31m" << " : " << e.what()
-                                      << "\033[0m" << std::endl;
+                            LuaStats::Scope scope(component, LuaStats::ON_START);
+                            try
+                            {
+                                onStart(*component);
+                            }
+                            catch (const luabridge::LuaException &e)
+                            {
+                                std::cout << "\033[31m" << " : " << e.what()
+                                          << "\033[0m" << std::endl;
+                            }
                         }
+
                     }
+                    componentsAwaitingOnStart.clear();
+                }
 
+                // for actor in actors_to_add
+                // actor.onStart()
+                // actors.add(actor)
+                for (auto actor: ComponentManager::actors_to_add)
+                {
+                    actor->OnStart(); // using the componentsOnStart
+                    Scene::actors.push_back(actor);
                 }
-                componentsAwaitingOnStart.clear();
+                ComponentManager::actors_to_add.clear();
             }
 
-            // for actor in actors_to_add
-            // actor.onStart()
-            // actors.add(actor)
-            for (auto actor: ComponentManager::actors_to_add)
             {
-                actor->OnStart(); // using the componentsOnStart
-                Scene::actors.push_back(actor);
+                PROFILE_ZONE("Ready");
+                // Actually its supposed ot for actors_to_add since we are instantiating the actors with rigidbody to the scene
+                // Consider a more time-saving way to handle with this
+                for (auto actor: Scene::getActors())
+                {
+                    for (const auto &component: actor->componentsOnReady)
+                    {
+
+                        // only if it has the Ready function
+                        luabridge::LuaRef ready = (*component)["Ready"];
+                        if (ready.isFunction() && (*component)["enabled"] && !(*component)["removed"]
+                            && !(*component)["actor"]["fromAnotherScene"])
+                        {
+                            try
+                            {
+                                ready(*component);
+                            }
+                            catch (const luabridge::LuaException &e)
+                            {
+                                std::cout << "\033[31m" << " : " << e.what()
+                                          << "\033[0m" << std::endl;
+                            }
+                        }
+                    }
+                    actor->componentsOnReady.clear();
+                }
             }
-            ComponentManager::actors_to_add.clear();
 
-            // Actually its supposed ot for actors_to_add since we are instantiating the actors with rigidbody to the scene
-            // Consider a more time-saving way to handle with this
-            for (auto actor: Scene::getActors())
             {
-                for (const auto &component: actor->componentsOnReady)
+                PROFILE_ZONE("AddComponents");
+                // add component in componentsAdded to the actor's current components
+                // for actor in actors:
+                // actor.ProcessAddedComponents()
+                for (auto actor: Scene::getActors())
                 {
-
-                    // only if it has the Ready function
-                    luabridge::LuaRef ready = (*component)["Ready"];
-                    if (ready.isFunction() && (*component)["enabled"] && !(*component)["removed"]
-                        && !(*component)["actor"]["fromAnotherScene"])
+                    for (const auto &component: actor->componentsAdded)
                     {
-                        try
-                        {
-                            ready(*component);
-                        }
-                        catch (const luabridge::LuaException &e)
-                        {
-                            std::cout << "\033[31m" << " : " << e.what()
-                                      << "\033[0m" << std::endl;
-                        }
+                        actor->components[component.first] = component.second;
                     }
+                    actor->componentsAdded.clear();
                 }
-                actor->componentsOnReady.clear();
             }
 
-            // add component in componentsAdded to the actor's current components
-            // for actor in actors:
-            // actor.ProcessAddedComponents()
-            for (auto actor: Scene::getActors())
             {
-                for (const auto &component: actor->componentsAdded)
+                PROFILE_ZONE("OnUpdate");
+                // The behavior of actors will now be defined via components alone.
+                // If a component contains an OnUpdate(self) function, call it every frame.
+                // Make the call after we have finished calling OnStart for every actor and every component
+                // calling order: Iterate through actors by ID, then components by key
+                ActivityCulling::BeginFrame(Renderer::Camera::cam_pos_x, Renderer::Camera::cam_pos_y,
+                                            Renderer::Camera::zoom_factor, renderer.window_width, renderer.window_height);
+                for (auto actor: Scene::getActors())
                 {
-                    actor->components[component.first] = component.second;
+                    actor->updateCulled = !ActivityCulling::ShouldUpdate(actor, Helper::GetFrameNumber());
+                    if (actor->updateCulled)
+                    {
+                        ActivityCulling::RepeatDraws(actor); // it draws from OnUpdate
+                        continue;
+                    }
+                    bool keepDraws = ActivityCulling::KeepsDraws(actor);
+                    ActivityCulling::DrawMark drawMark = ActivityCulling::MarkDraws();
+
+                    if (actor->componentsOnUpdate.empty())
+                    {
+                        for (const auto &component: actor->components)
+                        {
+                            // only if it has the OnUpdate function
+                            luabridge::LuaRef onUpdate = (*component.second)["OnUpdate"];
+                            if (onUpdate.isFunction() && (*component.second)["enabled"] &&
+                                !(*component.second)["removed"])
+                            {
+                                actor->componentsOnUpdate.insert({component.first, component.second});
+                                LuaStats::Scope scope(component.second, LuaStats::ON_UPDATE);
+                                try
+                                {
+                                    onUpdate(*component.second);
+                                }
+                                catch (const luabridge::LuaException &e)
+                                {
+                                    std::cout << "\033[31m" << actor->name << " : " << e.what()
+                                              << "\033[0m" << std::endl;
+                                }
+                            }
+                        }
+                    }
+                    else
+                    {
+                        actor->OnUpdate(); // using the componentsOnUpdate
+                    }
+                    if (keepDraws)
+                        ActivityCulling::KeepDraws(actor, drawMark, true);
+
                 }
-                actor->componentsAdded.clear();
             }
 
-            // The behavior of actors will now be defined via components alone.
-            // If a component contains an OnUpdate(self) function, call it every frame.
-            // Make the call after we have finished calling OnStart for every actor and every component
-            // calling order: Iterate through actors by ID, then components by key
-            for (auto actor: Scene::getActors())
             {
-                if (actor->componentsOnUpdate.empty())
+                PROFILE_ZONE("LateUpdate");
+                // for actor in actors: actor.LateUpdate()
+                for (auto actor: Scene::getActors())
                 {
+                    ActivityCulling::DrawMark drawMark = ActivityCulling::MarkDraws();
                     for (const auto &component: actor->components)
                     {
-                        // only if it has the OnUpdate function
-                        luabridge::LuaRef onUpdate = (*component.second)["OnUpdate"];
-                        if (onUpdate.isFunction() && (*component.second)["enabled"] &&
+                        // only if it has the OnLateUpdate function
+                        luabridge::LuaRef onLateUpdate = (*component.second)["OnLateUpdate"];
+                        if (!actor->updateCulled && onLateUpdate.isFunction() && (*component.second)["enabled"] &&
                             !(*component.second)["removed"])
                         {
-                            actor->componentsOnUpdate.insert({component.first, component.second});
+                            LuaStats::Scope scope(component.second, LuaStats::ON_LATE_UPDATE);
                             try
                             {
-                                onUpdate(*component.second);
+                                onLateUpdate(*component.second);
                             }
                             catch (const luabridge::LuaException &e)
                             {
                                 std::cout << "\033[31m" << actor->name << " : " << e.what()
                                           << "\033[0m" << std::endl;
                             }
-                        }
-                    }
-                }
-                else
-                {
-                    actor->OnUpdate(); // using the componentsOnUpdate
-                }
 
-            }
-
-            // for actor in actors: actor.LateUpdate()
-            for (auto actor: Scene::getActors())
-            {
-                for (const auto &component: actor->components)
-                {
-                    // only if it has the OnLateUpdate function
-                    luabridge::LuaRef onLateUpdate = (*component.second)["OnLateUpdate"];
-                    if (onLateUpdate.isFunction() && (*component.second)["enabled"] &&
-                        !(*component.second)["removed"])
-                    {
-                        try
-                        {
-                            onLateUpdate(*component.second);
-                        }
-                        catch (const luabridge::LuaException &e)
-                        {
-                            std::cout << "\033[31m" << actor->name << " : " << e.what()
-                                      << "\033[0m" << std::endl;
                         }
 
-                    }
-
-                    luabridge::LuaRef onDestroy = (*component.second)["OnDestroy"];
-                    if (onDestroy.isFunction() &&
-                        (*component.second)["removed"])
-                    {
-                        try
+                        luabridge::LuaRef onDestroy = (*component.second)["OnDestroy"];
+                        if (onDestroy.isFunction() &&
+                            (*component.second)["removed"])
                         {
-                            onDestroy(*component.second);
-                        }
-                        catch (const luabridge::LuaException &e)
-                        {
-                            std::cout << "\033[31m" << actor->name << " : " << e.what()
-                                      << "\033[0m" << std::endl;
-                        }
+                            LuaStats::Scope scope(component.second, LuaStats::ON_DESTROY);
+                            try
+                            {
+                                onDestroy(*component.second);
+                            }
+                            catch (const luabridge::LuaException &e)
+                            {
+                                std::cout << "\033[31m" << actor->name << " : " << e.what()
+                                          << "\033[0m" << std::endl;
+                            }
 
+                        }
                     }
+                    if (!actor->updateCulled && ActivityCulling::KeepsDraws(actor))
+                        ActivityCulling::KeepDraws(actor, drawMark, false);
                 }
             }
 
 
 
 
-            // for actor in actors: actor.ProcessRemovedComponents()
-            // Remove components in componentsToRemove from the actor's current components
-            for (auto actor: Scene::getActors())
             {
-                for (const auto &component: actor->componentsToRemove)
+                PROFILE_ZONE("RemoveComponents");
+                // for actor in actors: actor.ProcessRemovedComponents()
+                // Remove components in componentsToRemove from the actor's current components
+                for (auto actor: Scene::getActors())
                 {
-                    // Check if the component exists in the actor's components map
-                    auto it = actor->components.find(component);
-
-                    // If found, remove the component from the map
-                    if (it != actor->components.end())
+                    for (const auto &component: actor->componentsToRemove)
                     {
-                        actor->components.erase(it);
+                        // Check if the component exists in the actor's components map
+                        auto it = actor->components.find(component);
+
+                        // If found, remove the component from the map
+                        if (it != actor->components.end())
+                        {
+                            LuaStats::Forget(it->second);
+                            actor->components.erase(it);
+                        }
                     }
+                    actor->componentsToRemove.clear();
                 }
-                actor->componentsToRemove.clear();
             }
 
-            // for actors in actors_to_destroy:
-            // actor.OnDestroy()
-            // actors.remove(actor)
-            for (auto actor: ComponentManager::actors_to_remove)
             {
-                actor->OnDestroy(); // clear all those components
-                Scene::actors.erase(std::remove(Scene::actors.begin(), Scene::actors.end(), actor),
-                                    Scene::actors.end());
-                delete actor;
+                PROFILE_ZONE("DestroyActors");
+                // for actors in actors_to_destroy:
+                // actor.OnDestroy()
+                // actors.remove(actor)
+                for (auto actor: ComponentManager::actors_to_remove)
+                {
+                    actor->OnDestroy(); // clear all those components
+                    ActivityCulling::Forget(actor);
+                    Scene::actors.erase(std::remove(Scene::actors.begin(), Scene::actors.end(), actor),
+                                        Scene::actors.end());
+                    delete actor;
+                }
+                ComponentManager::actors_to_remove.clear();
             }
-            ComponentManager::actors_to_remove.clear();
-
 
-            // EventBus.ProcessSubscriptions()
-            EventBus::ProcessDeferredActions();
 
-            // PhysicsStep()
-//                b2Vec2 gravity(0.0f, 10.0f);
-//                b2World world(gravity);
+            {
+                PROFILE_ZONE("EventBus");
+                // EventBus.ProcessSubscriptions()
+                EventBus::ProcessDeferredActions();
+            }
 
-            if (world_initialized)
             {
+                PROFILE_ZONE("Physics");
+                // PhysicsStep()
+    //                b2Vec2 gravity(0.0f, 10.0f);
+    //                b2World world(gravity);
 
-                // std::cout << "PHYSICS STEP" << Helper::GetFrameNumber() << std::endl;
-                const float TIME_STEP = 1.0f / 60.0f;
-                const int32 VELOCITY_ITERATIONS = 8;
-                const int32 POSITION_ITERATIONS = 3;
+                if (world_initialized)
+                {
+
+                    // std::cout << "PHYSICS STEP" << Helper::GetFrameNumber() << std::endl;
+                    // one fixed step per frame, independent of how long the frame took
+                    const int32 VELOCITY_ITERATIONS = 8;
+                    const int32 POSITION_ITERATIONS = 3;
 
-                world->Step(TIME_STEP, VELOCITY_ITERATIONS, POSITION_ITERATIONS);
+                    world->Step(Determinism::FIXED_TIME_STEP, VELOCITY_ITERATIONS, POSITION_ITERATIONS);
 
+                    // bodies released from inside contact callbacks
+                    BodyPool::ProcessPendingReleases();
+
+                }
             }
 
-            // Render() Structure:
-            // stable_sort(image_render_requests, CompareImageRequests)
-            std::stable_sort(Renderer::imageRenderRequests.begin(), Renderer::imageRenderRequests.end(),
-                             [](const Renderer::ImageRenderRequest &a, const Renderer::ImageRenderRequest &b)
-                             {
-                                 return a.sorting_order < b.sorting_order;
-                             });
-
-            // stable_sort(ui_render_requests, CompareUIRequests)
-            std::stable_sort(Renderer::uiRenderRequests.begin(), Renderer::uiRenderRequests.end(),
-                             [](const Renderer::UIRenderRequest &a, const Renderer::UIRenderRequest &b)
-                             {
-                                 return a.sorting_order < b.sorting_order;
-                             });
-
-            SDL_RenderSetScale(Renderer::renderer, Renderer::Camera::zoom_factor, Renderer::Camera::zoom_factor);
-
-            // for request in image_render_requests:
-            //     RenderImageRequest(request)
-            for (const auto &request: Renderer::imageRenderRequests)
+            // deterministic mode: hash of the simulation state after this frame's update and physics
+            Determinism::RecordFrame(Scene::getActors(), Helper::GetFrameNumber());
+
             {
-                renderer.RenderImage(request);
+                PROFILE_ZONE("Sort");
+                // Render() Structure:
+                // stable_sort(image_render_requests, CompareImageRequests)
+                std::stable_sort(Renderer::imageRenderRequests.begin(), Renderer::imageRenderRequests.end(),
+                                 [](const Renderer::ImageRenderRequest &a, const Renderer::ImageRenderRequest &b)
+                                 {
+                                     return a.sorting_order < b.sorting_order;
+                                 });
+
+                // stable_sort(ui_render_requests, CompareUIRequests)
+                std::stable_sort(Renderer::uiRenderRequests.begin(), Renderer::uiRenderRequests.end(),
+                                 [](const Renderer::UIRenderRequest &a, const Renderer::UIRenderRequest &b)
+                                 {
+                                     return a.sorting_order < b.sorting_order;
+                                 });
             }
-            Renderer::imageRenderRequests.clear();
 
-            SDL_RenderSetScale(Renderer::renderer, 1, 1);
-            // for request in ui_render_requests:
-            //     RenderUIRequest(request)
-            for (const auto &request: Renderer::uiRenderRequests)
             {
-                renderer.RenderUIImage(request);
+                PROFILE_ZONE("Audio");
+                // positional sounds follow the camera
+                SpatialAudio::Update(Renderer::Camera::cam_pos_x, Renderer::Camera::cam_pos_y,
+                                     Renderer::Camera::zoom_factor);
+                // this frame's voice starts and gains to the audio thread, in one lock
+                SoftwareMixer::Update();
+                // streamed music reads ahead of the audio thread
+                AudioManager::Update();
             }
-            Renderer::uiRenderRequests.clear();
 
-            // for request in text_render_requests:
-            //     RenderTextRequest(request)
-            while (!Renderer::textRenderRequests.empty())
             {
-                auto &request = Renderer::textRenderRequests.front();
-                renderer.RenderText(request);
-                Renderer::textRenderRequests.pop(); // This modifies the queue!
+                PROFILE_ZONE("UploadTextures");
+                // images decoded since last frame, the ones drawn before that had the placeholder
+                renderer.UploadTextures();
             }
 
-            // Render Pixel
-            SDL_SetRenderDrawBlendMode(Renderer::renderer, SDL_BLENDMODE_BLEND);
-            for (const auto &request: Renderer::pixelRenderRequests)
             {
-                renderer.RenderPixel(request);
+                PROFILE_ZONE("Draw");
+                SDL_RenderSetScale(Renderer::renderer, Renderer::Camera::zoom_factor, Renderer::Camera::zoom_factor);
+
+                {
+                    PROFILE_ZONE("Images");
+                    // prepared on the job system, submitted in texture batches
+                    renderer.RenderImages(Renderer::imageRenderRequests);
+                    Renderer::imageRenderRequests.clear();
+                }
+
+                SDL_RenderSetScale(Renderer::renderer, 1, 1);
+                {
+                    PROFILE_ZONE("UI");
+                    // for request in ui_render_requests:
+                    //     RenderUIRequest(request)
+                    for (const auto &request: Renderer::uiRenderRequests)
+                    {
+                        renderer.RenderUIImage(request);
+                    }
+                    Renderer::uiRenderRequests.clear();
+                }
+
+                {
+                    PROFILE_ZONE("Text");
+                    // for request in text_render_requests:
+                    //     RenderTextRequest(request)
+                    for (auto &request: Renderer::textRenderRequests)
+                    {
+                        renderer.RenderText(request);
+                    }
+                    Renderer::textRenderRequests.clear();
+                }
+
+                {
+                    PROFILE_ZONE("Pixels");
+                    // Render Pixel
+                    SDL_SetRenderDrawBlendMode(Renderer::renderer, SDL_BLENDMODE_BLEND);
+                    for (const auto &request: Renderer::pixelRenderRequests)
+                    {
+                        renderer.RenderPixel(request);
+                    }
+                    Renderer::pixelRenderRequests.clear();
+                }
+                SDL_SetRenderDrawBlendMode(Renderer::renderer, SDL_BLENDMODE_NONE);
             }
-            Renderer::pixelRenderRequests.clear();
-            SDL_SetRenderDrawBlendMode(Renderer::renderer, SDL_BLENDMODE_NONE);
 
 
-            // if (proceed_to_next_scene) LoadScene(next_scene_name)
-            if (LuaManager::sceneChange)
             {
-                currentScene.LoadNextScene(LuaManager::nextSceneName);
-                currentScene.sceneChange = false;
-                // continue;
+                PROFILE_ZONE("LoadScene");
+                // if (proceed_to_next_scene) LoadScene(next_scene_name)
+                if (LuaManager::sceneChange)
+                {
+                    SceneLoader::Cancel();
+                    currentScene.LoadNextScene(LuaManager::nextSceneName);
+                    LuaManager::sceneChange = false;
+                }
+                SceneLoader::Update(currentScene);
+            }
+
+            {
+                PROFILE_ZONE("Instantiate");
+                // the actors of Actor.InstantiateDeferred, as many as fit in the frame's budget
+                InstantiationQueue::Update(ComponentManager::FinishDeferredInstantiation);
             }
 
 
@@ -425,17 +584,42 @@ void main_loop(){
         }
     }
 
-    // SDL_RenderPresent498(renderer)
-    renderer.EndFrame();
+    {
+        PROFILE_ZONE("Present");
+        // SDL_RenderPresent498(renderer)
+        renderer.EndFrame();
+    }
+
+    LuaStats::EndFrame(Helper::GetFrameNumber());
+
+    // F9 writes the profiler's frame history as a Chrome trace
+    PROFILE_END_FRAME(Input::GetKeyDown(SDL_SCANCODE_F9));
 
     Input::LateUpdate();
+
+    BENCHMARK_END_FRAME();
 }
 
 int main(int argc, char *argv[])
 {
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::string(argv[i]) == "--headless")
+            Helper::_headless_mode = true;
+    }
+
+    BENCHMARK_REGISTER_REPORT();
+
     // event queue loop to drain the queue
     initialize();
+#ifdef __EMSCRIPTEN__
     emscripten_set_main_loop(main_loop, 0, 1);
+#else
+    while (!quit)
+    {
+        main_loop();
+    }
+#endif
 
     // Free resources and close SDL
     renderer.Cleanup();
@@ -0,0 +1,96 @@
+// asset_pack: packs resources/ into resources.pak (see AssetPack.h), which the engine reads instead of the
+// loose files when it finds one in its working directory.
+//
+//     asset_pack [resources dir] [resources.pak]
+//     asset_pack --list [resources.pak]
+//
+// Compiled scenes older than their .scene are left out, so the engine falls back to the JSON for those;
+// run scene_compile first.
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+#include "AssetPack.h"
+
+static int List(const std::string &packPath)
+{
+    FILE *file = std::fopen(packPath.c_str(), "rb");
+    AssetPackHeader header{};
+    if (file == nullptr || std::fread(&header, sizeof(header), 1, file) != 1 ||
+        std::memcmp(header.magic, AssetPack::MAGIC, sizeof(AssetPack::MAGIC)) != 0)
+    {
+        std::cout << "error: " << packPath << " is not an asset pack" << std::endl;
+        return 1;
+    }
+
+    std::vector<AssetPackEntry> entries(header.entryCount);
+    std::string names(header.namesBytes, '\0');
+    if (std::fread(entries.data(), sizeof(AssetPackEntry), entries.size(), file) != entries.size() ||
+        std::fread(names.data(), 1, names.size(), file) != names.size())
+    {
+        std::cout << "error: " << packPath << " is truncated" << std::endl;
+        return 1;
+    }
+    std::fclose(file);
+
+    for (const AssetPackEntry &entry: entries)
+        std::printf("%10llu  %s\n", static_cast<unsigned long long>(entry.size),
+                    names.substr(entry.nameOffset, entry.nameLength).c_str());
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1 && std::string(argv[1]) == "--list")
+        return List(argc > 2 ? argv[2] : "resources.pak");
+
+    std::filesystem::path resources = argc > 1 ? argv[1] : "resources";
+    std::string packPath = argc > 2 ? argv[2] : "resources.pak";
+
+    std::error_code error;
+    std::vector<std::filesystem::path> files;
+    for (const auto &entry: std::filesystem::recursive_directory_iterator(resources, error))
+    {
+        if (entry.is_regular_file())
+            files.push_back(entry.path());
+    }
+    if (error)
+    {
+        std::cout << "error: failed to read " << resources.string() << ": " << error.message() << std::endl;
+        return 1;
+    }
+    std::sort(files.begin(), files.end());
+
+    std::vector<std::string> paths, diskPaths;
+    uint64_t bytes = 0;
+    for (const auto &file: files)
+    {
+        if (file.extension() == ".scenec")
+        {
+            std::filesystem::path scene = file;
+            scene.replace_extension(".scene");
+            if (std::filesystem::exists(scene) &&
+                std::filesystem::last_write_time(file) < std::filesystem::last_write_time(scene))
+            {
+                std::cout << "skipping " << file.string() << ", it is older than its .scene" << std::endl;
+                continue;
+            }
+        }
+
+        // the engine opens everything as resources/...
+        paths.push_back("resources/" + std::filesystem::relative(file, resources).generic_string());
+        diskPaths.push_back(file.string());
+        bytes += std::filesystem::file_size(file);
+    }
+
+    if (!AssetPack::Write(packPath, paths, diskPaths))
+    {
+        std::cout << "error: failed to write " << packPath << std::endl;
+        return 1;
+    }
+    std::printf("%s: %zu files, %.1f KB\n", packPath.c_str(), paths.size(), bytes / 1024.0);
+    return 0;
+}
@@ -0,0 +1,532 @@
+// frame_diff: compares two directories of captured frames (see FrameCapture.h) and reports, per frame, the
+// share of pixels that differ by more than a per-channel tolerance.
+//
+//     frame_diff [options] <golden dir> <candidate dir>
+//
+// Frames are paired by name (frame_00042.bmp / .raw / .rle), so a raw capture can be checked against bmp
+// goldens. A frame fails when more than --max-mismatch percent of its pixels differ; failures get a diff
+// image in --diff-dir (the golden frame in dim gray, differing pixels in red). Exits with 1 if any frame
+// failed or is missing on one side, 2 on usage errors.
+//
+// No SDL: this builds everywhere the engine's CMake build does and only needs the C++17 standard library.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <filesystem>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FRAME_DIFF_SSE2
+#endif
+
+namespace fs = std::filesystem;
+
+// Same layout as FrameCapture::Header, leads .raw and .rle files
+struct CaptureHeader
+{
+    char magic[4];
+    uint32_t width;
+    uint32_t height;
+    uint32_t frame;
+};
+
+// BGR24, top row first, rows packed
+struct Image
+{
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> pixels;
+};
+
+struct Options
+{
+    int tolerance = 0; // per channel
+    double maxMismatch = 0.0; // percent of pixels
+    std::string diffDir;
+    std::string jsonPath;
+    int threads = 0;
+    bool hold = false;
+    bool verbose = false;
+};
+
+struct FramePair
+{
+    std::string name; // frame_00042
+    std::string golden; // empty if missing
+    std::string candidate;
+};
+
+struct FrameResult
+{
+    uint64_t mismatched = 0;
+    uint64_t pixels = 0;
+    int maxDelta = 0;
+    bool failed = false;
+    std::string error; // missing frame, unreadable file, size mismatch
+};
+
+static bool ReadFile(const std::string &path, std::vector<uint8_t> &buffer)
+{
+    FILE *file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr)
+        return false;
+
+    std::fseek(file, 0, SEEK_END);
+    long size = std::ftell(file);
+    std::fseek(file, 0, SEEK_SET);
+    buffer.resize(size > 0 ? static_cast<size_t>(size) : 0);
+    bool ok = size > 0 && std::fread(buffer.data(), 1, buffer.size(), file) == buffer.size();
+    std::fclose(file);
+    return ok;
+}
+
+template<typename T>
+static T Load(const uint8_t *bytes)
+{
+    T value;
+    std::memcpy(&value, bytes, sizeof(T));
+    return value;
+}
+
+// 24 or 32-bit uncompressed BMP, either row order
+static bool DecodeBmp(const std::vector<uint8_t> &file, Image &image)
+{
+    if (file.size() < 54 || file[0] != 'B' || file[1] != 'M')
+        return false;
+
+    uint32_t dataOffset = Load<uint32_t>(&file[10]);
+    int32_t width = Load<int32_t>(&file[18]);
+    int32_t height = Load<int32_t>(&file[22]);
+    uint16_t bitsPerPixel = Load<uint16_t>(&file[28]);
+    uint32_t compression = Load<uint32_t>(&file[30]);
+    if (width <= 0 || height == 0 || (bitsPerPixel != 24 && bitsPerPixel != 32) || (compression != 0 && compression != 3))
+        return false;
+
+    bool bottomUp = height > 0;
+    height = std::abs(height);
+    size_t bytesPerPixel = bitsPerPixel / 8;
+    size_t stride = (width * bytesPerPixel + 3) & ~static_cast<size_t>(3);
+    if (dataOffset + stride * (height - 1) + width * bytesPerPixel > file.size())
+        return false;
+
+    image.width = width;
+    image.height = height;
+    image.pixels.resize(static_cast<size_t>(width) * height * 3);
+    for (int y = 0; y < height; y++)
+    {
+        const uint8_t *source = file.data() + dataOffset + stride * (bottomUp ? height - 1 - y : y);
+        uint8_t *destination = image.pixels.data() + static_cast<size_t>(y) * width * 3;
+        if (bytesPerPixel == 3)
+        {
+            std::memcpy(destination, source, static_cast<size_t>(width) * 3);
+            continue;
+        }
+        for (int x = 0; x < width; x++)
+            std::memcpy(destination + x * 3, source + x * 4, 3);
+    }
+    return true;
+}
+
+static void SwapRedBlue(Image &image)
+{
+    for (size_t i = 0; i < image.pixels.size(); i += 3)
+        std::swap(image.pixels[i], image.pixels[i + 2]);
+}
+
+static bool DecodeRaw(const std::vector<uint8_t> &file, Image &image)
+{
+    if (file.size() < sizeof(CaptureHeader) || std::memcmp(file.data(), "FRAW", 4) != 0)
+        return false;
+
+    CaptureHeader header = Load<CaptureHeader>(file.data());
+    size_t bytes = static_cast<size_t>(header.width) * header.height * 3;
+    if (file.size() < sizeof(CaptureHeader) + bytes)
+        return false;
+
+    image.width = static_cast<int>(header.width);
+    image.height = static_cast<int>(header.height);
+    image.pixels.assign(file.begin() + sizeof(CaptureHeader), file.begin() + sizeof(CaptureHeader) + bytes);
+    SwapRedBlue(image);
+    return true;
+}
+
+static bool DecodeRle(const std::vector<uint8_t> &file, Image &image)
+{
+    if (file.size() < sizeof(CaptureHeader) || std::memcmp(file.data(), "FRLE", 4) != 0)
+        return false;
+
+    CaptureHeader header = Load<CaptureHeader>(file.data());
+    image.width = static_cast<int>(header.width);
+    image.height = static_cast<int>(header.height);
+    image.pixels.resize(static_cast<size_t>(header.width) * header.height * 3);
+
+    uint8_t *out = image.pixels.data();
+    uint8_t *end = out + image.pixels.size();
+    for (size_t i = sizeof(CaptureHeader); i + 4 <= file.size(); i += 4)
+    {
+        size_t run = file[i];
+        if (out + run * 3 > end)
+            return false;
+        for (size_t p = 0; p < run; p++, out += 3)
+        {
+            out[0] = file[i + 3];
+            out[1] = file[i + 2];
+            out[2] = file[i + 1];
+        }
+    }
+    return out == end;
+}
+
+static bool LoadFrame(const std::string &path, std::vector<uint8_t> &buffer, Image &image)
+{
+    if (!ReadFile(path, buffer))
+        return false;
+
+    std::string extension = fs::path(path).extension().string();
+    if (extension == ".raw")
+        return DecodeRaw(buffer, image);
+    if (extension == ".rle")
+        return DecodeRle(buffer, image);
+    return DecodeBmp(buffer, image);
+}
+
+// Counts pixels where any channel differs by more than tolerance, and the largest channel difference
+static void DiffPixels(const uint8_t *a, const uint8_t *b, size_t pixelCount, int tolerance, FrameResult &result)
+{
+    size_t i = 0;
+    uint64_t mismatched = 0;
+    int maxDelta = 0;
+
+#ifdef FRAME_DIFF_SSE2
+    // 16 pixels (three 16-byte lanes) per step; identical blocks, the common case, cost a compare and a branch
+    const __m128i threshold = _mm_set1_epi8(static_cast<char>(tolerance));
+    const __m128i zero = _mm_setzero_si128();
+    const uint64_t firstChannel = 0x249249249249ull; // bit 3k of a 48-bit byte mask
+    __m128i maxLane = zero;
+
+    for (; i + 16 <= pixelCount; i += 16)
+    {
+        uint64_t overMask = 0;
+        for (int lane = 0; lane < 3; lane++)
+        {
+            __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i * 3 + lane * 16));
+            __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i * 3 + lane * 16));
+            __m128i delta = _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));
+            maxLane = _mm_max_epu8(maxLane, delta);
+
+            __m128i over = _mm_cmpeq_epi8(_mm_subs_epu8(delta, threshold), zero);
+            uint64_t laneMask = static_cast<uint16_t>(~_mm_movemask_epi8(over));
+            overMask |= laneMask << (lane * 16);
+        }
+        if (overMask == 0)
+            continue;
+
+        // a pixel differs if any of its three channel bits is set
+        uint64_t pixelMask = (overMask | overMask >> 1 | overMask >> 2) & firstChannel;
+#if defined(__GNUC__) || defined(__clang__)
+        mismatched += __builtin_popcountll(pixelMask);
+#else
+        for (; pixelMask; pixelMask &= pixelMask - 1)
+            mismatched++;
+#endif
+    }
+
+    alignas(16) uint8_t lanes[16];
+    _mm_store_si128(reinterpret_cast<__m128i *>(lanes), maxLane);
+    maxDelta = *std::max_element(lanes, lanes + 16);
+#endif
+
+    for (; i < pixelCount; i++)
+    {
+        bool over = false;
+        for (int c = 0; c < 3; c++)
+        {
+            int delta = std::abs(a[i * 3 + c] - b[i * 3 + c]);
+            maxDelta = std::max(maxDelta, delta);
+            over |= delta > tolerance;
+        }
+        mismatched += over;
+    }
+
+    result.mismatched = mismatched;
+    result.maxDelta = maxDelta;
+}
+
+// The golden frame in dim gray with differing pixels in red, brighter for larger differences
+static void WriteDiffImage(const std::string &path, const Image &golden, const Image &candidate, int tolerance)
+{
+    size_t rowBytes = static_cast<size_t>(golden.width) * 3;
+    size_t stride = (rowBytes + 3) & ~static_cast<size_t>(3);
+    std::vector<uint8_t> file(54 + stride * golden.height, 0);
+
+    auto store32 = [&file](size_t offset, uint32_t value) { std::memcpy(&file[offset], &value, 4); };
+    file[0] = 'B';
+    file[1] = 'M';
+    store32(2, static_cast<uint32_t>(file.size()));
+    store32(10, 54);
+    store32(14, 40);
+    store32(18, static_cast<uint32_t>(golden.width));
+    store32(22, static_cast<uint32_t>(golden.height));
+    file[26] = 1; // planes
+    file[28] = 24; // bits per pixel
+    store32(34, static_cast<uint32_t>(stride * golden.height));
+
+    for (int y = 0; y < golden.height; y++)
+    {
+        const uint8_t *a = golden.pixels.data() + y * rowBytes;
+        const uint8_t *b = candidate.pixels.data() + y * rowBytes;
+        uint8_t *out = file.data() + 54 + stride * (golden.height - 1 - y);
+        for (size_t x = 0; x < rowBytes; x += 3)
+        {
+            int delta = std::max({std::abs(a[x] - b[x]), std::abs(a[x + 1] - b[x + 1]), std::abs(a[x + 2] - b[x + 2])});
+            if (delta > tolerance)
+            {
+                out[x + 2] = static_cast<uint8_t>(std::min(255, 128 + delta));
+                continue;
+            }
+            uint8_t gray = static_cast<uint8_t>((a[x] + a[x + 1] * 2 + a[x + 2]) / 16);
+            out[x] = out[x + 1] = out[x + 2] = gray;
+        }
+    }
+
+    std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+    if (!stream.write(reinterpret_cast<const char *>(file.data()), static_cast<std::streamsize>(file.size())))
+        std::cout << "error: failed to write " << path << std::endl;
+}
+
+// frame_NNNNN -> path, for every frame file in the directory
+static std::map<std::string, std::string> ListFrames(const std::string &directory)
+{
+    std::map<std::string, std::string> frames;
+    for (const auto &entry : fs::directory_iterator(directory))
+    {
+        std::string extension = entry.path().extension().string();
+        std::string stem = entry.path().stem().string();
+        if (stem.rfind("frame_", 0) != 0 || (extension != ".bmp" && extension != ".raw" && extension != ".rle"))
+            continue;
+        frames[stem] = entry.path().string();
+    }
+    return frames;
+}
+
+// With hold, a frame missing on one side repeats that side's previous frame (FRAME_CAPTURE_FORMAT=changed)
+static std::vector<FramePair> PairFrames(const std::map<std::string, std::string> &golden,
+                                         const std::map<std::string, std::string> &candidate, bool hold)
+{
+    std::map<std::string, FramePair> pairs;
+    for (const auto &frame : golden)
+        pairs[frame.first].golden = frame.second;
+    for (const auto &frame : candidate)
+        pairs[frame.first].candidate = frame.second;
+
+    std::vector<FramePair> result;
+    std::string lastGolden, lastCandidate;
+    for (auto &pair : pairs)
+    {
+        pair.second.name = pair.first;
+        if (hold)
+        {
+            if (pair.second.golden.empty())
+                pair.second.golden = lastGolden;
+            if (pair.second.candidate.empty())
+                pair.second.candidate = lastCandidate;
+            lastGolden = pair.second.golden;
+            lastCandidate = pair.second.candidate;
+        }
+        result.push_back(pair.second);
+    }
+    return result;
+}
+
+static FrameResult CompareFrame(const FramePair &pair, const Options &options, std::vector<uint8_t> &buffer,
+                                Image &golden, Image &candidate)
+{
+    FrameResult result;
+    result.failed = true;
+
+    if (pair.golden.empty() || pair.candidate.empty())
+    {
+        result.error = pair.golden.empty() ? "missing from golden" : "missing from candidate";
+        return result;
+    }
+    if (!LoadFrame(pair.golden, buffer, golden))
+    {
+        result.error = "can't read " + pair.golden;
+        return result;
+    }
+    if (!LoadFrame(pair.candidate, buffer, candidate))
+    {
+        result.error = "can't read " + pair.candidate;
+        return result;
+    }
+    if (golden.width != candidate.width || golden.height != candidate.height)
+    {
+        result.error = "size " + std::to_string(candidate.width) + "x" + std::to_string(candidate.height) +
+                       ", expected " + std::to_string(golden.width) + "x" + std::to_string(golden.height);
+        return result;
+    }
+
+    result.pixels = static_cast<uint64_t>(golden.width) * golden.height;
+    DiffPixels(golden.pixels.data(), candidate.pixels.data(), result.pixels, options.tolerance, result);
+    result.failed = result.mismatched * 100.0 > options.maxMismatch * result.pixels;
+
+    if (result.failed && !options.diffDir.empty())
+        WriteDiffImage(options.diffDir + "/" + pair.name + "_diff.bmp", golden, candidate, options.tolerance);
+    return result;
+}
+
+static double Percent(const FrameResult &result)
+{
+    return result.pixels ? result.mismatched * 100.0 / result.pixels : 100.0;
+}
+
+static void WriteJson(const std::string &path, const std::vector<FramePair> &pairs,
+                      const std::vector<FrameResult> &results, size_t failed)
+{
+    std::ofstream file(path, std::ios::out | std::ios::trunc);
+    if (!file.is_open())
+    {
+        std::cout << "error: failed to open " << path << " for writing" << std::endl;
+        return;
+    }
+
+    file << std::fixed << std::setprecision(4);
+    file << "{\n  \"frames\": " << pairs.size() << ",\n  \"failed\": " << failed << ",\n  \"results\": [";
+    for (size_t i = 0; i < pairs.size(); i++)
+    {
+        const FrameResult &result = results[i];
+        file << (i ? ",\n" : "\n") << "    {\"frame\": \"" << pairs[i].name << "\", \"mismatch_percent\": "
+             << Percent(result) << ", \"mismatched_pixels\": " << result.mismatched << ", \"max_delta\": "
+             << result.maxDelta << ", \"failed\": " << (result.failed ? "true" : "false");
+        if (!result.error.empty())
+            file << ", \"error\": \"" << result.error << "\"";
+        file << "}";
+    }
+    file << "\n  ]\n}\n";
+}
+
+static void PrintUsage()
+{
+    std::cout << "usage: frame_diff [options] <golden dir> <candidate dir>\n"
+              << "  --tolerance N      per channel difference still counted as equal (default 0)\n"
+              << "  --max-mismatch P   percent of differing pixels a frame may have (default 0)\n"
+              << "  --diff-dir DIR     write frame_NNNNN_diff.bmp for failed frames\n"
+              << "  --json FILE        write per-frame results as JSON\n"
+              << "  --threads N        worker threads (default: hardware threads)\n"
+              << "  --hold             a missing frame repeats the previous one (FRAME_CAPTURE_FORMAT=changed)\n"
+              << "  --verbose          print every frame, not only failures" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    std::vector<std::string> directories;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--tolerance" && hasValue)
+            options.tolerance = std::clamp(std::atoi(argv[++i]), 0, 255);
+        else if (arg == "--max-mismatch" && hasValue)
+            options.maxMismatch = std::atof(argv[++i]);
+        else if (arg == "--diff-dir" && hasValue)
+            options.diffDir = argv[++i];
+        else if (arg == "--json" && hasValue)
+            options.jsonPath = argv[++i];
+        else if (arg == "--threads" && hasValue)
+            options.threads = std::atoi(argv[++i]);
+        else if (arg == "--hold")
+            options.hold = true;
+        else if (arg == "--verbose")
+            options.verbose = true;
+        else if (arg == "--help" || arg == "-h")
+        {
+            PrintUsage();
+            return 0;
+        }
+        else if (!arg.empty() && arg[0] == '-')
+        {
+            std::cout << "error: unknown option " << arg << std::endl;
+            PrintUsage();
+            return 2;
+        }
+        else
+            directories.push_back(arg);
+    }
+
+    if (directories.size() != 2)
+    {
+        PrintUsage();
+        return 2;
+    }
+    for (const std::string &directory : directories)
+    {
+        if (!fs::is_directory(directory))
+        {
+            std::cout << "error: " << directory << " is not a directory" << std::endl;
+            return 2;
+        }
+    }
+    if (!options.diffDir.empty())
+        fs::create_directories(options.diffDir);
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<FramePair> pairs = PairFrames(ListFrames(directories[0]), ListFrames(directories[1]), options.hold);
+    std::vector<FrameResult> results(pairs.size());
+
+    // frames are independent: each worker takes the next one and keeps its own decode buffers
+    int threadCount = options.threads > 0 ? options.threads : static_cast<int>(std::thread::hardware_concurrency());
+    threadCount = std::max(1, std::min<int>(threadCount, static_cast<int>(pairs.size())));
+    std::atomic<size_t> next{0};
+    auto worker = [&]()
+    {
+        std::vector<uint8_t> buffer;
+        Image golden, candidate;
+        for (size_t i = next++; i < pairs.size(); i = next++)
+            results[i] = CompareFrame(pairs[i], options, buffer, golden, candidate);
+    };
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threadCount; i++)
+        workers.emplace_back(worker);
+    worker();
+    for (std::thread &thread : workers)
+        thread.join();
+
+    size_t failed = 0;
+    std::cout << std::fixed << std::setprecision(3);
+    for (size_t i = 0; i < pairs.size(); i++)
+    {
+        const FrameResult &result = results[i];
+        failed += result.failed;
+        if (!result.failed && !options.verbose)
+            continue;
+
+        std::cout << (result.failed ? "FAIL " : "ok   ") << pairs[i].name << "  ";
+        if (!result.error.empty())
+            std::cout << result.error << std::endl;
+        else
+            std::cout << Percent(result) << "% (" << result.mismatched << " px, max delta " << result.maxDelta
+                      << ")" << std::endl;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << pairs.size() << " frames, " << failed << " failed, " << seconds << " s ("
+              << (seconds > 0 ? pairs.size() / seconds : 0.0) << " frames/s, " << threadCount << " threads)"
+              << std::endl;
+
+    if (!options.jsonPath.empty())
+        WriteJson(options.jsonPath, pairs, results, failed);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,85 @@
+// render_log_format: turns the render_logger.bin written by a RENDERLOGGER run (see RenderLog.h) into the
+// render_logger.txt text the render logger has always produced.
+//
+//     render_log_format [render_logger.bin] [render_logger.txt]
+//
+// Both paths default to the names above, in the current directory; "-" as the output writes to stdout.
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include "RenderLog.h"
+
+int main(int argc, char *argv[])
+{
+    std::string inputPath = argc > 1 ? argv[1] : "render_logger.bin";
+    std::string outputPath = argc > 2 ? argv[2] : "render_logger.txt";
+
+    FILE *input = std::fopen(inputPath.c_str(), "rb");
+    char magic[sizeof(RenderLog::MAGIC)];
+    if (input == nullptr || std::fread(magic, 1, sizeof(magic), input) != sizeof(magic) ||
+        std::memcmp(magic, RenderLog::MAGIC, sizeof(magic)) != 0)
+    {
+        std::cout << "error: " << inputPath << " is not a render log" << std::endl;
+        return 1;
+    }
+
+    std::ofstream file;
+    if (outputPath != "-")
+    {
+        file.open(outputPath, std::ios::out | std::ios::trunc);
+        if (!file.is_open())
+        {
+            std::cout << "error: failed to open " << outputPath << " for writing" << std::endl;
+            return 1;
+        }
+    }
+    std::ostream &out = outputPath == "-" ? std::cout : file;
+    RenderLog::FormatHeader(out);
+
+    std::vector<std::string> names;
+    std::vector<RenderLogRecord> records(4096);
+    size_t pendingNameBytes = 0; // name chunks still to come after a RECORD_NAME
+    uint64_t draws = 0;
+
+    size_t count;
+    while ((count = std::fread(records.data(), sizeof(RenderLogRecord), records.size(), input)) > 0)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            const RenderLogRecord &record = records[i];
+            if (pendingNameBytes > 0)
+            {
+                size_t bytes = std::min(pendingNameBytes, sizeof(RenderLogRecord));
+                names.back().append(reinterpret_cast<const char *>(&record), bytes);
+                pendingNameBytes -= bytes;
+                continue;
+            }
+
+            if (record.type == RenderLogRecord::RECORD_NAME)
+            {
+                // ids are handed out in order
+                names.emplace_back();
+                pendingNameBytes = static_cast<size_t>(record.frame);
+                continue;
+            }
+
+            if (record.nameId >= names.size())
+            {
+                std::cout << "error: " << inputPath << " is corrupt (draw " << draws << " uses an undefined name)"
+                          << std::endl;
+                return 1;
+            }
+            RenderLog::FormatDraw(out, record, names[record.nameId]);
+            draws++;
+        }
+    }
+    std::fclose(input);
+
+    if (outputPath != "-")
+        std::cout << draws << " draws written to " << outputPath << std::endl;
+    return 0;
+}
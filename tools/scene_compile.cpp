@@ -0,0 +1,104 @@
+// scene_compile: compiles .scene files and the templates they use into .scenec files (see CompiledScene.h),
+// which the engine loads instead of the JSON when they are up to date.
+//
+//     scene_compile [resources dir] [scene name ...]
+//
+// Without scene names every resources/scenes/*.scene is compiled. Run it again after editing a scene or
+// any of its templates.
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+#include "CompiledScene.h"
+#include "rapidjson/error/en.h"
+
+static bool ReadJson(const std::string &path, rapidjson::Document &document)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        std::cout << "error: failed to open " << path << std::endl;
+        return false;
+    }
+    std::stringstream contents;
+    contents << file.rdbuf();
+    document.Parse(contents.str().c_str());
+    if (document.HasParseError())
+    {
+        std::cout << "error parsing json at [" << path << "]: " << rapidjson::GetParseError_En(document.GetParseError())
+                  << " at offset " << document.GetErrorOffset() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+static bool Compile(const std::filesystem::path &resources, const std::string &sceneName)
+{
+    std::string scenePath = (resources / "scenes" / (sceneName + ".scene")).string();
+    rapidjson::Document scene;
+    if (!ReadJson(scenePath, scene))
+        return false;
+
+    size_t actors = 0;
+    CompiledScene::Templates templates;
+    if (scene.IsObject() && scene.HasMember("actors") && scene["actors"].IsArray())
+    {
+        for (const auto &actorValue: scene["actors"].GetArray())
+        {
+            actors++;
+            if (!actorValue.IsObject() || !actorValue.HasMember("template") || !actorValue["template"].IsString())
+                continue;
+
+            std::string templateName = actorValue["template"].GetString();
+            if (templates.count(templateName) > 0)
+                continue;
+            std::string templatePath = (resources / "actor_templates" / (templateName + ".template")).string();
+            if (!ReadJson(templatePath, templates[templateName]))
+                return false;
+        }
+    }
+
+    std::string compiledPath = CompiledScene::PathFor(scenePath);
+    if (!CompiledScene::Write(compiledPath, scene, templates))
+    {
+        std::cout << "error: failed to write " << compiledPath << std::endl;
+        return false;
+    }
+
+    std::printf("%s: %zu actors, %zu templates, %.1f KB of JSON -> %.1f KB\n", sceneName.c_str(), actors,
+                templates.size(), std::filesystem::file_size(scenePath) / 1024.0,
+                std::filesystem::file_size(compiledPath) / 1024.0);
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    std::filesystem::path resources = argc > 1 ? argv[1] : "resources";
+    std::vector<std::string> scenes(argv + std::min(argc, 2), argv + argc);
+
+    if (scenes.empty())
+    {
+        std::error_code error;
+        for (const auto &entry: std::filesystem::directory_iterator(resources / "scenes", error))
+        {
+            if (entry.path().extension() == ".scene")
+                scenes.push_back(entry.path().stem().string());
+        }
+        if (error)
+        {
+            std::cout << "error: " << (resources / "scenes").string() << " does not exist" << std::endl;
+            return 1;
+        }
+        std::sort(scenes.begin(), scenes.end());
+    }
+
+    bool ok = true;
+    for (const std::string &scene: scenes)
+        ok = Compile(resources, scene) && ok;
+    return ok ? 0 : 1;
+}